@@ -0,0 +1,73 @@
+#pragma once
+
+#include <Arduino.h>
+#include "TwaiTaskBased.h"
+
+// =============================================================================
+// Bus Traffic Sniffer
+// =============================================================================
+//
+// Diagnostic mode that records every frame the module receives into the
+// spiffs partition (548 KB), so bus problems can be examined later without a
+// laptop and USB-CAN dongle on site. Frames are compressed by CaptureEncoder
+// (delta timestamps, per-sector ID dictionary, repeated-data flags) into
+// self-contained 4 KB sectors used as a ring, oldest sector overwritten.
+//
+// Capture never waits on the door reporting path: the receive callback only
+// copies the frame into a queue (dropped and counted when full), a task no
+// higher than the main loop encodes and writes, and every flash operation -
+// sector erases and single 256-byte page programs - waits until the main
+// loop reports itself idle. Encoded data waits in the RAM sector buffer.
+//
+// Command frame (host -> module), byte 0 = target mask (bit n = DIP address n):
+//   START   [mask, 0x01]                       authenticated when a key is set
+//   STOP    [mask, 0x02]
+//   STATUS  [mask, 0x03]
+//   READ    [mask, 0x04, sector, segment]      512-byte segment 0-7
+//
+// Reply frame (module -> host):
+//   data    [index, 7 bytes]                   index 0-73 within the segment
+//   STATUS  [0x81, active, session_lo, session_hi, sectors, dropped 3 bytes LE]
+//   END     [0x83, sector, segment, crc_lo, crc_hi, empty]  CRC-16 of the segment
+//   ERROR   [0x8F, code]
+//
+// READ is only served while capture is stopped; data frames are paced one per
+// millisecond so door frames never queue behind a download.
+
+class BusCapture {
+public:
+  static const uint16_t SECTOR_SIZE = 4096;
+  static const uint16_t SEGMENT_SIZE = 512;
+  static const uint8_t FRAME_PAYLOAD = 7;
+
+  enum Command : uint8_t {
+    CMD_START = 0x01,
+    CMD_STOP = 0x02,
+    CMD_STATUS = 0x03,
+    CMD_READ = 0x04,
+  };
+
+  enum Status : uint8_t {
+    STATUS_STATUS = 0x81,
+    STATUS_END = 0x83,
+    STATUS_ERROR = 0x8F,
+  };
+
+  enum Error : uint8_t {
+    ERR_NO_PARTITION = 0x01,
+    ERR_BUSY = 0x02,
+    ERR_RANGE = 0x03,
+    ERR_FLASH = 0x04,
+  };
+
+  // dipAddress selects the target mask bit, replyId is this module's reply
+  // ID. idle() is polled before every sector erase and should return true
+  // only while no door change is being debounced or sent.
+  static bool begin(uint8_t dipAddress, uint32_t replyId, bool (*idle)());
+
+  // Called from the CAN receive callback - copies the frame, never blocks
+  static void record(const twai_message_t& msg, int64_t rxUs);
+  static void handleCommand(const twai_message_t& msg);
+
+  static bool active();
+};
@@ -0,0 +1,60 @@
+#pragma once
+
+#include <stdint.h>
+
+// =============================================================================
+// Bus Time Synchronization (slave side)
+// =============================================================================
+//
+// A time master broadcasts a SYNC frame and then a FOLLOW_UP carrying the
+// master time at which that SYNC left the bus, in the style of gPTP over CAN.
+// Each module timestamps SYNC on reception and disciplines its local
+// microsecond clock against the master: a filtered phase offset plus a drift
+// estimate in fixed point (ppb).
+//
+// Reception latency in the CAN driver is the same on every module running
+// this firmware, so it biases all modules equally and cross-module event
+// ordering is preserved.
+
+class BusClock {
+public:
+  // Offset errors beyond this step the clock instead of slewing it
+  static const int64_t STEP_THRESHOLD_US = 1000;
+  // Consider the clock unsynchronized after this long without a FOLLOW_UP
+  static const int64_t SYNC_TIMEOUT_US = 10000000;
+  // Reject drift measurements beyond +/-500 ppm as outliers
+  static const int32_t MAX_DRIFT_PPB = 500000;
+
+  void onSync(uint8_t seq, int64_t localUs);
+
+  // Returns true if the FOLLOW_UP matched the last SYNC and was applied
+  bool onFollowUp(uint8_t seq, int64_t masterUs);
+
+  bool synced(int64_t localUs) const;
+
+  // Local microseconds to bus microseconds (identity until first sync)
+  int64_t toBusUs(int64_t localUs) const;
+
+  int32_t driftPpb() const { return drift; }
+  int64_t lastErrorUs() const { return lastError; }
+  uint32_t syncCount() const { return syncs; }
+
+private:
+  int64_t predictBus(int64_t localUs) const;
+
+  bool haveAnchor = false;
+  int64_t anchorLocal = 0;
+  int64_t anchorBus = 0;
+  int32_t drift = 0;  // Local clock rate error against the master, ppb
+
+  bool havePrevious = false;
+  int64_t previousLocal = 0;
+  int64_t previousMaster = 0;
+
+  bool pending = false;
+  uint8_t pendingSeq = 0;
+  int64_t pendingLocal = 0;
+
+  int64_t lastError = 0;
+  uint32_t syncs = 0;
+};
@@ -0,0 +1,37 @@
+#pragma once
+
+#include <stdint.h>
+
+// =============================================================================
+// Bus Load Estimator
+// =============================================================================
+//
+// The TWAI controller has no traffic counter and keeps no record of frames
+// its acceptance filter drops, so utilisation is estimated from every frame
+// the driver delivers (the filter accepts all IDs) plus the module's own
+// transmissions. Frame lengths assume typical bit stuffing. The load is
+// computed per window and smoothed, in permille of the bit rate.
+
+class BusLoadMonitor {
+public:
+  static const uint32_t WINDOW_MS = 250;
+
+  void begin(uint32_t bitrate, uint32_t nowMs);
+
+  // Count one frame seen on the bus (received or sent by this module)
+  void addFrame(uint8_t dlc, bool extended = false);
+
+  // Close the window when due; returns true when the estimate was updated
+  bool update(uint32_t nowMs);
+
+  uint16_t loadPermille() const { return smoothed; }
+
+  static uint32_t frameBits(uint8_t dlc, bool extended);
+
+private:
+  uint32_t bitrate = 500000;
+  uint32_t windowStartMs = 0;
+  uint32_t bits = 0;
+  uint16_t smoothed = 0;
+  bool primed = false;
+};
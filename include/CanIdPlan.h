@@ -0,0 +1,84 @@
+#pragma once
+
+#include <stdint.h>
+
+// =============================================================================
+// CAN ID Plan
+// =============================================================================
+//
+// Every CAN ID the module uses is defined once in CAN_ID_PLAN below; the
+// firmware, the host simulator and the host tools (through tools/can_id_plan.py)
+// all derive from it.
+// Lower IDs win arbitration, so the table is ordered by urgency: control and
+// time sync first, then door change events, then routine repeats.
+//
+// Per-module blocks have one ID per DIP address (slots = 8).
+
+//        name             base   slots  description
+#define CAN_ID_PLAN(X)                                                                  \
+  X(OTA_TRIGGER,         0x000, 1, "WiFi OTA trigger (hostname suffix)")               \
+  X(WIFI_CONFIG,         0x001, 1, "WiFi credential configuration")                    \
+  X(AUTH,                0x002, 1, "Control frame authentication")                     \
+  X(TIME_SYNC,           0x003, 1, "Bus time SYNC from the time master")               \
+  X(TIME_FOLLOW_UP,      0x004, 1, "Bus time FOLLOW_UP with the SYNC send time")       \
+  X(DISCOVER,            0x005, 1, "Discovery request (broadcast)")                    \
+  X(DOOR_EVENT,          0x00A, 8, "Door status on change (urgent)")                   \
+  X(DERIVED_SIGNAL,      0x012, 8, "Derived-signal rule results")                      \
+  X(DOOR_HEARTBEAT,      0x02A, 8, "Door status heartbeat (routine)")                  \
+  X(WIRING_DIAG,         0x070, 8, "Wiring diagnostics")                               \
+  X(OTA_COMMAND,         0x600, 1, "CAN firmware update command")                      \
+  X(OTA_DATA,            0x601, 1, "CAN firmware update data")                         \
+  X(CONFIG_COMMAND,      0x602, 1, "Bulk configuration command")                       \
+  X(CONFIG_DATA,         0x603, 1, "Bulk configuration data")                          \
+  X(CAPTURE_COMMAND,     0x604, 1, "Bus capture command")                              \
+  X(HISTORY_COMMAND,     0x605, 1, "Door event history command")                       \
+  X(OTA_STATUS,          0x610, 8, "CAN firmware update status reply")                 \
+  X(DISCOVERY_REPLY,     0x620, 8, "Discovery reply (identity and status)")            \
+  X(CONFIG_STATUS,       0x630, 8, "Bulk configuration status reply")                  \
+  X(CAPTURE_REPLY,       0x640, 8, "Bus capture status and download")                  \
+  X(HISTORY_REPLY,       0x650, 8, "Door event history status and download")
+
+class CanIdPlan {
+public:
+  // Bit rate every node on the bus runs at
+  static const uint32_t BITRATE = 500000;
+
+  enum Block : uint8_t {
+#define CAN_ID_PLAN_ENUM(name, base, slots, description) name,
+    CAN_ID_PLAN(CAN_ID_PLAN_ENUM)
+#undef CAN_ID_PLAN_ENUM
+    BLOCK_COUNT
+  };
+
+  struct Entry {
+    uint32_t base;
+    uint8_t slots;
+    const char *name;
+    const char *description;
+  };
+
+  static constexpr Entry TABLE[BLOCK_COUNT] = {
+#define CAN_ID_PLAN_ENTRY(name, base, slots, description) { base, slots, #name, description },
+    CAN_ID_PLAN(CAN_ID_PLAN_ENTRY)
+#undef CAN_ID_PLAN_ENTRY
+  };
+
+  // ID of a block, slot = DIP address for per-module blocks
+  static constexpr uint32_t id(Block block, uint8_t slot = 0) {
+    return TABLE[block].base + slot;
+  }
+
+  static constexpr bool contains(Block block, uint32_t canId) {
+    return canId >= TABLE[block].base && canId < TABLE[block].base + TABLE[block].slots;
+  }
+
+  // True when blocks are in ascending ID order and do not overlap
+  static constexpr bool wellFormed() {
+    for (uint8_t i = 1; i < BLOCK_COUNT; i++) {
+      if (TABLE[i].base < TABLE[i - 1].base + TABLE[i - 1].slots) return false;
+    }
+    return TABLE[BLOCK_COUNT - 1].base + TABLE[BLOCK_COUNT - 1].slots <= 0x800;
+  }
+};
+
+static_assert(CanIdPlan::wellFormed(), "CAN ID plan blocks overlap or are out of order");
@@ -0,0 +1,103 @@
+#pragma once
+
+#include <Arduino.h>
+#include "TwaiTaskBased.h"
+
+// =============================================================================
+// Firmware Update over CAN
+// =============================================================================
+//
+// Streams a firmware image into the inactive app0/app1 slot without WiFi.
+// The image is sent in blocks of up to 256 data frames (7 payload bytes each,
+// byte 0 is the frame index within the block), each announced with a CRC-16.
+// The streamed image is verified against a SHA-256 sent by the host before
+// otadata is switched; the bootloader then starts the new slot on next reset.
+//
+// Unicast: the module acknowledges each block once it has a free buffer for
+// the next one, so the sender is flow controlled by flash write speed.
+//
+// Multicast: every module whose bit is set in the target mask receives the
+// same block stream concurrently without acknowledging. Each module tracks
+// received blocks in a bitmap; afterwards the host queries the missing blocks
+// from every module and rebroadcasts only those. Fleet update time scales with
+// image size rather than module count.
+//
+// Compressed: blocks carry ImageCodec chunks that each decode on their own to
+// a known image offset, streamed straight into the OTA write path. With the
+// delta flag the chunks may also copy from the running slot, so an update
+// only transfers what changed. BASE must precede a delta BEGIN and carries
+// the first 4 bytes of the running image's SHA-256 the delta was built from.
+//
+// Command frame (host -> module), byte 0 = target mask (bit n = DIP address n):
+//   BEGIN   [mask, 0x01, size0, size1, size2, flags, blocks_lo, blocks_hi]
+//           flags: bit 0 multicast, bit 1 compressed, bit 2 delta
+//   BLOCK   [mask, 0x02, block_lo, block_hi, frames-1, crc_lo, crc_hi]
+//   HASH    [mask, 0x03, offset, up to 5 SHA-256 bytes]
+//   END     [mask, 0x04]
+//   ABORT   [mask, 0x05]
+//   QUERY   [mask, 0x06]                          report missing blocks
+//   BASE    [mask, 0x07, sha0, sha1, sha2, sha3]  delta base image ID
+//
+// Status frame (module -> host):
+//   READY   [0x81, block_size_lo, block_size_hi]
+//   ACK     [0x82, block_lo, block_hi]            unicast only
+//   DONE    [0x83]
+//   MISSING [0x84, base_lo, base_hi, 5 bitmap bytes]  bit n = block base+n missing
+//   REPORT  [0x85, missing_lo, missing_hi]        ends a QUERY reply
+//   ERROR   [0x8F, code]
+
+class CanOta {
+public:
+  static const uint8_t FRAME_PAYLOAD = 7;
+  static const uint16_t FRAMES_PER_BLOCK = 256;
+  static const uint16_t BLOCK_SIZE = FRAME_PAYLOAD * FRAMES_PER_BLOCK;
+  static const uint16_t MAX_BLOCKS = 1024;
+  static const uint8_t BLOCKS_PER_MISSING_FRAME = 40;
+
+  enum Command : uint8_t {
+    CMD_BEGIN = 0x01,
+    CMD_BLOCK = 0x02,
+    CMD_HASH = 0x03,
+    CMD_END = 0x04,
+    CMD_ABORT = 0x05,
+    CMD_QUERY = 0x06,
+    CMD_BASE = 0x07,
+  };
+
+  enum Status : uint8_t {
+    STATUS_READY = 0x81,
+    STATUS_ACK = 0x82,
+    STATUS_DONE = 0x83,
+    STATUS_MISSING = 0x84,
+    STATUS_REPORT = 0x85,
+    STATUS_ERROR = 0x8F,
+  };
+
+  enum Error : uint8_t {
+    ERR_NO_PARTITION = 0x01,
+    ERR_TOO_LARGE = 0x02,
+    ERR_FLASH = 0x03,
+    ERR_SEQUENCE = 0x04,
+    ERR_HASH = 0x05,
+    ERR_IMAGE = 0x06,
+    ERR_TIMEOUT = 0x07,
+    ERR_BASE = 0x08,
+    ERR_DECODE = 0x09,
+  };
+
+  static const uint8_t FLAG_MULTICAST = 0x01;
+  static const uint8_t FLAG_COMPRESSED = 0x02;
+  static const uint8_t FLAG_DELTA = 0x04;
+
+  // dipAddress selects the target mask bit, statusId is this module's reply ID
+  static void begin(uint8_t dipAddress, uint32_t statusId);
+
+  // Called from the CAN receive callback - copies data only, never blocks
+  static void handleCommand(const twai_message_t& msg);
+  static void handleData(const twai_message_t& msg);
+
+  static bool active();
+
+  // CRC-16/CCITT-FALSE used for block integrity (matches Python crc_hqx)
+  static uint16_t crc16(const uint8_t* data, size_t length, uint16_t crc = 0xFFFF);
+};
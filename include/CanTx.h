@@ -0,0 +1,42 @@
+#pragma once
+
+#include <Arduino.h>
+#include "TwaiTaskBased.h"
+
+// =============================================================================
+// Transmit Sequencing
+// =============================================================================
+//
+// The driver reports each transmit completion with only a success flag, in the
+// order the frames were queued. Every frame the firmware sends goes through
+// send(), which numbers it, so the transmit callback can count completions to
+// tell which frame finished - the TX mailbox must not mistake a CAN update
+// ACK or a history frame for its own.
+
+class CanTx {
+public:
+  static void begin();
+
+  // Queue msg with the driver and return its sequence number (never 0). If
+  // sequence is given it is set before the frame is queued, so a completion
+  // can never be seen before the caller knows the number.
+  static uint32_t send(const twai_message_t& msg, volatile uint32_t* sequence = nullptr);
+
+  // Service status reply on id: [status, args...], and the error reply
+  // [STATUS_ERROR, code] the update, configuration, capture and history
+  // services share
+  static const uint8_t STATUS_ERROR = 0x8F;
+  static uint32_t sendStatus(uint32_t id, uint8_t status, const uint8_t* args = nullptr,
+                             uint8_t argLength = 0);
+  static uint32_t sendError(uint32_t id, uint8_t code);
+
+  // Call once per driver completion; returns the sequence number of the
+  // frame that completed
+  static uint32_t completed();
+
+  // True when the controller is error-active and the driver holds no frames.
+  // Completions still owed then were lost (dropped before reaching the
+  // driver, or flushed at bus-off), so the count is brought level. False,
+  // changing nothing, while frames may still complete.
+  static bool resync();
+};
@@ -0,0 +1,76 @@
+#pragma once
+
+#include <stdint.h>
+
+// =============================================================================
+// Bus Capture Encoding
+// =============================================================================
+//
+// Packs received CAN frames into flash sectors for the bus sniffer (see
+// BusCapture.h). Every sector decodes on its own, so a torn or overwritten
+// sector never corrupts the others:
+//
+//   header  magic "CAP1" (4), sequence (4), session (2), flags (2),
+//           base time us (8)                               all little-endian
+//   records until the first 0xFF byte (erased flash)
+//
+// Record, first byte:
+//   00iiiiii  ID from this sector's dictionary, entry i
+//   01000000  new 11-bit ID follows (2 bytes), appended to the dictionary
+//   01000001  29-bit ID follows (4 bytes), never in the dictionary
+//   11tttttt  marker t, followed by a varint value
+// then for frames:
+//   dlc byte  bits 0-3 DLC, bit 4 repeat (same data as the last frame on this
+//             dictionary ID in this sector, data omitted), bit 5 RTR
+//   varint    microseconds since the previous frame (LEB128)
+//   data      DLC bytes unless repeat or RTR
+//
+// Periodic status traffic mostly encodes as 1 + 1 + 2-3 bytes per frame.
+
+struct CapturedFrame {
+  int64_t timeUs;
+  uint32_t id;
+  bool extended;
+  bool rtr;
+  uint8_t dlc;
+  uint8_t data[8];
+};
+
+class CaptureEncoder {
+public:
+  static const uint32_t MAGIC = 0x31504143;  // "CAP1"
+  static const uint8_t HEADER_SIZE = 20;
+  static const uint8_t MAX_RECORD = 24;
+  static const uint8_t DICTIONARY_SIZE = 64;
+  static const uint16_t FLAG_SESSION_START = 0x0001;
+
+  enum Marker : uint8_t {
+    MARKER_DROPPED = 0x01,  // Frames lost before this point (queue full)
+    MARKER_END = 0x3F,      // 0xFF, erased flash
+  };
+
+  // Start encoding into sector (size bytes, already erased to 0xFF)
+  void beginSector(uint8_t* sector, uint16_t size, uint32_t sequence,
+                   uint16_t session, uint16_t flags, int64_t baseUs);
+
+  // Append one record; false when the sector is full
+  bool add(const CapturedFrame& frame);
+  bool addMarker(Marker marker, uint32_t value);
+
+  // Bytes of the sector in use, header included
+  uint16_t used() const { return length; }
+
+private:
+  void putVarint(uint64_t value);
+  int8_t lookup(uint32_t id) const;
+
+  uint8_t* out = nullptr;
+  uint16_t capacity = 0;
+  uint16_t length = 0;
+  int64_t lastUs = 0;
+
+  uint16_t dictionary[DICTIONARY_SIZE];
+  uint8_t lastData[DICTIONARY_SIZE][8];
+  uint8_t lastDlc[DICTIONARY_SIZE];
+  uint8_t dictionaryCount = 0;
+};
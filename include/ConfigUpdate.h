@@ -0,0 +1,91 @@
+#pragma once
+
+#include <Arduino.h>
+#include "ModuleConfig.h"
+#include "RuleEngine.h"
+#include "TwaiTaskBased.h"
+
+// =============================================================================
+// Bulk Configuration over CAN
+// =============================================================================
+//
+// Pushes one blob to any number of modules at once: the ModuleConfig
+// (kind 0) or a derived-signal rule program for RuleEngine (kind 1). The host
+// multicasts BEGIN, the blob in indexed data frames, the blob's full SHA-256
+// in HASH segments and COMMIT; HASH and COMMIT are authenticated together
+// (see ControlAuth.h), as the CAN update's HASH and END are. Each targeted
+// module checks the blob against that hash and validates its contents; only
+// then is it stored in NVS and applied from the main loop, all parameters
+// together, before APPLIED is sent. A rejected blob changes nothing. QUERY
+// returns the hash of the active blob of a kind, so the host verifies the
+// whole fleet with one request.
+//
+// Command frame (host -> module), byte 0 = target mask (bit n = DIP address n):
+//   BEGIN   [mask, 0x01, length, version, kind]   kind defaults to 0
+//   COMMIT  [mask, 0x02]                  after all 32 hash bytes
+//   QUERY   [mask, 0x03, kind]
+//   HASH    [mask, 0x04, offset, up to 5 SHA-256 bytes]
+// Data frame (host -> all):  [index, 7 blob bytes]
+//
+// Status frame (module -> host), hash0-3 = first 4 SHA-256 bytes:
+//   APPLIED [0x81, hash0, hash1, hash2, hash3, kind]
+//   HASH    [0x82, hash0, hash1, hash2, hash3, version, stored, kind]
+//   ERROR   [0x8F, code]
+
+class ConfigUpdate {
+public:
+  static const uint8_t FRAME_PAYLOAD = 7;
+  static const uint8_t MAX_BLOB = RuleEngine::MAX_PROGRAM;
+
+  enum Kind : uint8_t {
+    KIND_CONFIG = 0,
+    KIND_RULES = 1,
+    KIND_COUNT,
+  };
+
+  enum Command : uint8_t {
+    CMD_BEGIN = 0x01,
+    CMD_COMMIT = 0x02,
+    CMD_QUERY = 0x03,
+    CMD_HASH = 0x04,
+  };
+
+  enum Status : uint8_t {
+    STATUS_APPLIED = 0x81,
+    STATUS_HASH = 0x82,
+    STATUS_ERROR = 0x8F,
+  };
+
+  enum Error : uint8_t {
+    ERR_SEQUENCE = 0x01,
+    ERR_INCOMPLETE = 0x02,
+    ERR_HASH = 0x03,
+    ERR_INVALID = 0x04,
+    ERR_STORE = 0x05,
+    ERR_VERSION = 0x06,
+  };
+
+  // Replace config / load rules with the stored blob if NVS holds a valid
+  // one. Call before begin() so the boot blobs' hashes are reported.
+  static bool load(ModuleConfig& config);
+  static bool loadRules(RuleEngine& rules);
+
+  // dipAddress selects the target mask bit, statusId is this module's reply ID
+  static void begin(uint8_t dipAddress, uint32_t statusId);
+
+  // Called from the CAN receive callback - copies data only, never blocks
+  static void handleCommand(const twai_message_t& msg);
+  static void handleData(const twai_message_t& msg);
+
+  // True from BEGIN until COMMIT or IDLE_TIMEOUT_MS without a frame, and
+  // while a committed blob waits for service()
+  static const uint32_t IDLE_TIMEOUT_MS = 2000;
+  static bool active();
+
+  // Call from the main loop: stores and applies a committed blob, then acks
+  static void service(void (*applyConfig)(const ModuleConfig& config),
+                      void (*applyRules)(const uint8_t* program, uint8_t length));
+
+  // First 4 bytes of the active blob's SHA-256, little-endian
+  static uint32_t activeHash(Kind kind = KIND_CONFIG);
+};
@@ -0,0 +1,64 @@
+#pragma once
+
+#include <Arduino.h>
+#include "TwaiTaskBased.h"
+
+// =============================================================================
+// Control Frame Authentication
+// =============================================================================
+//
+// Control frames that change module state (OTA trigger, WiFi credentials, CAN
+// firmware update BEGIN/END, configuration writes) are held back until an AUTH
+// frame for their CAN ID arrives. The AUTH frame carries a truncated freshness
+// counter and a truncated HMAC-SHA256 (computed on the C6 SHA accelerator via
+// mbedtls) over the counter and every frame held on that ID. Only when the MAC
+// verifies and the counter is newer than the last accepted one are the held
+// frames released to their normal handlers.
+//
+// AUTH frame: [id_lo, id_hi, counter_lo, counter_hi, mac0, mac1, mac2, mac3]
+//
+// The receiver reconstructs the full 32-bit counter from its low 16 bits and
+// the last accepted value. service() persists that value to NVS from the main
+// loop, outside the receive callback, so replays fail across reboots too.
+// MAC input:
+//   id (2 bytes LE) | counter (4 bytes LE) | { id (2 LE), dlc, data[dlc] }...
+//
+// After MAX_FAILURES rejected AUTH frames in a row, AUTH frames are refused
+// without computing a MAC for LOCKOUT_MS, which bounds a guess at the
+// truncated MAC to a few tries per second.
+
+class ControlAuth {
+public:
+  static const uint8_t MAC_BYTES = 4;
+  static const uint8_t MAX_HELD_FRAMES = 24;
+  static const uint8_t MAX_CHANNELS = 4;
+  static const uint8_t MAX_FAILURES = 5;
+  static const uint32_t LOCKOUT_MS = 1000;
+
+  typedef void (*ReleaseHandler)(const twai_message_t& msg);
+
+  // keyHex is the shared 256-bit key as 64 hex characters. An empty or
+  // malformed key leaves authentication disabled (all frames pass through).
+  static bool begin(const char* keyHex);
+  static bool enabled();
+
+  // Buffer a control frame until its AUTH frame arrives
+  static void hold(const twai_message_t& msg);
+
+  // True while frames wait for their AUTH frame (up to the hold timeout)
+  static bool holding();
+
+  // Check an AUTH frame; on success the held frames for its ID are passed
+  // to handler in arrival order. Returns true if the frame verified.
+  static bool verify(const twai_message_t& authMsg, ReleaseHandler handler);
+
+  // Write the last accepted counter to NVS if it changed (main loop)
+  static void service();
+
+  // Verification cost of the slowest AUTH frame in microseconds, AUTH frames
+  // rejected since boot (bad MAC or locked out), and whether AUTH frames are
+  // refused now; reported in discovery replies
+  static uint32_t maxVerifyUs();
+  static uint32_t rejectedCount();
+  static bool lockedOut();
+};
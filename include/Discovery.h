@@ -0,0 +1,49 @@
+#pragma once
+
+#include <Arduino.h>
+#include "TwaiTaskBased.h"
+
+// =============================================================================
+// Node Discovery and Inventory
+// =============================================================================
+//
+// A host broadcasts one DISCOVER request and every module answers with its
+// identity, without WiFi. Replies are spread over DIP-derived time slots
+// (SLOT_US apart, timed by esp_timer from reception of the request) so the
+// whole bus answers in about 8 ms without a burst of 24 frames arbitrating
+// at once.
+//
+// Request (host -> all):  [nonce]
+// Reply (module, on its reply ID), three frames:
+//   IDENTITY  [0x01, mac3, mac4, mac5, build0, build1, build2, build3]
+//   STATUS    [0x02, nonce, uptime_s 4 bytes LE, enable_lo, enable_hi]
+//   AUTH      [0x03, nonce, max_verify_us 2 bytes LE, rejected 2 bytes LE,
+//              flags, 0]
+//
+// mac3-mac5 are the last MAC bytes the esp32c6-XXXXXX hostname is built from;
+// build0-3 are the first bytes of the running firmware's ELF SHA-256. AUTH
+// reports ControlAuth's slowest verification and rejected AUTH frames since
+// boot (both saturate at 0xFFFF); flags bit 0 = authentication enabled, bit 1
+// = locked out after repeated failures.
+
+class Discovery {
+public:
+  static const uint32_t SLOT_US = 1000;
+
+  enum Reply : uint8_t {
+    REPLY_IDENTITY = 0x01,
+    REPLY_STATUS = 0x02,
+    REPLY_AUTH = 0x03,
+  };
+
+  static void begin(uint8_t dipAddress, uint32_t replyId, uint16_t enabledMask);
+
+  // Enabled channel mask reported in STATUS replies
+  static void setEnabledMask(uint16_t enabledMask);
+
+  // Call from the CAN receive callback; the reply slot is timed from here
+  static void handleRequest(const twai_message_t& msg);
+
+private:
+  static void sendReply(void* arg);
+};
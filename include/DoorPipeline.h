@@ -0,0 +1,73 @@
+#pragma once
+
+#include <stdint.h>
+#include "DoorReporter.h"
+#include "ReedDebouncer.h"
+#include "TxMailbox.h"
+
+// =============================================================================
+// Door Reporting Pipeline
+// =============================================================================
+//
+// The steps from a raw reed sample to the door status frames handed to the
+// driver, shared by the firmware loop and the golden trace replay
+// (tools/golden), so the replay runs the same code the module does:
+//
+//   sample()     debounce the HP pins, merge channels debounced elsewhere
+//                (LP core), and time each confirmed change from its
+//                hardware edge timestamp or the debouncer's edge
+//   report()     event and heartbeat frames due now, bytes 0-3 encoded
+//   applyBusLoad()  heartbeat back-off from a closed bus load window
+//   queued()     bytes 4-7 of a door frame as it goes to the driver
+//
+// Pin reads, clocks, locking and the mailbox stay with the caller.
+
+class DoorPipeline {
+public:
+  // Hardware timestamp of a channel's newest contact edge in local
+  // microseconds, or -1 to fall back to the debouncer's edge time
+  typedef int64_t (*EdgeReader)(uint8_t channel, void* context);
+
+  DoorPipeline(ReedDebouncer& debouncer, DoorReporter& reporter)
+      : debouncer(debouncer), reporter(reporter) {}
+
+  // Start reporting state with no edge seen yet (the debouncer is already
+  // begun); the first report() sends a heartbeat
+  void begin(uint16_t state, uint32_t heartbeatMs, uint32_t eventId, uint32_t heartbeatId);
+
+  // Feed one sample: raw HP pin levels (bit n = channel n HIGH/open) read at
+  // sampleUs, and the state of channels debounced elsewhere. Returns the
+  // channels whose debounced state changed. edges may be null.
+  uint16_t sample(uint16_t raw, uint16_t otherState, int64_t sampleUs, uint32_t nowMs,
+                  EdgeReader edges, void* context);
+
+  // Door frames due now: frames[0] the event, frames[1] the heartbeat, each
+  // filled when its DoorReporter::SEND_* bit is set in the result
+  uint8_t report(uint32_t nowMs, CanFrame frames[2]);
+
+  // Select the heartbeat interval for a new bus load estimate, returns true
+  // if it changed
+  bool applyBusLoad(uint16_t loadPermille) { return reporter.applyBusLoad(loadPermille); }
+
+  // Fill bytes 4-7 of a door status frame handed to the driver at queueUs
+  // (bus time queueBusUs); other frames are left alone
+  void queued(CanFrame& frame, int64_t queueUs, int64_t queueBusUs) const;
+
+  uint16_t state() const { return current; }
+
+  // Local time of the last sample, of the newest contact edge behind a
+  // confirmed change, and of the edge behind each channel's last change
+  int64_t sampleUs() const { return lastSampleUs; }
+  int64_t lastEdgeUs() const { return newestEdgeUs; }
+  int64_t changeUs(uint8_t channel) const { return channelEdgeUs[channel]; }
+
+private:
+  ReedDebouncer& debouncer;
+  DoorReporter& reporter;
+  uint32_t eventId = 0;
+  uint32_t heartbeatId = 0;
+  uint16_t current = 0;
+  int64_t lastSampleUs = 0;
+  int64_t newestEdgeUs = 0;
+  int64_t channelEdgeUs[ReedDebouncer::MAX_CHANNELS] = {};
+};
@@ -0,0 +1,89 @@
+#pragma once
+
+#include <stdint.h>
+
+// =============================================================================
+// Door Status Transmit Policy
+// =============================================================================
+//
+// Decides which door status frames are due: an event frame as soon as the
+// debounced state changes, and a heartbeat repeating the current state when
+// nothing has been sent for the heartbeat interval. Event and heartbeat go
+// out on separate ID blocks (see CanIdPlan.h) so urgent changes win
+// arbitration over routine repeats from every module.
+//
+// Changes are coalesced: the first debounced change opens a window of fixed
+// length and every change inside it goes out in one event frame when it
+// closes, so a double cabinet tripping two reed switches a few milliseconds
+// apart costs one frame and the added latency is bounded by the window.
+//
+// The heartbeat interval backs off in steps as bus load rises and recovers
+// with hysteresis as it falls; change events are never delayed by it.
+
+// Heartbeat interval used once bus load reaches enterPermille, kept until
+// load drops below exitPermille
+struct HeartbeatStep {
+  uint16_t enterPermille;
+  uint16_t exitPermille;
+  uint32_t heartbeatMs;
+};
+
+class DoorReporter {
+public:
+  static const uint8_t SEND_EVENT = 0x01;
+  static const uint8_t SEND_HEARTBEAT = 0x02;
+
+  // The first update() after begin() sends a heartbeat
+  void begin(uint16_t initialState, uint32_t heartbeatMs);
+
+  // Returns the SEND_* frames due for this state; frames carry lastState()
+  uint8_t update(uint16_t state, uint32_t nowMs);
+
+  // Time until update() next has a frame due without a further change
+  uint32_t msUntilDue(uint32_t nowMs) const;
+
+  // Coalescing window from the first change, 0 sends every change at once
+  void setCoalesceWindow(uint32_t windowMs) { coalesceMs = windowMs; }
+
+  // Optional load steps, ascending; steps[0] applies at any load
+  void setBackoff(const HeartbeatStep *steps, uint8_t count);
+
+  // Select the heartbeat step for this bus load, returns true if it changed
+  bool applyBusLoad(uint16_t loadPermille);
+
+  uint32_t heartbeatInterval() const { return heartbeatMs; }
+
+  uint16_t lastState() const { return reported; }
+
+  // Bytes 0-3 of event and heartbeat frames: door state (bit n = RSW(n+1)
+  // open), then ms from the newest contact edge to the sample, saturating
+  // (0xFFFF also when lastEdgeUs is 0, no edge yet)
+  static void encodeStatus(uint16_t state, int64_t sampleUs, int64_t lastEdgeUs, uint8_t *data);
+
+  // Bytes 4-7, known once the frame is handed to the driver: sample-to-queue
+  // delay in us (saturating) and the low 16 bits of bus time at that point
+  static void encodeQueued(uint32_t delayUs, uint16_t queueBusUs, uint8_t *data);
+
+  // Statistics: debounced transitions seen, event frames sent, and the
+  // frames coalescing saved (transitions without a frame of their own)
+  uint32_t transitionCount() const { return transitions; }
+  uint32_t eventCount() const { return events; }
+  uint32_t savedCount() const { return transitions - events; }
+
+private:
+  uint16_t reported = 0;
+  uint16_t observed = 0;
+  uint32_t heartbeatMs = 0;
+  uint32_t lastTxMs = 0;
+  bool started = false;
+  uint32_t transitions = 0;
+  uint32_t events = 0;
+
+  uint32_t coalesceMs = 0;
+  bool windowOpen = false;
+  uint32_t windowStartMs = 0;
+
+  const HeartbeatStep *steps = nullptr;
+  uint8_t stepCount = 0;
+  uint8_t step = 0;
+};
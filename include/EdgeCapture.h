@@ -0,0 +1,49 @@
+#pragma once
+
+#include <Arduino.h>
+#include <driver/gpio.h>
+
+// =============================================================================
+// ETM Hardware Edge Timestamping
+// =============================================================================
+//
+// Routes reed switch GPIO edges through the ESP32-C6 Event Task Matrix to a
+// 1 MHz general-purpose timer capture task. The capture register latches the
+// time of the most recent edge without any CPU or ISR involvement, so the
+// timestamp stays accurate even if the core is busy in a TWAI callback or a
+// flash write when the edge happens.
+//
+// The capture register is shared: it holds the newest edge on any covered
+// channel, with no record of which one. attribute(), called at every reed
+// sample, credits a new capture to a channel only when that channel was the
+// only covered one to move since the previous sample. Otherwise the channels
+// that moved lose their hardware time until their next unambiguous edge and
+// the caller falls back to software timestamps.
+
+class EdgeCapture {
+public:
+  // The C6 GPIO ETM block provides 8 event channels
+  static const uint8_t MAX_CHANNELS = 8;
+
+  // Route edges of pins[0..count-1] to the capture timer. Channels past
+  // MAX_CHANNELS are not covered. Returns the number of channels covered.
+  static uint8_t begin(const gpio_num_t* pins, uint8_t count);
+
+  // Bit n set if pins[n] is timestamped in hardware
+  static uint16_t coveredMask();
+
+  // Time of the most recent captured edge on any covered channel in
+  // esp_timer microseconds, or -1 if no edge has been captured yet. Read it
+  // before sampling the pins, so an edge landing in between shows up as a
+  // moved channel without a new capture rather than the other way round.
+  static int64_t capturedUs();
+
+  // Credit capturedUs (from this sample) to a channel. movedMask has bit n
+  // set for each covered channel whose level changed or whose edge
+  // interrupt fired since the previous sample.
+  static void attribute(int64_t capturedUs, uint16_t movedMask);
+
+  // Newest edge credited to channel, or -1 if its latest edge could not be
+  // told apart from another channel's
+  static int64_t lastEdgeUs(uint8_t channel);
+};
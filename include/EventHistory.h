@@ -0,0 +1,62 @@
+#pragma once
+
+#include <Arduino.h>
+#include "TwaiTaskBased.h"
+
+// =============================================================================
+// Door Event History
+// =============================================================================
+//
+// Keeps the most recent confirmed door changes in RAM, encoded by EventLog
+// (4 KB ring of 128-byte blocks, roughly 1300 changes at 3 bytes each), and
+// drains them over CAN on request. Each block carries its own checkpoint, so
+// the host reads only the blocks it needs, in any order.
+//
+// Command frame (host -> module), byte 0 = target mask (bit n = DIP address n):
+//   STATUS  [mask, 0x01]
+//   READ    [mask, 0x02, block]
+//
+// Reply frame (module -> host):
+//   STATUS  [0x81, blocks, used, current, events 4 bytes LE]
+//   data    [index, 7 bytes]                   index 0-18 within the block
+//   END     [0x83, block, crc_lo, crc_hi, empty]  CRC-16 of the block
+//   ERROR   [0x8F, code]
+//
+// The block is copied when READ arrives; its data frames are sent from the
+// main loop, one per millisecond, so door frames never queue behind them.
+
+class EventHistory {
+public:
+  static const uint16_t BLOCK_COUNT = 32;
+  static const uint8_t FRAME_PAYLOAD = 7;
+
+  enum Command : uint8_t {
+    CMD_STATUS = 0x01,
+    CMD_READ = 0x02,
+  };
+
+  enum Status : uint8_t {
+    STATUS_STATUS = 0x81,
+    STATUS_END = 0x83,
+    STATUS_ERROR = 0x8F,
+  };
+
+  enum Error : uint8_t {
+    ERR_BUSY = 0x01,
+    ERR_RANGE = 0x02,
+  };
+
+  // dipAddress selects the target mask bit, replyId is this module's reply
+  // ID; the history starts from state at timeMs (bus time)
+  static void begin(uint8_t dipAddress, uint32_t replyId, uint16_t state, uint64_t timeMs);
+
+  // A confirmed change of channel at timeMs (bus time, main loop)
+  static void record(uint8_t channel, bool open, uint64_t timeMs);
+
+  // Called from the CAN receive callback - never blocks
+  static void handleCommand(const twai_message_t& msg);
+
+  // Sends the next frame of a pending READ (main loop)
+  static void service(unsigned long nowMs);
+  static bool draining();
+};
@@ -0,0 +1,68 @@
+#pragma once
+
+#include <stdint.h>
+
+// =============================================================================
+// Door Event History Encoding
+// =============================================================================
+//
+// Keeps confirmed door changes in a ring of fixed-size blocks in caller
+// memory, oldest block overwritten. A fixed record (channel, state, 32-bit
+// time) spends 6-8 bytes on what is one changed bit a few seconds after the
+// previous one; here a change mostly costs 3 bytes.
+//
+// Every block starts with a checkpoint, so any block decodes on its own and
+// a reader can fetch blocks in any order:
+//
+//   checkpoint  sequence (4), time ms (6), full door state (2)   little-endian
+//   records until a header byte of 0xFF (erased)
+//
+// Record:
+//   header    bits 7-4 channel (0-14), bit 3 new state (1 = open),
+//             bits 2-0 run: this many further changes of the same channel
+//             follow, each the opposite state of the one before
+//   varints   run + 1 times: ms since the previous change in the block
+//             (LEB128); the block's first change counts from the checkpoint
+//
+// A chattering channel therefore costs about one byte per change.
+
+class EventLog {
+public:
+  static const uint8_t BLOCK_SIZE = 128;
+  static const uint8_t HEADER_SIZE = 12;
+  static const uint8_t MAX_CHANNELS = 15;
+  static const uint8_t MAX_RUN = 7;
+  static const uint8_t END = 0xFF;
+
+  // storage holds blockCount * BLOCK_SIZE bytes; the first block is opened
+  // with a checkpoint of state at timeMs
+  void begin(uint8_t* storage, uint16_t blockCount, uint16_t state, uint64_t timeMs);
+
+  // Channel changed to open/closed at timeMs (earlier times are clamped)
+  void append(uint8_t channel, bool open, uint64_t timeMs);
+
+  uint16_t blockCount() const { return blocks; }
+  uint16_t usedBlocks() const { return used; }
+  uint16_t currentBlock() const { return current; }
+  const uint8_t* block(uint16_t index) const { return &storage[(uint32_t)index * BLOCK_SIZE]; }
+
+  // Statistics: changes appended, and record bytes they took
+  uint32_t eventCount() const { return events; }
+  uint32_t encodedBytes() const { return bytes; }
+
+private:
+  void openBlock(uint64_t timeMs);
+  uint8_t putVarint(uint64_t value);
+
+  uint8_t* storage = nullptr;
+  uint16_t blocks = 0;
+  uint16_t used = 0;
+  uint16_t current = 0;
+  uint32_t sequence = 0;
+  uint8_t length = 0;      // Bytes in use in the current block
+  int16_t runHeader = -1;  // Offset of the record a change may extend
+  uint16_t state = 0;
+  uint64_t lastMs = 0;
+  uint32_t events = 0;
+  uint32_t bytes = 0;
+};
@@ -0,0 +1,45 @@
+#pragma once
+
+#include <Arduino.h>
+#include <driver/gpio.h>
+
+// =============================================================================
+// Flash Write Stall Isolation
+// =============================================================================
+//
+// SPI flash erase and write turn the instruction cache off. On the single-core
+// C6 every task stops with it - the loop, the debouncer, the TWAI receive task
+// - and only interrupt handlers flagged IRAM keep running, for up to a sector
+// erase (tens of ms) at a time.
+//
+// Two pieces keep door sampling honest across that window:
+//   - An IRAM any-edge interrupt on each HP reed input latches the time of
+//     the newest edge per channel into DRAM. Polling resumes after the stall
+//     and confirms the change as usual, but the change is stamped with the
+//     edge time rather than the late sample time.
+//   - Every flash write or erase in the firmware is bracketed by
+//     beginWrite()/endWrite(). sample(), called at each reed sample, measures
+//     the gap since the previous sample and keeps the longest gap that
+//     overlapped a flash operation apart from the longest gap overall, with
+//     the number of edges the interrupt latched meanwhile.
+
+class FlashStall {
+public:
+  static const uint8_t MAX_CHANNELS = 16;
+
+  // Latch edges of pins[0..count-1] from an IRAM interrupt. Returns the
+  // number of channels covered (0 if the IRAM ISR service is unavailable).
+  static uint8_t begin(const gpio_num_t* pins, uint8_t count);
+
+  // Time of the newest edge on channel in esp_timer microseconds, or -1 if
+  // none has been latched
+  static int64_t lastEdgeUs(uint8_t channel);
+
+  // Bracket a flash erase or write (any task, may nest)
+  static void beginWrite();
+  static void endWrite();
+
+  // Called at every reed sample with its esp_timer time. Logs each new
+  // longest gap that overlapped a flash operation.
+  static void sample(int64_t nowUs);
+};
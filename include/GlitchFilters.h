@@ -0,0 +1,29 @@
+#pragma once
+
+#include <Arduino.h>
+#include <driver/gpio.h>
+#include "ReedDebouncer.h"
+
+// =============================================================================
+// Hardware GPIO Glitch Filters
+// =============================================================================
+//
+// Programs the ESP32-C6 glitch filters in front of each reed input so EMI
+// spikes are rejected before they reach the GPIO matrix, interrupts or the
+// light-sleep GPIO wakeup. The 8 flexible filters (configurable window) are
+// handed out in channel order; remaining channels fall back to the fixed
+// 2-clock pin glitch filter. Only HP GPIO paths are filtered - inputs routed
+// to the LP core bypass the GPIO matrix.
+
+class GlitchFilters {
+public:
+  // Longest window the flexible filters can be programmed for
+  static const uint16_t MAX_WINDOW_NS = 800;
+
+  // Apply config[i].glitchFilterNs to pins[i]. Returns filters enabled.
+  static uint8_t apply(const gpio_num_t* pins, const ReedChannelConfig* config,
+                       uint8_t count);
+
+  // Disable and release every filter created by apply()
+  static void release();
+};
@@ -0,0 +1,51 @@
+#pragma once
+
+#include <Arduino.h>
+
+// =============================================================================
+// Status LED Health Patterns
+// =============================================================================
+//
+// Drives the built-in WS2812 through the RMT peripheral. A color change is
+// one 24-symbol asynchronous RMT write: the CPU fills the symbols and returns,
+// the RMT shifts the bits out (30 us) and the pixel holds the color on its
+// own. A solid pattern costs nothing after it is shown; a blinking pattern
+// costs one esp_timer callback and one write per step.
+//
+// Patterns, highest priority first (chosen by the main loop):
+//   UPDATE      blue, fast blink          CAN firmware update in progress
+//   BUS_OFF     red, solid                TWAI controller bus-off
+//   TX_FAILING  red, blink                transmissions not acknowledged
+//   FAULT       amber, blink              wiring fault or chattering channel
+//   CONFIG      white, three flashes      configuration or rules just applied
+//   CAPTURE     cyan, solid               bus sniffer recording
+//   OK          green, solid
+//
+// The WiFi update path drives the pixel itself through RgbLed; suspend() and
+// resume() hand the pin over around it.
+
+class HealthLed {
+public:
+  enum Pattern : uint8_t {
+    PATTERN_OFF,
+    PATTERN_OK,
+    PATTERN_CAPTURE,
+    PATTERN_CONFIG,
+    PATTERN_FAULT,
+    PATTERN_TX_FAILING,
+    PATTERN_BUS_OFF,
+    PATTERN_UPDATE,
+    PATTERN_COUNT,
+  };
+
+  // brightnessPercent scales every color (the pixel is very bright)
+  static bool begin(uint8_t pin, uint8_t brightnessPercent);
+
+  // Switch pattern; showing the current pattern again does nothing
+  static void show(Pattern pattern);
+  static Pattern current();
+
+  // Release the pin to another driver and take it back
+  static void suspend();
+  static void resume();
+};
@@ -0,0 +1,53 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+// =============================================================================
+// Compressed / Delta Firmware Block Codec
+// =============================================================================
+//
+// Each transfer block decodes on its own into at most MAX_OUTPUT bytes of
+// image at a known offset, so blocks can still arrive in any order
+// (multicast) and RAM stays bounded to one input block plus one output chunk.
+//
+// Block layout:
+//   [format, out_offset (3 bytes LE), out_length (2 bytes LE), body...]
+//
+// FORMAT_RAW body is the image bytes. FORMAT_LZ body is a sequence of ops,
+// each a token byte (kind in bits 7-6, count in bits 5-0; a count of 63 is
+// followed by a varint to add) and its operands:
+//   00 literal      count+1 bytes follow
+//   01 copy-output  count+3 bytes from varint distance back in this chunk
+//   10 copy-source  count+3 bytes from the running image at
+//                   (out_offset + position + zigzag varint delta)
+// Copy-source ops only appear in delta images built against the running slot.
+// Trailing padding after out_length bytes have been produced is ignored.
+
+class ImageCodec {
+public:
+  static const uint8_t HEADER_SIZE = 6;
+  static const uint16_t MAX_OUTPUT = 4096;
+
+  enum Format : uint8_t {
+    FORMAT_RAW = 0,
+    FORMAT_LZ = 1,
+  };
+
+  struct Header {
+    uint8_t format;
+    uint32_t outOffset;
+    uint16_t outLength;
+  };
+
+  // Reads length bytes of the delta base image at offset into dst
+  typedef bool (*SourceReader)(uint32_t offset, uint8_t* dst, uint16_t length,
+                               void* context);
+
+  static bool parseHeader(const uint8_t* in, size_t inLength, Header& header);
+
+  // Decode one block into out (MAX_OUTPUT bytes). source may be null when no
+  // delta base is available; copy-source ops then fail the decode.
+  static bool decode(const uint8_t* in, size_t inLength, uint8_t* out,
+                     Header& header, SourceReader source, void* context);
+};
@@ -0,0 +1,42 @@
+#pragma once
+
+#include <Arduino.h>
+#include <driver/gpio.h>
+
+// =============================================================================
+// LP Core Reed Switch Sampler (HP core side)
+// =============================================================================
+//
+// Loads the ulp/ program onto the ESP32-C6 LP RISC-V core, which samples and
+// debounces the LP-capable reed inputs (GPIO0-GPIO7) while the HP core sits in
+// light sleep. The HP core wakes only on a confirmed change, a heartbeat timer
+// or a level change on one of the remaining HP-only inputs.
+//
+// Built only by env:esp32-c6-devkitm-1-lp (RSW_LP_CORE=1), which embeds the
+// ulp/ program through src/CMakeLists.txt.
+
+#if RSW_LP_CORE
+
+class LpCoreSampler {
+public:
+  // Configure LP IO pins and start the LP program. lpPins must be GPIO0-GPIO7.
+  static bool begin(const gpio_num_t* lpPins, uint8_t lpCount,
+                    uint32_t samplePeriodMs, uint32_t debounceMs);
+
+  // Debounced LP pin state, bit n = lpPins[n] HIGH (door open)
+  static uint16_t state();
+
+  // True (once) if the LP core confirmed a change since the last call
+  static bool takeChange();
+
+  // Number of samples taken by the LP core since begin()
+  static uint32_t sampleCount();
+
+  // Light-sleep the HP core for up to sleepMs. HP-only pins in hpPins wake the
+  // core when they leave the levels given in hpLevels (bit n = hpPins[n] HIGH).
+  // Pass hpCount = 0 to sleep on the timer and LP core only.
+  static void lightSleep(uint32_t sleepMs, const gpio_num_t* hpPins,
+                         uint8_t hpCount, uint16_t hpLevels);
+};
+
+#endif
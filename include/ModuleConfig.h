@@ -0,0 +1,62 @@
+#pragma once
+
+#include <stdint.h>
+#include "DoorReporter.h"
+
+// =============================================================================
+// Module Configuration Blob
+// =============================================================================
+//
+// The runtime parameters pushed over CAN (see ConfigUpdate.h) in a versioned,
+// compact little-endian encoding:
+//
+//   0      version (1)
+//   1-2    enabled channel mask (bit n = RSW(n+1))
+//   3-4    debounce ms              5-6    glitch filter ns
+//   7-8    heartbeat ms             9      coalescing window ms
+//   10-15  back-off step 1: enter permille, exit permille, heartbeat ms
+//   16-21  back-off step 2: enter permille, exit permille, heartbeat ms
+//   22-27  wiring alarm thresholds: short, closed, open max mV
+//
+// Later versions may only append fields; a decoder accepts a longer blob of
+// its own layout and ignores the tail.
+
+struct ModuleConfig {
+  // Reed switch channels the enabled mask covers
+  static const uint8_t CHANNELS = 10;
+
+  uint16_t enabledMask;
+  uint16_t debounceMs;
+  uint16_t glitchFilterNs;
+  uint16_t heartbeatMs;
+  uint8_t coalesceMs;
+  uint16_t backoffEnterPermille[2];
+  uint16_t backoffExitPermille[2];
+  uint16_t backoffHeartbeatMs[2];
+  uint16_t wiringShortMaxMv;
+  uint16_t wiringClosedMaxMv;
+  uint16_t wiringOpenMaxMv;
+};
+
+// Runtime configuration until a blob is stored (see ConfigUpdate.h); the
+// golden trace replay runs with the same back-off steps
+extern const ModuleConfig DEFAULT_CONFIG;
+
+class ModuleConfigCodec {
+public:
+  static const uint8_t VERSION = 1;
+  static const uint8_t ENCODED_SIZE = 28;
+
+  // Writes ENCODED_SIZE bytes
+  static void encode(const ModuleConfig& config, uint8_t* out);
+
+  // Decodes and range-checks; false leaves config untouched
+  static bool decode(const uint8_t* in, uint8_t length, ModuleConfig& config);
+
+  static bool valid(const ModuleConfig& config);
+
+  // Heartbeat steps for DoorReporter::setBackoff(): steps[0] the unloaded
+  // interval, then the back-off steps. Fills and returns HEARTBEAT_STEPS.
+  static const uint8_t HEARTBEAT_STEPS = 3;
+  static uint8_t heartbeatSteps(const ModuleConfig& config, HeartbeatStep* steps);
+};
@@ -0,0 +1,48 @@
+#pragma once
+
+#include <stdint.h>
+
+// =============================================================================
+// Reed Switch Channel Configuration and Debounce
+// =============================================================================
+//
+// Hardware glitch filters reject sub-microsecond EMI spikes before they reach
+// the GPIO matrix; this debouncer only handles the much longer mechanical
+// bounce of the reed contacts.
+
+struct ReedChannelConfig {
+  bool enabled;             // Disabled channels always report closed (0)
+  uint16_t glitchFilterNs;  // Hardware glitch filter window, 0 = no filter
+  uint16_t debounceMs;      // Software debounce for mechanical bounce
+};
+
+class ReedDebouncer {
+public:
+  static const uint8_t MAX_CHANNELS = 16;
+
+  // Adopt initialRaw as the debounced state without waiting for debounce
+  void begin(const ReedChannelConfig* config, uint8_t count,
+             uint16_t initialRaw, uint32_t nowMs);
+
+  // Feed a raw sample (bit n = channel n HIGH/open), returns debounced state
+  uint16_t update(uint16_t raw, uint32_t nowMs);
+
+  uint16_t state() const { return debounced; }
+  uint16_t lastRaw() const { return raw; }
+
+  // Time of the most recent raw edge seen on a channel
+  uint32_t lastEdgeMs(uint8_t channel) const { return edgeMs[channel]; }
+
+  // True while any enabled channel's raw level differs from its debounced one
+  bool settling() const { return ((raw ^ debounced) & enabledMask()) != 0; }
+
+  uint16_t enabledMask() const;
+  uint8_t channelCount() const { return count; }
+
+private:
+  const ReedChannelConfig* config = nullptr;
+  uint8_t count = 0;
+  uint16_t debounced = 0;
+  uint16_t raw = 0;
+  uint32_t edgeMs[MAX_CHANNELS] = {};
+};
@@ -0,0 +1,119 @@
+#pragma once
+
+#include <stdint.h>
+
+// =============================================================================
+// Derived-Signal Rule Engine
+// =============================================================================
+//
+// Evaluates up to MAX_RULES boolean rules over the door channel bits, bits of
+// frames received from other nodes (signals) and hold timers, so consumers
+// get "all cabinets latched" or "cabinet open while driving" as one derived
+// bit instead of decoding every module's door stream.
+//
+// Rules arrive as a program compiled on the host (tools/rule_compile.py),
+// which folds channel terms into precomputed masks:
+//
+//   0      version (1)
+//   1      signal count S, then S x [id_lo, id_hi, byte, mask]
+//          signal n = (data[byte] & mask) != 0 of the last frame on id
+//   ...    rule count R, then R x [length, bytecode]
+//
+// Bytecode is a boolean stack machine, one result left per rule:
+//   CHANNEL  [0x01, n]                 channel n open
+//   SIGNAL   [0x02, n]                 signal n set
+//   RULE     [0x03, n]                 result of earlier rule n
+//   ANY_OPEN [0x04, mask_lo, mask_hi]  any channel in mask open
+//   ALL_OPEN [0x05, mask_lo, mask_hi]  every channel in mask open
+//   NOT/AND/OR/XOR [0x10-0x13]
+//   HELD     [0x20, timer, ms_lo, ms_hi]  top has been true for ms
+//
+// Evaluation is incremental: a rule runs again only when a channel, signal or
+// earlier rule it reads has changed, or one of its hold timers expires.
+
+class RuleEngine {
+public:
+  static const uint8_t VERSION = 1;
+  static const uint8_t MAX_PROGRAM = 128;
+  static const uint8_t MAX_SIGNALS = 8;
+  static const uint8_t MAX_RULES = 8;
+  static const uint8_t MAX_TIMERS = 8;
+  static const uint8_t MAX_STACK = 16;
+  static const uint8_t MAX_CHANNELS = 16;
+
+  enum Op : uint8_t {
+    OP_CHANNEL = 0x01,
+    OP_SIGNAL = 0x02,
+    OP_RULE = 0x03,
+    OP_ANY_OPEN = 0x04,
+    OP_ALL_OPEN = 0x05,
+    OP_NOT = 0x10,
+    OP_AND = 0x11,
+    OP_OR = 0x12,
+    OP_XOR = 0x13,
+    OP_HELD = 0x20,
+  };
+
+  // Structure, operand ranges and stack depth of every rule; rules may only
+  // read earlier rules and each hold timer belongs to one HELD
+  static bool validate(const uint8_t* program, uint8_t length);
+
+  // Validates and installs a program; false keeps the current one
+  bool load(const uint8_t* program, uint8_t length);
+  void clear();
+
+  // Feed every received frame; true if it changed a signal
+  bool onFrame(uint32_t id, const uint8_t* data, uint8_t dlc);
+
+  // Re-evaluates the rules affected since the last call, returns true if
+  // any result changed
+  bool update(uint16_t channels, uint32_t nowMs);
+
+  // Time until a hold timer expires, UINT32_MAX when none is running
+  uint32_t msUntilDue(uint32_t nowMs) const;
+
+  uint8_t results() const { return resultBits; }
+  uint8_t ruleMask() const { return ruleCount ? (uint8_t)((1 << ruleCount) - 1) : 0; }
+
+  // Statistics: update() calls and rule evaluations they needed
+  uint32_t updateCount() const { return updates; }
+  uint32_t evaluationCount() const { return evaluations; }
+
+private:
+  struct Signal {
+    uint16_t id;
+    uint8_t byte;
+    uint8_t mask;
+  };
+
+  struct Rule {
+    uint8_t offset;
+    uint8_t length;
+    uint16_t channelDeps;
+    uint8_t signalDeps;
+    uint8_t ruleDeps;
+    uint8_t timerMask;
+  };
+
+  bool evaluate(const Rule& rule, uint16_t channels, uint32_t nowMs);
+
+  uint8_t code[MAX_PROGRAM];
+  Signal signals[MAX_SIGNALS];
+  Rule rules[MAX_RULES];
+  uint8_t signalCount = 0;
+  uint8_t ruleCount = 0;
+
+  uint8_t signalBits = 0;
+  uint8_t changedSignals = 0;
+  uint16_t lastChannels = 0;
+  uint8_t resultBits = 0;
+  bool started = false;
+
+  uint8_t timerRunning = 0;
+  uint8_t timerExpired = 0;
+  uint32_t timerStartMs[MAX_TIMERS];
+  uint16_t timerMs[MAX_TIMERS];
+
+  uint32_t updates = 0;
+  uint32_t evaluations = 0;
+};
@@ -0,0 +1,107 @@
+#pragma once
+
+#include <Arduino.h>
+#include <debug.h>
+#include <string.h>
+#include <type_traits>
+
+// =============================================================================
+// Deferred Tokenized Logging
+// =============================================================================
+//
+// tlogf() replaces debugf() on timing-sensitive paths. The format string is
+// placed in the non-allocated .tokenlog ELF section, so it never reaches
+// flash; its offset in that section is the token. At the call site only the
+// token, a timestamp and the raw argument words are copied into a lock-free
+// ring (tens of cycles, no formatting, no USB CDC). A low-priority task
+// drains the ring to the serial port as binary records that
+// tools/tokenlog_decode.py turns back into text using firmware.elf.
+//
+// Argument encoding follows the C++ argument type, so it must match the
+// conversion as with printf: integers up to 32 bits take one word, 64-bit
+// integers and floating point (as double) take two, and strings are copied
+// as a length word plus up to MAX_STRING bytes.
+//
+// Serial record: 0xFE 'T' <words> then <words> 32-bit little-endian words:
+//   token, timestamp (esp_timer microseconds, low 32 bits), arguments...
+//
+// With DEBUG == 0 tlogf() compiles to nothing, like debugf(); its arguments
+// still appear in an unevaluated sizeof so locals that only feed the log do
+// not warn as unused.
+
+// The section flags are overridden to "" (not allocated). The trailing '#'
+// comments out the flags GCC appends to the .section directive.
+#define TOKENLOG_SECTION __attribute__((section(".tokenlog,\"\",@progbits #"), used))
+
+#if DEBUG == 0
+#define tlogf(fmt, ...) do { (void)sizeof(TokenLog::unused(fmt, ##__VA_ARGS__)); } while (0)
+#else
+#define tlogf(fmt, ...)                                   \
+  do {                                                    \
+    static const char tlogFormat[] TOKENLOG_SECTION = fmt; \
+    TokenLog::write(tlogFormat, ##__VA_ARGS__);           \
+  } while (0)
+#endif
+
+class TokenLog {
+public:
+  static const uint32_t RING_WORDS = 1024;   // Power of two
+  static const uint8_t MAX_ARG_WORDS = 16;
+  static const uint8_t MAX_STRING = 32;
+
+  // Start the drain task
+  static void begin();
+
+  // Records lost because the ring was full
+  static uint32_t dropped();
+
+  // Declared only, for the disabled tlogf() to reference its arguments
+  template <typename... Args>
+  static int unused(const char *format, const Args &...args);
+
+  template <typename... Args>
+  static void write(const char *format, Args... args) {
+    if constexpr (sizeof...(Args) == 0) {
+      commit((uint32_t)(uintptr_t)format, nullptr, 0);
+    } else {
+      uint32_t words[MAX_ARG_WORDS];
+      uint8_t count = 0;
+      (encode(words, count, args), ...);
+      commit((uint32_t)(uintptr_t)format, words, count);
+    }
+  }
+
+private:
+  template <typename T>
+  static void encode(uint32_t *words, uint8_t &count, T value) {
+    if constexpr (std::is_floating_point<T>::value) {
+      double d = value;
+      uint64_t bits;
+      memcpy(&bits, &d, sizeof(bits));
+      encode(words, count, bits);
+    } else if constexpr (std::is_pointer<T>::value) {
+      encodePointer(words, count, value);
+    } else if constexpr (sizeof(T) > 4) {
+      if (count + 2 > MAX_ARG_WORDS) return;
+      words[count++] = (uint32_t)(uint64_t)value;
+      words[count++] = (uint32_t)((uint64_t)value >> 32);
+    } else {
+      if (count + 1 > MAX_ARG_WORDS) return;
+      words[count++] = (uint32_t)value;
+    }
+  }
+
+  template <typename T>
+  static void encodePointer(uint32_t *words, uint8_t &count, T *value) {
+    if constexpr (std::is_same<typename std::remove_cv<T>::type, char>::value) {
+      encodeString(words, count, value);
+    } else {
+      if (count + 1 > MAX_ARG_WORDS) return;
+      words[count++] = (uint32_t)(uintptr_t)value;
+    }
+  }
+
+  static void encodeString(uint32_t *words, uint8_t &count, const char *value);
+  static void commit(uint32_t token, const uint32_t *args, uint8_t count);
+  static void drainTask(void *param);
+};
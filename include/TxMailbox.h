@@ -0,0 +1,63 @@
+#pragma once
+
+#include <stdint.h>
+
+// =============================================================================
+// Latest-Value Transmit Mailbox
+// =============================================================================
+//
+// Periodic state frames are posted here instead of straight to the driver
+// queue. A newer frame on the same CAN ID replaces an unsent older one in
+// place, and only one frame is handed to the driver at a time, so a busy or
+// error-passive bus never builds a backlog of stale states: the first frame
+// out after recovery is always the current one.
+//
+// A frame is in flight from next() until transmitted() or the in-flight
+// timeout, which covers completions the driver never reports (bus-off). The
+// firmware only lets next() give a frame up once overdue() and the driver has
+// nothing left queued, so the lost frame is never sent twice.
+
+struct CanFrame {
+  uint32_t id;
+  uint8_t dlc;
+  uint8_t data[8];
+  uint32_t sampleUs;  // When the payload was sampled, for age fields
+};
+
+class TxMailbox {
+public:
+  static const uint8_t MAX_SLOTS = 4;
+  static const uint32_t IN_FLIGHT_TIMEOUT_MS = 50;
+
+  // Store the latest value for frame.id, false if all slots hold other IDs
+  bool post(const CanFrame &frame);
+
+  // Frame to hand to the driver now, lowest pending ID first. Returns false
+  // while a frame is in flight or nothing is pending.
+  bool next(uint32_t nowMs, CanFrame &frame);
+
+  // Driver completion for the in-flight frame. A failed frame is retried
+  // unless a newer value has been posted meanwhile.
+  void transmitted(bool ok);
+
+  bool busy() const;
+
+  // A frame has been in flight for IN_FLIGHT_TIMEOUT_MS or more
+  bool overdue(uint32_t nowMs) const;
+
+  uint32_t replacedCount() const { return replaced; }
+  uint32_t timeoutCount() const { return timeouts; }
+
+private:
+  struct Slot {
+    bool used;
+    bool pending;
+    CanFrame frame;
+  };
+
+  Slot slots[MAX_SLOTS] = {};
+  int8_t inFlight = -1;
+  uint32_t inFlightSinceMs = 0;
+  uint32_t replaced = 0;
+  uint32_t timeouts = 0;
+};
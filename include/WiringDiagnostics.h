@@ -0,0 +1,53 @@
+#pragma once
+
+#include <Arduino.h>
+#include <driver/gpio.h>
+
+// =============================================================================
+// Reed Input Wiring Diagnostics (ADC continuous mode)
+// =============================================================================
+//
+// With an end-of-line (EOL) resistor scheme each reed loop has four distinct
+// voltages against the internal pull-up:
+//
+//   short-to-ground   ~0 V      wiring shorted to chassis/ground
+//   closed            low       reed closed, series resistor to ground
+//   open              high      reed open, EOL resistor across the loop
+//   open-circuit      ~VDD      cut wire or unplugged connector
+//
+// The ADC samples the ADC1-capable inputs in continuous DMA mode. The CPU
+// only touches whole DMA frames - one burst per diagnostic interval - never
+// individual samples. Between bursts the ADC is stopped.
+
+enum WiringStatus : uint8_t {
+  WIRING_CLOSED = 0,
+  WIRING_OPEN = 1,
+  WIRING_SHORT = 2,
+  WIRING_OPEN_CIRCUIT = 3,
+};
+
+struct WiringThresholds {
+  uint16_t shortMaxMv;   // Below this: short-to-ground
+  uint16_t closedMaxMv;  // Below this: closed
+  uint16_t openMaxMv;    // Below this: open, above: open-circuit
+};
+
+class WiringDiagnostics {
+public:
+  // Configure continuous sampling on the ADC1-capable pins among pins[].
+  // Returns a bitmask of channels (index into pins) that are monitored.
+  static uint16_t begin(const gpio_num_t* pins, uint8_t count,
+                        const WiringThresholds& thresholds);
+
+  // Replace the classification thresholds, effective from the next burst
+  static void setThresholds(const WiringThresholds& thresholds);
+
+  // Start one DMA burst in the background
+  static void startBurst();
+
+  // Non-blocking: once a burst has completed, classify it into status[]
+  // (indexed like pins, monitored channels only) and return true
+  static bool poll(WiringStatus* status);
+
+  static uint16_t monitoredMask();
+};
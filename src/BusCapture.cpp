@@ -0,0 +1,323 @@
+#include "BusCapture.h"
+#include "CanOta.h"
+#include "CanTx.h"
+#include "CaptureCodec.h"
+#include "FlashStall.h"
+#include "TokenLog.h"
+#include <esp_partition.h>
+#include <esp_timer.h>
+
+static const uint8_t FRAME_QUEUE_LENGTH = 128;
+static const uint16_t PAGE_SIZE = 256;
+static const uint32_t FLUSH_IDLE_MS = 1000;
+static const uint32_t IDLE_POLL_MS = 10;
+static const uint8_t SEGMENTS_PER_SECTOR = BusCapture::SECTOR_SIZE / BusCapture::SEGMENT_SIZE;
+
+enum JobType : uint8_t {
+  JOB_START,
+  JOB_STOP,
+  JOB_STATUS,
+  JOB_READ,
+};
+
+struct Job {
+  JobType type;
+  uint8_t sector;
+  uint8_t segment;
+};
+
+static const esp_partition_t* partition = nullptr;
+static uint16_t sectorCount = 0;
+static uint8_t targetBit = 0;
+static uint32_t replyId = 0;
+static bool (*reportingIdle)() = nullptr;
+static QueueHandle_t frameQueue = nullptr;
+static QueueHandle_t jobQueue = nullptr;
+
+static volatile bool capturing = false;
+static volatile uint32_t dropped = 0;  // This session, queue full
+
+// Writer state (capture task only)
+static CaptureEncoder encoder;
+static uint8_t sectorBuffer[BusCapture::SECTOR_SIZE];
+static uint8_t segmentBuffer[BusCapture::SEGMENT_SIZE];
+static bool sessionOpen = false;
+static uint16_t session = 0;
+static uint32_t sequence = 0;       // Next sector sequence number
+static uint16_t sectorIndex = 0;    // Physical sector being written
+static uint16_t ringNext = 0;       // Where the next session starts
+static int32_t erasedAhead = -1;    // Physical sector erased in advance
+static uint16_t flushed = 0;        // Bytes of sectorBuffer already in flash
+static uint16_t sectorsWritten = 0;
+static uint32_t droppedReported = 0;
+static uint32_t lastFlushMs = 0;
+
+static bool idleNow() {
+  return !reportingIdle || reportingIdle();
+}
+
+static void waitForIdle() {
+  while (!idleNow()) {
+    vTaskDelay(pdMS_TO_TICKS(IDLE_POLL_MS));
+  }
+}
+
+static bool eraseSector(uint16_t sector) {
+  // Erase stalls the flash cache for tens of ms - only while reporting is idle
+  waitForIdle();
+  FlashStall::beginWrite();
+  esp_err_t err = esp_partition_erase_range(partition, (uint32_t)sector * BusCapture::SECTOR_SIZE,
+                                            BusCapture::SECTOR_SIZE);
+  FlashStall::endWrite();
+  return err == ESP_OK;
+}
+
+// Write whole pages, or everything encoded so far when all is set. A page
+// program stops the flash cache too, so pages go out one at a time and only
+// while reporting is idle: a partial flush is skipped until then (the sector
+// buffer still holds the data), a full one waits.
+static void flush(bool all) {
+  uint16_t used = encoder.used();
+  uint16_t end = all ? used : flushed + (used - flushed) / PAGE_SIZE * PAGE_SIZE;
+  while (flushed < end) {
+    if (!all && !idleNow()) return;
+    waitForIdle();
+    uint16_t length = min((uint16_t)(end - flushed), (uint16_t)(PAGE_SIZE - flushed % PAGE_SIZE));
+    FlashStall::beginWrite();
+    esp_partition_write(partition, (uint32_t)sectorIndex * BusCapture::SECTOR_SIZE + flushed,
+                        &sectorBuffer[flushed], length);
+    FlashStall::endWrite();
+    flushed += length;
+    lastFlushMs = millis();
+  }
+}
+
+static void openSector(int64_t baseUs, uint16_t flags) {
+  if (erasedAhead != sectorIndex) eraseSector(sectorIndex);
+  erasedAhead = -1;
+  memset(sectorBuffer, 0xFF, sizeof(sectorBuffer));
+  encoder.beginSector(sectorBuffer, sizeof(sectorBuffer), sequence++, session, flags, baseUs);
+  flushed = 0;
+  if (sectorsWritten < sectorCount) sectorsWritten++;
+}
+
+static void nextSector(int64_t baseUs) {
+  flush(true);
+  sectorIndex = (sectorIndex + 1) % sectorCount;
+  openSector(baseUs, 0);
+}
+
+// Erase the next sector early, so the switch rarely has to wait for idle
+static void eraseAhead() {
+  uint16_t next = (sectorIndex + 1) % sectorCount;
+  if (erasedAhead == next || encoder.used() < BusCapture::SECTOR_SIZE / 2) return;
+  if (!reportingIdle || !reportingIdle()) return;
+  if (eraseSector(next)) erasedAhead = next;
+}
+
+static void store(const CapturedFrame& frame) {
+  uint32_t lost = dropped - droppedReported;
+  if (lost) {
+    if (!encoder.addMarker(CaptureEncoder::MARKER_DROPPED, lost)) {
+      nextSector(frame.timeUs);
+      encoder.addMarker(CaptureEncoder::MARKER_DROPPED, lost);
+    }
+    droppedReported += lost;
+  }
+  if (!encoder.add(frame)) {
+    nextSector(frame.timeUs);
+    encoder.add(frame);
+  }
+  flush(false);
+}
+
+static void startSession() {
+  if (sessionOpen) return;
+  session++;
+  dropped = 0;
+  droppedReported = 0;
+  sectorsWritten = 0;
+  sectorIndex = ringNext;
+  openSector(esp_timer_get_time(), CaptureEncoder::FLAG_SESSION_START);
+  sessionOpen = true;
+  tlogf("[CAP] Capture session %u started at sector %u", session, sectorIndex);
+}
+
+static void stopSession() {
+  if (!sessionOpen) return;
+  // Frames received before STOP are still part of the session
+  CapturedFrame frame;
+  while (xQueueReceive(frameQueue, &frame, 0) == pdTRUE) store(frame);
+  flush(true);
+  sessionOpen = false;
+  ringNext = (sectorIndex + 1) % sectorCount;
+  tlogf("[CAP] Capture session %u stopped: %u sectors, %lu frames dropped",
+        session, sectorsWritten, dropped);
+}
+
+static void readSegment(uint8_t sector, uint8_t segment) {
+  if (capturing || sessionOpen) {
+    CanTx::sendError(replyId, BusCapture::ERR_BUSY);
+    return;
+  }
+  if (sector >= sectorCount || segment >= SEGMENTS_PER_SECTOR) {
+    CanTx::sendError(replyId, BusCapture::ERR_RANGE);
+    return;
+  }
+  uint32_t offset = (uint32_t)sector * BusCapture::SECTOR_SIZE +
+                    (uint32_t)segment * BusCapture::SEGMENT_SIZE;
+  if (esp_partition_read(partition, offset, segmentBuffer, sizeof(segmentBuffer)) != ESP_OK) {
+    CanTx::sendError(replyId, BusCapture::ERR_FLASH);
+    return;
+  }
+
+  bool empty = true;
+  for (uint16_t i = 0; i < sizeof(segmentBuffer) && empty; i++) {
+    empty = segmentBuffer[i] == 0xFF;
+  }
+  if (!empty) {
+    twai_message_t msg = {};
+    msg.identifier = replyId;
+    for (uint16_t pos = 0, index = 0; pos < sizeof(segmentBuffer);
+         pos += BusCapture::FRAME_PAYLOAD, index++) {
+      uint8_t length = min((uint16_t)BusCapture::FRAME_PAYLOAD,
+                           (uint16_t)(sizeof(segmentBuffer) - pos));
+      msg.data_length_code = 1 + length;
+      msg.data[0] = (uint8_t)index;
+      memcpy(&msg.data[1], &segmentBuffer[pos], length);
+      CanTx::send(msg);
+      // One frame per tick, so a door frame never queues behind the download
+      vTaskDelay(1);
+    }
+  }
+
+  uint16_t crc = CanOta::crc16(segmentBuffer, sizeof(segmentBuffer));
+  uint8_t args[5] = { sector, segment, (uint8_t)(crc & 0xFF), (uint8_t)(crc >> 8),
+                      (uint8_t)(empty ? 1 : 0) };
+  CanTx::sendStatus(replyId, BusCapture::STATUS_END, args, sizeof(args));
+}
+
+static void runJob(const Job& job) {
+  switch (job.type) {
+    case JOB_START:
+      startSession();
+      break;
+    case JOB_STOP:
+      stopSession();
+      break;
+    case JOB_STATUS: {
+      uint32_t lost = dropped;
+      uint8_t args[7] = {
+        (uint8_t)(capturing ? 1 : 0),
+        (uint8_t)(session & 0xFF), (uint8_t)(session >> 8),
+        (uint8_t)min(sectorsWritten, (uint16_t)0xFF),
+        (uint8_t)(lost & 0xFF), (uint8_t)((lost >> 8) & 0xFF), (uint8_t)((lost >> 16) & 0xFF),
+      };
+      CanTx::sendStatus(replyId, BusCapture::STATUS_STATUS, args, sizeof(args));
+      break;
+    }
+    case JOB_READ:
+      readSegment(job.sector, job.segment);
+      break;
+  }
+}
+
+static void captureTask(void* param) {
+  for (;;) {
+    Job job;
+    while (xQueueReceive(jobQueue, &job, 0) == pdTRUE) runJob(job);
+
+    CapturedFrame frame;
+    if (xQueueReceive(frameQueue, &frame, pdMS_TO_TICKS(100)) == pdTRUE) {
+      if (sessionOpen) store(frame);
+    } else if (sessionOpen && millis() - lastFlushMs >= FLUSH_IDLE_MS && idleNow()) {
+      // Quiet bus: get the partial page into flash
+      flush(true);
+    }
+    if (sessionOpen) eraseAhead();
+  }
+}
+
+bool BusCapture::begin(uint8_t dipAddress, uint32_t id, bool (*idle)()) {
+  targetBit = 1 << dipAddress;
+  replyId = id;
+  reportingIdle = idle;
+
+  partition = esp_partition_find_first(ESP_PARTITION_TYPE_DATA,
+                                       ESP_PARTITION_SUBTYPE_DATA_SPIFFS, nullptr);
+  if (!partition) return false;
+  sectorCount = partition->size / SECTOR_SIZE;
+
+  // Continue sequence and session numbers after the newest sector on flash
+  uint8_t header[CaptureEncoder::HEADER_SIZE];
+  bool found = false;
+  for (uint16_t i = 0; i < sectorCount; i++) {
+    if (esp_partition_read(partition, (uint32_t)i * SECTOR_SIZE, header, sizeof(header)) != ESP_OK) {
+      continue;
+    }
+    uint32_t magic = header[0] | (header[1] << 8) | ((uint32_t)header[2] << 16) |
+                     ((uint32_t)header[3] << 24);
+    if (magic != CaptureEncoder::MAGIC) continue;
+    uint32_t seq = header[4] | (header[5] << 8) | ((uint32_t)header[6] << 16) |
+                   ((uint32_t)header[7] << 24);
+    if (!found || seq >= sequence) {
+      sequence = seq + 1;
+      session = header[8] | (header[9] << 8);
+      ringNext = (i + 1) % sectorCount;
+      found = true;
+    }
+  }
+
+  frameQueue = xQueueCreate(FRAME_QUEUE_LENGTH, sizeof(CapturedFrame));
+  jobQueue = xQueueCreate(4, sizeof(Job));
+  xTaskCreate(captureTask, "capture", 4096, nullptr, 1, nullptr);
+  return true;
+}
+
+void BusCapture::record(const twai_message_t& msg, int64_t rxUs) {
+  if (!capturing) return;
+  CapturedFrame frame;
+  frame.timeUs = rxUs;
+  frame.id = msg.identifier;
+  frame.extended = msg.extd;
+  frame.rtr = msg.rtr;
+  frame.dlc = msg.data_length_code;
+  memcpy(frame.data, msg.data, sizeof(frame.data));
+  if (xQueueSend(frameQueue, &frame, 0) != pdTRUE) dropped++;
+}
+
+void BusCapture::handleCommand(const twai_message_t& msg) {
+  if (msg.data_length_code < 2 || !(msg.data[0] & targetBit)) return;
+  if (!partition) {
+    CanTx::sendError(replyId, ERR_NO_PARTITION);
+    return;
+  }
+
+  Job job = {};
+  switch (msg.data[1]) {
+    case CMD_START:
+      capturing = true;
+      job.type = JOB_START;
+      break;
+    case CMD_STOP:
+      capturing = false;
+      job.type = JOB_STOP;
+      break;
+    case CMD_STATUS:
+      job.type = JOB_STATUS;
+      break;
+    case CMD_READ:
+      if (msg.data_length_code < 4) return;
+      job.type = JOB_READ;
+      job.sector = msg.data[2];
+      job.segment = msg.data[3];
+      break;
+    default:
+      return;
+  }
+  xQueueSend(jobQueue, &job, 0);
+}
+
+bool BusCapture::active() {
+  return capturing;
+}
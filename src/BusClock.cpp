@@ -0,0 +1,61 @@
+#include "BusClock.h"
+
+void BusClock::onSync(uint8_t seq, int64_t localUs) {
+  pending = true;
+  pendingSeq = seq;
+  pendingLocal = localUs;
+}
+
+bool BusClock::onFollowUp(uint8_t seq, int64_t masterUs) {
+  if (!pending || seq != pendingSeq) return false;
+  pending = false;
+
+  int64_t localUs = pendingLocal;
+
+  // Frequency: rate of the master against our clock between two SYNCs,
+  // smoothed with a 1/8 IIR so one late reception cannot swing it
+  if (havePrevious && localUs > previousLocal) {
+    int64_t localSpan = localUs - previousLocal;
+    int64_t masterSpan = masterUs - previousMaster;
+    int64_t measured = (masterSpan - localSpan) * 1000000000LL / localSpan;
+    if (measured > -MAX_DRIFT_PPB && measured < MAX_DRIFT_PPB) {
+      drift += (int32_t)((measured - drift) / 8);
+    }
+  }
+  havePrevious = true;
+  previousLocal = localUs;
+  previousMaster = masterUs;
+
+  // Phase: step on large errors, otherwise take a quarter of the error
+  if (!haveAnchor) {
+    anchorLocal = localUs;
+    anchorBus = masterUs;
+    haveAnchor = true;
+    lastError = 0;
+  } else {
+    int64_t predicted = predictBus(localUs);
+    lastError = masterUs - predicted;
+    anchorLocal = localUs;
+    if (lastError > STEP_THRESHOLD_US || lastError < -STEP_THRESHOLD_US) {
+      anchorBus = masterUs;
+    } else {
+      anchorBus = predicted + lastError / 4;
+    }
+  }
+
+  syncs++;
+  return true;
+}
+
+bool BusClock::synced(int64_t localUs) const {
+  return haveAnchor && (localUs - anchorLocal) < SYNC_TIMEOUT_US;
+}
+
+int64_t BusClock::toBusUs(int64_t localUs) const {
+  return haveAnchor ? predictBus(localUs) : localUs;
+}
+
+int64_t BusClock::predictBus(int64_t localUs) const {
+  int64_t elapsed = localUs - anchorLocal;
+  return anchorBus + elapsed + elapsed * drift / 1000000000LL;
+}
@@ -0,0 +1,42 @@
+#include "BusLoadMonitor.h"
+
+void BusLoadMonitor::begin(uint32_t bitrate, uint32_t nowMs) {
+  this->bitrate = bitrate;
+  windowStartMs = nowMs;
+  bits = 0;
+  smoothed = 0;
+  primed = false;
+}
+
+// Unstuffed frame including the 3-bit interframe space is 47 + 8n bits
+// (67 + 8n extended); stuffing adds about one bit in eight of the stuffable
+// part in typical traffic
+uint32_t BusLoadMonitor::frameBits(uint8_t dlc, bool extended) {
+  if (dlc > 8) dlc = 8;
+  uint32_t stuffable = (extended ? 54 : 34) + 8 * dlc;
+  return (extended ? 67 : 47) + 8 * dlc + stuffable / 8;
+}
+
+void BusLoadMonitor::addFrame(uint8_t dlc, bool extended) {
+  bits += frameBits(dlc, extended);
+}
+
+bool BusLoadMonitor::update(uint32_t nowMs) {
+  uint32_t elapsed = nowMs - windowStartMs;
+  if (elapsed < WINDOW_MS) return false;
+
+  uint32_t capacity = (uint32_t)((uint64_t)bitrate * elapsed / 1000);
+  uint32_t permille = (uint32_t)((uint64_t)bits * 1000 / capacity);
+  if (permille > 1000) permille = 1000;
+
+  // First window seeds the average, then a 1/4 IIR smooths bursts
+  if (primed) {
+    smoothed = (uint16_t)(smoothed + ((int32_t)permille - smoothed) / 4);
+  } else {
+    smoothed = (uint16_t)permille;
+    primed = true;
+  }
+  bits = 0;
+  windowStartMs = nowMs;
+  return true;
+}
@@ -0,0 +1,474 @@
+#include "CanOta.h"
+#include "CanTx.h"
+#include "FlashStall.h"
+#include "ImageCodec.h"
+#include <debug.h>
+#include <esp_ota_ops.h>
+#include <mbedtls/sha256.h>
+
+// Abort a transfer that has seen no frames for this long
+static const uint32_t IDLE_TIMEOUT_MS = 10000;
+
+static const uint16_t BITMAP_WORDS = CanOta::MAX_BLOCKS / 32;
+
+// Flash erase unit, and the largest image the erase bitmap covers (4 MB)
+static const uint32_t FLASH_SECTOR_SIZE = 4096;
+static const uint16_t MAX_SECTORS = 1024;
+
+enum JobType : uint8_t { JOB_BEGIN, JOB_WRITE, JOB_REPORT, JOB_FINISH, JOB_ABORT };
+
+struct Job {
+  JobType type;
+  uint8_t generation;  // Transfer the job was posted for
+  uint8_t buffer;
+  uint16_t block;
+  uint16_t length;
+  uint16_t crc;
+};
+
+static uint8_t targetBit = 0;
+static uint32_t replyId = 0;
+static QueueHandle_t jobQueue = nullptr;
+
+// Transfer state shared by the receive callback and the writer task
+static volatile bool transferActive = false;
+static bool multicast = false;
+static uint8_t transferFlags = 0;
+static uint8_t baseId[4];
+static uint32_t imageSize = 0;
+static uint16_t blockCount = 0;
+static uint32_t haveBlocks[BITMAP_WORDS];  // Received (queued or written)
+static uint8_t blockBuffers[2][CanOta::BLOCK_SIZE];
+static volatile bool bufferBusy[2] = { false, false };
+static volatile uint8_t generation = 0;  // Bumped at every BEGIN
+static uint8_t expectedHash[32];
+static uint32_t hashReceived = 0;
+static volatile uint32_t lastActivityMs = 0;
+static volatile int32_t lastAckedBlock = -1;
+
+// Block being received (CAN receive task)
+static int32_t rxBlock = -1;
+static uint8_t rxBuffer = 0;
+static uint16_t rxFrames = 0;
+static uint16_t rxReceived = 0;
+static uint16_t rxLength = 0;
+static uint16_t rxCrc = 0;
+static uint32_t rxFrameBitmap[CanOta::FRAMES_PER_BLOCK / 32];
+
+// Writer task state
+static esp_ota_handle_t otaHandle = 0;
+static const esp_partition_t* otaPartition = nullptr;
+static const esp_partition_t* basePartition = nullptr;
+static uint8_t decodeBuffer[ImageCodec::MAX_OUTPUT];
+static uint32_t erasedSectors[MAX_SECTORS / 32];
+
+static bool readBaseImage(uint32_t offset, uint8_t* dst, uint16_t length, void* context) {
+  if (!basePartition || offset + length > basePartition->size) return false;
+  return esp_partition_read(basePartition, offset, dst, length) == ESP_OK;
+}
+
+static bool baseMatches() {
+  uint8_t sha[32];
+  basePartition = esp_ota_get_running_partition();
+  return basePartition && esp_partition_get_sha256(basePartition, sha) == ESP_OK &&
+         memcmp(sha, baseId, sizeof(baseId)) == 0;
+}
+
+// Sectors are erased the first time a block lands in them, so the flash
+// cache (and with it door sampling) stops for one sector erase at a time
+// instead of for the whole image range at BEGIN
+static esp_err_t writeImage(const uint8_t* data, uint32_t length, uint32_t offset) {
+  if (!length) return ESP_OK;
+  for (uint32_t sector = offset / FLASH_SECTOR_SIZE;
+       sector <= (offset + length - 1) / FLASH_SECTOR_SIZE; sector++) {
+    if (erasedSectors[sector / 32] & (1u << (sector % 32))) continue;
+    FlashStall::beginWrite();
+    esp_err_t err = esp_partition_erase_range(otaPartition, sector * FLASH_SECTOR_SIZE,
+                                              FLASH_SECTOR_SIZE);
+    FlashStall::endWrite();
+    if (err != ESP_OK) return err;
+    erasedSectors[sector / 32] |= 1u << (sector % 32);
+  }
+
+  FlashStall::beginWrite();
+  esp_err_t err = esp_ota_write_with_offset(otaHandle, data, length, offset);
+  FlashStall::endWrite();
+  return err;
+}
+
+static esp_err_t writeBlock(const Job& job) {
+  const uint8_t* data = blockBuffers[job.buffer];
+  if (!(transferFlags & CanOta::FLAG_COMPRESSED)) {
+    return writeImage(data, job.length, (uint32_t)job.block * CanOta::BLOCK_SIZE);
+  }
+
+  ImageCodec::Header header;
+  bool delta = transferFlags & CanOta::FLAG_DELTA;
+  if (!ImageCodec::decode(data, job.length, decodeBuffer, header,
+                          delta ? readBaseImage : nullptr, nullptr) ||
+      header.outOffset + header.outLength > imageSize) {
+    return ESP_ERR_INVALID_ARG;
+  }
+  return writeImage(decodeBuffer, header.outLength, header.outOffset);
+}
+
+static bool haveBlock(uint16_t block) {
+  return haveBlocks[block / 32] & (1u << (block % 32));
+}
+
+static void setHaveBlock(uint16_t block, bool have) {
+  if (have) {
+    __atomic_fetch_or(&haveBlocks[block / 32], 1u << (block % 32), __ATOMIC_SEQ_CST);
+  } else {
+    __atomic_fetch_and(&haveBlocks[block / 32], ~(1u << (block % 32)), __ATOMIC_SEQ_CST);
+  }
+}
+
+static void sendBlockStatus(uint8_t status, uint16_t block) {
+  uint8_t args[2] = { (uint8_t)(block & 0xFF), (uint8_t)(block >> 8) };
+  CanTx::sendStatus(replyId, status, args, sizeof(args));
+}
+
+// False if the writer queue is full
+static bool postJob(JobType type, uint8_t buffer = 0, uint16_t block = 0,
+                    uint16_t length = 0, uint16_t crc = 0) {
+  Job job = { type, generation, buffer, block, length, crc };
+  return xQueueSend(jobQueue, &job, 0) == pdTRUE;
+}
+
+// Both block buffers are free again and no block is being received. Writes
+// still queued from the old transfer belong to an older generation and no
+// longer touch the buffers.
+static void releaseBuffers() {
+  rxBlock = -1;
+  bufferBusy[0] = false;
+  bufferBusy[1] = false;
+}
+
+static void closeImage() {
+  if (otaHandle) esp_ota_abort(otaHandle);
+  otaHandle = 0;
+}
+
+static void abortTransfer() {
+  transferActive = false;
+  releaseBuffers();
+  closeImage();
+}
+
+static void reportMissing() {
+  uint16_t missing = 0;
+  for (uint16_t base = 0; base < blockCount; base += CanOta::BLOCKS_PER_MISSING_FRAME) {
+    uint8_t args[7] = { (uint8_t)(base & 0xFF), (uint8_t)(base >> 8) };
+    bool any = false;
+    for (uint8_t i = 0; i < CanOta::BLOCKS_PER_MISSING_FRAME && base + i < blockCount; i++) {
+      if (!haveBlock(base + i)) {
+        args[2 + i / 8] |= 1 << (i % 8);
+        missing++;
+        any = true;
+      }
+    }
+    if (any) CanTx::sendStatus(replyId, CanOta::STATUS_MISSING, args, sizeof(args));
+  }
+  uint8_t args[2] = { (uint8_t)(missing & 0xFF), (uint8_t)(missing >> 8) };
+  CanTx::sendStatus(replyId, CanOta::STATUS_REPORT, args, sizeof(args));
+}
+
+// Blocks may arrive in any order, so the hash is taken over what actually
+// landed in flash rather than over the stream
+static bool verifyFlashHash() {
+  uint8_t hash[32];
+  mbedtls_sha256_context sha;
+  mbedtls_sha256_init(&sha);
+  mbedtls_sha256_starts(&sha, 0);
+  for (uint32_t offset = 0; offset < imageSize; offset += CanOta::BLOCK_SIZE) {
+    uint32_t length = min((uint32_t)CanOta::BLOCK_SIZE, imageSize - offset);
+    if (esp_partition_read(otaPartition, offset, blockBuffers[0], length) != ESP_OK) {
+      mbedtls_sha256_free(&sha);
+      return false;
+    }
+    mbedtls_sha256_update(&sha, blockBuffers[0], length);
+  }
+  mbedtls_sha256_finish(&sha, hash);
+  mbedtls_sha256_free(&sha);
+  return memcmp(hash, expectedHash, sizeof(hash)) == 0;
+}
+
+static void writerTask(void* param) {
+  Job job;
+  while (true) {
+    if (xQueueReceive(jobQueue, &job, pdMS_TO_TICKS(1000)) != pdTRUE) {
+      if (transferActive && millis() - lastActivityMs > IDLE_TIMEOUT_MS) {
+        abortTransfer();
+        CanTx::sendError(replyId, CanOta::ERR_TIMEOUT);
+        debugln("[CANOTA] Transfer timed out");
+      }
+      continue;
+    }
+
+    switch (job.type) {
+      case JOB_BEGIN: {
+        otaPartition = esp_ota_get_next_update_partition(nullptr);
+        if (!otaPartition) {
+          transferActive = false;
+          CanTx::sendError(replyId, CanOta::ERR_NO_PARTITION);
+          break;
+        }
+        if (imageSize > otaPartition->size || blockCount > CanOta::MAX_BLOCKS ||
+            imageSize > (uint32_t)MAX_SECTORS * FLASH_SECTOR_SIZE) {
+          transferActive = false;
+          CanTx::sendError(replyId, CanOta::ERR_TOO_LARGE);
+          break;
+        }
+        if ((transferFlags & CanOta::FLAG_DELTA) && !baseMatches()) {
+          transferActive = false;
+          CanTx::sendError(replyId, CanOta::ERR_BASE);
+          debugln("[CANOTA] Delta base does not match running image");
+          break;
+        }
+        // Nothing is erased here - writeImage() erases sector by sector as
+        // blocks land, in whatever order they arrive
+        memset(erasedSectors, 0, sizeof(erasedSectors));
+        if (esp_ota_begin(otaPartition, OTA_WITH_SEQUENTIAL_WRITES, &otaHandle) != ESP_OK) {
+          abortTransfer();
+          CanTx::sendError(replyId, CanOta::ERR_FLASH);
+          break;
+        }
+        debugf("[CANOTA] Receiving %lu bytes into %s (%s%s%s)\n", imageSize,
+               otaPartition->label, multicast ? "multicast" : "unicast",
+               (transferFlags & CanOta::FLAG_COMPRESSED) ? ", compressed" : "",
+               (transferFlags & CanOta::FLAG_DELTA) ? ", delta" : "");
+        uint8_t args[2] = { CanOta::BLOCK_SIZE & 0xFF, CanOta::BLOCK_SIZE >> 8 };
+        CanTx::sendStatus(replyId, CanOta::STATUS_READY, args, sizeof(args));
+        break;
+      }
+      case JOB_WRITE: {
+        // Buffers were released when its transfer ended
+        if (job.generation != generation) break;
+        if (!otaHandle) {
+          bufferBusy[job.buffer] = false;
+          break;
+        }
+        if (CanOta::crc16(blockBuffers[job.buffer], job.length) != job.crc) {
+          // Leave it missing - unicast senders retry, multicast repairs later
+          setHaveBlock(job.block, false);
+          bufferBusy[job.buffer] = false;
+          break;
+        }
+        if (!multicast) {
+          // The other buffer is free once this job starts - let the next block in
+          lastAckedBlock = job.block;
+          sendBlockStatus(CanOta::STATUS_ACK, job.block);
+        }
+        esp_err_t err = writeBlock(job);
+        bufferBusy[job.buffer] = false;
+        if (err != ESP_OK) {
+          abortTransfer();
+          CanTx::sendError(replyId, err == ESP_ERR_INVALID_ARG ? CanOta::ERR_DECODE : CanOta::ERR_FLASH);
+        }
+        break;
+      }
+      case JOB_REPORT: {
+        reportMissing();
+        break;
+      }
+      case JOB_FINISH: {
+        if (!otaHandle) break;
+        // A block may have failed its CRC after END was accepted
+        bool complete = true;
+        for (uint16_t block = 0; block < blockCount && complete; block++) {
+          complete = haveBlock(block);
+        }
+        if (!complete) {
+          CanTx::sendError(replyId, CanOta::ERR_SEQUENCE);
+          break;
+        }
+        transferActive = false;
+        if (!verifyFlashHash()) {
+          abortTransfer();
+          CanTx::sendError(replyId, CanOta::ERR_HASH);
+          debugln("[CANOTA] SHA-256 mismatch - update discarded");
+          break;
+        }
+        esp_err_t err = esp_ota_end(otaHandle);
+        otaHandle = 0;
+        if (err != ESP_OK || esp_ota_set_boot_partition(otaPartition) != ESP_OK) {
+          CanTx::sendError(replyId, CanOta::ERR_IMAGE);
+          debugln("[CANOTA] Image validation failed - update discarded");
+          break;
+        }
+        CanTx::sendStatus(replyId, CanOta::STATUS_DONE);
+        debugf("[CANOTA] Update verified, booting %s\n", otaPartition->label);
+        delay(100);
+        esp_restart();
+        break;
+      }
+      case JOB_ABORT: {
+        // A BEGIN may already have started the next transfer - only close
+        // the old image then
+        if (job.generation == generation) {
+          abortTransfer();
+        } else {
+          closeImage();
+        }
+        debugln("[CANOTA] Transfer aborted");
+        break;
+      }
+    }
+  }
+}
+
+uint16_t CanOta::crc16(const uint8_t* data, size_t length, uint16_t crc) {
+  for (size_t i = 0; i < length; i++) {
+    crc ^= (uint16_t)data[i] << 8;
+    for (uint8_t bit = 0; bit < 8; bit++) {
+      crc = (crc & 0x8000) ? (crc << 1) ^ 0x1021 : (crc << 1);
+    }
+  }
+  return crc;
+}
+
+void CanOta::begin(uint8_t dipAddress, uint32_t statusId) {
+  // Reaching setup() on a freshly switched slot confirms it to the bootloader
+  // so a rollback-enabled build keeps it instead of reverting
+  esp_ota_mark_app_valid_cancel_rollback();
+
+  targetBit = 1 << dipAddress;
+  replyId = statusId;
+  jobQueue = xQueueCreate(8, sizeof(Job));
+  xTaskCreate(writerTask, "canota", 4096, nullptr, 2, nullptr);
+}
+
+void CanOta::handleCommand(const twai_message_t& msg) {
+  if (msg.data_length_code < 2 || !(msg.data[0] & targetBit)) return;
+  lastActivityMs = millis();
+
+  switch (msg.data[1]) {
+    case CMD_BEGIN: {
+      if (transferActive || msg.data_length_code < 8) break;
+      imageSize = msg.data[2] | (msg.data[3] << 8) | ((uint32_t)msg.data[4] << 16);
+      transferFlags = msg.data[5];
+      multicast = transferFlags & FLAG_MULTICAST;
+      blockCount = msg.data[6] | (msg.data[7] << 8);
+      memset(haveBlocks, 0, sizeof(haveBlocks));
+      generation++;
+      releaseBuffers();
+      hashReceived = 0;
+      lastAckedBlock = -1;
+      transferActive = true;
+      if (!postJob(JOB_BEGIN)) transferActive = false;
+      break;
+    }
+    case CMD_BLOCK: {
+      if (!transferActive || msg.data_length_code < 7) break;
+      uint16_t block = msg.data[2] | (msg.data[3] << 8);
+
+      if (rxBlock >= 0) {
+        // Previous block never completed - drop it, it stays missing
+        bufferBusy[rxBuffer] = false;
+        rxBlock = -1;
+      }
+      if (block >= blockCount) break;
+      if (haveBlock(block)) {
+        // Unicast sender missed our ACK - repeat it once the writer took the block
+        if (!multicast && (int32_t)block <= lastAckedBlock) {
+          sendBlockStatus(STATUS_ACK, block);
+        }
+        break;
+      }
+
+      // No free buffer means the writer is behind - skip this block
+      if (!bufferBusy[0]) {
+        rxBuffer = 0;
+      } else if (!bufferBusy[1]) {
+        rxBuffer = 1;
+      } else {
+        break;
+      }
+      bufferBusy[rxBuffer] = true;
+
+      rxBlock = block;
+      rxFrames = msg.data[4] + 1;
+      rxReceived = 0;
+      if (transferFlags & FLAG_COMPRESSED) {
+        // Encoded blocks are padded to whole frames; the decoder ignores padding
+        rxLength = rxFrames * FRAME_PAYLOAD;
+      } else {
+        uint32_t offset = (uint32_t)block * BLOCK_SIZE;
+        rxLength = min((uint32_t)BLOCK_SIZE, imageSize - offset);
+      }
+      rxCrc = msg.data[5] | (msg.data[6] << 8);
+      memset(rxFrameBitmap, 0, sizeof(rxFrameBitmap));
+      break;
+    }
+    case CMD_HASH: {
+      if (!transferActive || msg.data_length_code < 3) break;
+      uint8_t offset = msg.data[2];
+      uint8_t bytes = msg.data_length_code - 3;
+      if (offset + bytes > sizeof(expectedHash)) break;
+      memcpy(&expectedHash[offset], &msg.data[3], bytes);
+      hashReceived |= ((1u << bytes) - 1) << offset;
+      break;
+    }
+    case CMD_END: {
+      if (!transferActive) break;
+      for (uint16_t block = 0; block < blockCount; block++) {
+        if (!haveBlock(block)) {
+          CanTx::sendError(replyId, ERR_SEQUENCE);
+          return;
+        }
+      }
+      if (hashReceived != 0xFFFFFFFF) {
+        CanTx::sendError(replyId, ERR_SEQUENCE);
+        break;
+      }
+      postJob(JOB_FINISH);
+      break;
+    }
+    case CMD_ABORT: {
+      if (!transferActive) break;
+      transferActive = false;
+      releaseBuffers();
+      postJob(JOB_ABORT);
+      break;
+    }
+    case CMD_QUERY: {
+      if (!transferActive) break;
+      postJob(JOB_REPORT);
+      break;
+    }
+    case CMD_BASE: {
+      if (transferActive || msg.data_length_code < 6) break;
+      memcpy(baseId, &msg.data[2], sizeof(baseId));
+      break;
+    }
+  }
+}
+
+void CanOta::handleData(const twai_message_t& msg) {
+  if (!transferActive || rxBlock < 0 || msg.data_length_code < 2) return;
+  lastActivityMs = millis();
+
+  uint8_t index = msg.data[0];
+  if (index >= rxFrames || (rxFrameBitmap[index / 32] & (1u << (index % 32)))) return;
+
+  uint16_t offset = index * FRAME_PAYLOAD;
+  if (offset >= rxLength) return;
+  uint8_t bytes = min((int)(msg.data_length_code - 1), rxLength - offset);
+  memcpy(&blockBuffers[rxBuffer][offset], &msg.data[1], bytes);
+  rxFrameBitmap[index / 32] |= (1u << (index % 32));
+  if (++rxReceived < rxFrames) return;
+
+  // Block complete - the writer checks its CRC and clears it again on mismatch
+  setHaveBlock(rxBlock, true);
+  if (!postJob(JOB_WRITE, rxBuffer, rxBlock, rxLength, rxCrc)) {
+    // Writer queue full - the block stays missing and its buffer is free
+    setHaveBlock(rxBlock, false);
+    bufferBusy[rxBuffer] = false;
+  }
+  rxBlock = -1;
+}
+
+bool CanOta::active() {
+  return transferActive;
+}
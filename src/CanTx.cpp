@@ -0,0 +1,53 @@
+#include "CanTx.h"
+
+static SemaphoreHandle_t sendMutex = nullptr;
+static volatile uint32_t sentCount = 0;       // Senders, under sendMutex
+static volatile uint32_t completedCount = 0;  // Transmit callback
+
+void CanTx::begin() {
+  sendMutex = xSemaphoreCreateMutex();
+}
+
+uint32_t CanTx::send(const twai_message_t& msg, volatile uint32_t* sequence) {
+  // Numbering and queueing together, so numbers follow the driver's order
+  xSemaphoreTake(sendMutex, portMAX_DELAY);
+  uint32_t number = sentCount + 1;
+  if (number == 0) number = 1;
+  sentCount = number;
+  if (sequence) *sequence = number;
+  TwaiTaskBased::send(msg);
+  xSemaphoreGive(sendMutex);
+  return number;
+}
+
+uint32_t CanTx::sendStatus(uint32_t id, uint8_t status, const uint8_t* args, uint8_t argLength) {
+  twai_message_t msg = {};
+  msg.identifier = id;
+  msg.data_length_code = 1 + argLength;
+  msg.data[0] = status;
+  if (argLength) memcpy(&msg.data[1], args, argLength);
+  return send(msg);
+}
+
+uint32_t CanTx::sendError(uint32_t id, uint8_t code) {
+  return sendStatus(id, STATUS_ERROR, &code, 1);
+}
+
+uint32_t CanTx::completed() {
+  uint32_t number = completedCount + 1;
+  if (number == 0) number = 1;
+  completedCount = number;
+  return number;
+}
+
+bool CanTx::resync() {
+  twai_status_info_t status;
+  if (twai_get_status_info(&status) != ESP_OK || status.state != TWAI_STATE_RUNNING ||
+      status.tx_error_counter >= 128 || status.msgs_to_tx > 0) {
+    return false;
+  }
+  xSemaphoreTake(sendMutex, portMAX_DELAY);
+  completedCount = sentCount;
+  xSemaphoreGive(sendMutex);
+  return true;
+}
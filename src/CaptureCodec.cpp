@@ -0,0 +1,88 @@
+#include "CaptureCodec.h"
+
+#include <string.h>
+
+static void put32(uint8_t* out, uint32_t value) {
+  for (uint8_t i = 0; i < 4; i++) out[i] = (uint8_t)(value >> (8 * i));
+}
+
+void CaptureEncoder::beginSector(uint8_t* sector, uint16_t size, uint32_t sequence,
+                                 uint16_t session, uint16_t flags, int64_t baseUs) {
+  out = sector;
+  capacity = size;
+  put32(&out[0], MAGIC);
+  put32(&out[4], sequence);
+  out[8] = (uint8_t)(session & 0xFF);
+  out[9] = (uint8_t)(session >> 8);
+  out[10] = (uint8_t)(flags & 0xFF);
+  out[11] = (uint8_t)(flags >> 8);
+  put32(&out[12], (uint32_t)baseUs);
+  put32(&out[16], (uint32_t)((uint64_t)baseUs >> 32));
+  length = HEADER_SIZE;
+  lastUs = baseUs;
+  dictionaryCount = 0;
+}
+
+void CaptureEncoder::putVarint(uint64_t value) {
+  while (value >= 0x80) {
+    out[length++] = (uint8_t)(value | 0x80);
+    value >>= 7;
+  }
+  out[length++] = (uint8_t)value;
+}
+
+int8_t CaptureEncoder::lookup(uint32_t id) const {
+  for (uint8_t i = 0; i < dictionaryCount; i++) {
+    if (dictionary[i] == id) return i;
+  }
+  return -1;
+}
+
+bool CaptureEncoder::add(const CapturedFrame& frame) {
+  if (!out || capacity - length < MAX_RECORD) return false;
+
+  uint8_t dlc = frame.dlc > 8 ? 8 : frame.dlc;
+  int8_t entry = -1;
+  if (frame.extended) {
+    out[length++] = 0x41;
+    put32(&out[length], frame.id);
+    length += 4;
+  } else {
+    entry = lookup(frame.id);
+    if (entry >= 0) {
+      out[length++] = (uint8_t)entry;
+    } else {
+      out[length++] = 0x40;
+      out[length++] = (uint8_t)(frame.id & 0xFF);
+      out[length++] = (uint8_t)((frame.id >> 8) & 0x07);
+      if (dictionaryCount < DICTIONARY_SIZE) {
+        entry = dictionaryCount++;
+        dictionary[entry] = (uint16_t)frame.id;
+        lastDlc[entry] = 0xFF;  // Nothing to repeat yet
+      }
+    }
+  }
+
+  bool repeat = false;
+  if (entry >= 0 && !frame.rtr) {
+    repeat = lastDlc[entry] == dlc && memcmp(lastData[entry], frame.data, dlc) == 0;
+    lastDlc[entry] = dlc;
+    memcpy(lastData[entry], frame.data, dlc);
+  }
+
+  out[length++] = dlc | (repeat ? 0x10 : 0) | (frame.rtr ? 0x20 : 0);
+  putVarint(frame.timeUs > lastUs ? (uint64_t)(frame.timeUs - lastUs) : 0);
+  if (frame.timeUs > lastUs) lastUs = frame.timeUs;
+  if (!repeat && !frame.rtr) {
+    memcpy(&out[length], frame.data, dlc);
+    length += dlc;
+  }
+  return true;
+}
+
+bool CaptureEncoder::addMarker(Marker marker, uint32_t value) {
+  if (!out || capacity - length < MAX_RECORD) return false;
+  out[length++] = 0xC0 | marker;
+  putVarint(value);
+  return true;
+}
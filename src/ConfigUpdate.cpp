@@ -0,0 +1,254 @@
+#include "ConfigUpdate.h"
+#include "CanTx.h"
+#include "FlashStall.h"
+#include <Preferences.h>
+#include <mbedtls/sha256.h>
+#include "TokenLog.h"
+
+static const char* NVS_NAMESPACE = "modcfg";
+
+struct KindState {
+  const char* nvsKey;
+  uint8_t version;
+  uint32_t hash;    // Active blob
+  bool stored;      // Active blob came from NVS rather than the defaults
+};
+
+static KindState kinds[ConfigUpdate::KIND_COUNT] = {
+  { "blob", ModuleConfigCodec::VERSION, 0, false },
+  { "rules", RuleEngine::VERSION, 0, false },
+};
+
+static uint8_t targetBit = 0;
+static uint32_t replyId = 0;
+static portMUX_TYPE updateMux = portMUX_INITIALIZER_UNLOCKED;
+
+// Reception (CAN receive task)
+static uint8_t rxBlob[ConfigUpdate::MAX_BLOB];
+static uint8_t rxLength = 0;
+static uint8_t rxKind = 0;
+static uint32_t rxFrames = 0;       // Bit n = data frame n received
+static uint8_t rxHash[32];          // Expected SHA-256 from HASH segments
+static uint32_t rxHashBytes = 0;    // Bit n = rxHash[n] received
+static bool rxActive = false;
+static volatile uint32_t rxLastMs = 0;  // Last BEGIN, HASH or data frame
+
+// Committed, waiting for the main loop
+static uint8_t pendingBlob[ConfigUpdate::MAX_BLOB];
+static uint8_t pendingLength = 0;
+static uint8_t pendingKind = 0;
+static volatile bool pending = false;
+
+// First 4 bytes of the SHA-256, the ID the status replies report
+static uint32_t blobHash(const uint8_t* blob, uint8_t length) {
+  uint8_t hash[32];
+  mbedtls_sha256(blob, length, hash, 0);
+  return hash[0] | (hash[1] << 8) | ((uint32_t)hash[2] << 16) | ((uint32_t)hash[3] << 24);
+}
+
+static void putHash(uint8_t* out, uint32_t hash) {
+  out[0] = (uint8_t)(hash & 0xFF);
+  out[1] = (uint8_t)((hash >> 8) & 0xFF);
+  out[2] = (uint8_t)((hash >> 16) & 0xFF);
+  out[3] = (uint8_t)(hash >> 24);
+}
+
+static size_t readStored(uint8_t kind, uint8_t* blob) {
+  Preferences prefs;
+  prefs.begin(NVS_NAMESPACE, true);
+  size_t length = prefs.getBytes(kinds[kind].nvsKey, blob, ConfigUpdate::MAX_BLOB);
+  prefs.end();
+  return length;
+}
+
+static bool validBlob(uint8_t kind, const uint8_t* blob, uint8_t length) {
+  if (kind == ConfigUpdate::KIND_RULES) return RuleEngine::validate(blob, length);
+  ModuleConfig config;
+  return ModuleConfigCodec::decode(blob, length, config);
+}
+
+bool ConfigUpdate::load(ModuleConfig& config) {
+  uint8_t blob[MAX_BLOB];
+  size_t length = readStored(KIND_CONFIG, blob);
+  if (length && ModuleConfigCodec::decode(blob, length, config)) {
+    kinds[KIND_CONFIG].hash = blobHash(blob, length);
+    kinds[KIND_CONFIG].stored = true;
+    return true;
+  }
+
+  // Nothing stored (or rejected): report the hash of the defaults
+  ModuleConfigCodec::encode(config, blob);
+  kinds[KIND_CONFIG].hash = blobHash(blob, ModuleConfigCodec::ENCODED_SIZE);
+  kinds[KIND_CONFIG].stored = false;
+  return false;
+}
+
+bool ConfigUpdate::loadRules(RuleEngine& rules) {
+  uint8_t blob[MAX_BLOB];
+  size_t length = readStored(KIND_RULES, blob);
+  if (length && rules.load(blob, length)) {
+    kinds[KIND_RULES].hash = blobHash(blob, length);
+    kinds[KIND_RULES].stored = true;
+    return true;
+  }
+
+  // No rules: report the hash of the empty program
+  const uint8_t empty[] = { RuleEngine::VERSION, 0, 0 };
+  rules.clear();
+  kinds[KIND_RULES].hash = blobHash(empty, sizeof(empty));
+  kinds[KIND_RULES].stored = false;
+  return false;
+}
+
+void ConfigUpdate::begin(uint8_t dipAddress, uint32_t statusId) {
+  targetBit = 1 << dipAddress;
+  replyId = statusId;
+}
+
+void ConfigUpdate::handleCommand(const twai_message_t& msg) {
+  if (msg.data_length_code < 2 || !(msg.data[0] & targetBit)) return;
+
+  switch (msg.data[1]) {
+    case CMD_BEGIN: {
+      if (msg.data_length_code < 4) break;
+      uint8_t kind = msg.data_length_code >= 5 ? msg.data[4] : KIND_CONFIG;
+      if (kind >= KIND_COUNT || msg.data[3] != kinds[kind].version) {
+        rxActive = false;
+        CanTx::sendError(replyId, ERR_VERSION);
+        break;
+      }
+      if (msg.data[2] == 0 || msg.data[2] > MAX_BLOB) {
+        rxActive = false;
+        CanTx::sendError(replyId, ERR_INVALID);
+        break;
+      }
+      rxKind = kind;
+      rxLength = msg.data[2];
+      rxFrames = 0;
+      rxHashBytes = 0;
+      rxLastMs = millis();
+      rxActive = true;
+      break;
+    }
+    case CMD_HASH: {
+      if (!rxActive || msg.data_length_code < 3) break;
+      uint8_t offset = msg.data[2];
+      uint8_t bytes = msg.data_length_code - 3;
+      if (offset + bytes > sizeof(rxHash)) break;
+      memcpy(&rxHash[offset], &msg.data[3], bytes);
+      rxHashBytes |= ((1u << bytes) - 1) << offset;
+      rxLastMs = millis();
+      break;
+    }
+    case CMD_COMMIT: {
+      if (!rxActive || rxHashBytes != 0xFFFFFFFF) {
+        rxActive = false;
+        CanTx::sendError(replyId, ERR_SEQUENCE);
+        break;
+      }
+      rxActive = false;
+
+      uint8_t frames = (rxLength + FRAME_PAYLOAD - 1) / FRAME_PAYLOAD;
+      if (rxFrames != (uint32_t)((1ull << frames) - 1)) {
+        CanTx::sendError(replyId, ERR_INCOMPLETE);
+        break;
+      }
+      uint8_t hash[32];
+      mbedtls_sha256(rxBlob, rxLength, hash, 0);
+      if (memcmp(hash, rxHash, sizeof(hash)) != 0) {
+        CanTx::sendError(replyId, ERR_HASH);
+        break;
+      }
+      if (!validBlob(rxKind, rxBlob, rxLength)) {
+        CanTx::sendError(replyId, ERR_INVALID);
+        break;
+      }
+
+      taskENTER_CRITICAL(&updateMux);
+      memcpy(pendingBlob, rxBlob, rxLength);
+      pendingLength = rxLength;
+      pendingKind = rxKind;
+      pending = true;
+      taskEXIT_CRITICAL(&updateMux);
+      break;
+    }
+    case CMD_QUERY: {
+      uint8_t kind = msg.data_length_code >= 3 ? msg.data[2] : KIND_CONFIG;
+      if (kind >= KIND_COUNT) {
+        CanTx::sendError(replyId, ERR_VERSION);
+        break;
+      }
+      uint8_t args[7];
+      putHash(args, kinds[kind].hash);
+      args[4] = kinds[kind].version;
+      args[5] = kinds[kind].stored ? 1 : 0;
+      args[6] = kind;
+      CanTx::sendStatus(replyId, STATUS_HASH, args, sizeof(args));
+      break;
+    }
+  }
+}
+
+void ConfigUpdate::handleData(const twai_message_t& msg) {
+  if (!rxActive || msg.data_length_code < 2) return;
+  uint8_t index = msg.data[0];
+  uint16_t offset = index * FRAME_PAYLOAD;
+  if (offset >= rxLength) return;
+
+  uint8_t length = msg.data_length_code - 1;
+  if (offset + length > rxLength) length = rxLength - offset;
+  memcpy(&rxBlob[offset], &msg.data[1], length);
+  rxFrames |= 1ul << index;
+  rxLastMs = millis();
+}
+
+bool ConfigUpdate::active() {
+  return pending || (rxActive && millis() - rxLastMs < IDLE_TIMEOUT_MS);
+}
+
+void ConfigUpdate::service(void (*applyConfig)(const ModuleConfig& config),
+                           void (*applyRules)(const uint8_t* program, uint8_t length)) {
+  if (!pending) return;
+
+  uint8_t blob[MAX_BLOB];
+  taskENTER_CRITICAL(&updateMux);
+  uint8_t length = pendingLength;
+  uint8_t kind = pendingKind;
+  memcpy(blob, pendingBlob, length);
+  pending = false;
+  taskEXIT_CRITICAL(&updateMux);
+
+  // NVS replaces a key as a whole, so a reset mid-write keeps the old blob
+  FlashStall::beginWrite();
+  Preferences prefs;
+  prefs.begin(NVS_NAMESPACE, false);
+  size_t written = prefs.putBytes(kinds[kind].nvsKey, blob, length);
+  prefs.end();
+  FlashStall::endWrite();
+  if (written != length) {
+    tlogf("[CFG] ERROR: Could not store blob kind %u", kind);
+    CanTx::sendError(replyId, ERR_STORE);
+    return;
+  }
+
+  if (kind == KIND_RULES) {
+    applyRules(blob, length);
+  } else {
+    ModuleConfig config;
+    ModuleConfigCodec::decode(blob, length, config);
+    applyConfig(config);
+  }
+  kinds[kind].hash = blobHash(blob, length);
+  kinds[kind].stored = true;
+
+  uint8_t args[5];
+  putHash(args, kinds[kind].hash);
+  args[4] = kind;
+  CanTx::sendStatus(replyId, STATUS_APPLIED, args, sizeof(args));
+  tlogf("[CFG] Applied %s %08lX", kind == KIND_RULES ? "rules" : "configuration",
+        kinds[kind].hash);
+}
+
+uint32_t ConfigUpdate::activeHash(Kind kind) {
+  return kinds[kind].hash;
+}
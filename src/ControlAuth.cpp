@@ -0,0 +1,218 @@
+#include "ControlAuth.h"
+#include "FlashStall.h"
+#include "TokenLog.h"
+#include <Preferences.h>
+#include <esp_timer.h>
+#include <mbedtls/md.h>
+
+// Held frames older than this are discarded when the next one arrives
+static const uint32_t HOLD_TIMEOUT_MS = 2000;
+
+struct HeldChannel {
+  uint32_t id;
+  uint8_t count;
+  uint32_t firstHeldMs;
+  twai_message_t frames[ControlAuth::MAX_HELD_FRAMES];
+};
+
+static uint8_t authKey[32];
+static bool authEnabled = false;
+static volatile uint32_t lastCounter = 0;  // Accepted (receive task)
+static uint32_t savedCounter = 0;          // In NVS (main loop)
+static HeldChannel channels[ControlAuth::MAX_CHANNELS];
+static uint32_t maxVerify = 0;
+static uint32_t rejected = 0;
+static uint8_t failStreak = 0;     // Rejected AUTH frames since the last accepted one
+static volatile uint32_t lockoutStartMs = 0;  // 0 when not locked out
+
+static int hexNibble(char c) {
+  if (c >= '0' && c <= '9') return c - '0';
+  if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+  if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+  return -1;
+}
+
+static HeldChannel* findChannel(uint32_t id, bool create) {
+  HeldChannel* freeSlot = nullptr;
+  for (uint8_t i = 0; i < ControlAuth::MAX_CHANNELS; i++) {
+    if (channels[i].count > 0 && channels[i].id == id) return &channels[i];
+    if (channels[i].count == 0 && !freeSlot) freeSlot = &channels[i];
+  }
+  if (create && freeSlot) {
+    freeSlot->id = id;
+    return freeSlot;
+  }
+  return nullptr;
+}
+
+static void putLe(uint8_t* out, uint32_t value, uint8_t bytes) {
+  for (uint8_t i = 0; i < bytes; i++) out[i] = (value >> (8 * i)) & 0xFF;
+}
+
+static bool computeMac(const HeldChannel& channel, uint32_t counter, uint8_t* mac) {
+  const mbedtls_md_info_t* info = mbedtls_md_info_from_type(MBEDTLS_MD_SHA256);
+  mbedtls_md_context_t ctx;
+  mbedtls_md_init(&ctx);
+  bool ok = mbedtls_md_setup(&ctx, info, 1) == 0 &&
+            mbedtls_md_hmac_starts(&ctx, authKey, sizeof(authKey)) == 0;
+
+  uint8_t prefix[6];
+  putLe(prefix, channel.id, 2);
+  putLe(prefix + 2, counter, 4);
+  ok = ok && mbedtls_md_hmac_update(&ctx, prefix, sizeof(prefix)) == 0;
+
+  for (uint8_t i = 0; ok && i < channel.count; i++) {
+    const twai_message_t& frame = channel.frames[i];
+    uint8_t header[3];
+    putLe(header, frame.identifier, 2);
+    header[2] = frame.data_length_code;
+    ok = mbedtls_md_hmac_update(&ctx, header, sizeof(header)) == 0 &&
+         mbedtls_md_hmac_update(&ctx, frame.data, frame.data_length_code) == 0;
+  }
+
+  uint8_t full[32];
+  ok = ok && mbedtls_md_hmac_finish(&ctx, full) == 0;
+  mbedtls_md_free(&ctx);
+  if (ok) memcpy(mac, full, ControlAuth::MAC_BYTES);
+  return ok;
+}
+
+bool ControlAuth::begin(const char* keyHex) {
+  authEnabled = false;
+  if (!keyHex || strlen(keyHex) != 2 * sizeof(authKey)) {
+    tlogf("[AUTH] ERROR: No CAN auth key - control frames are NOT authenticated");
+    return false;
+  }
+  for (uint8_t i = 0; i < sizeof(authKey); i++) {
+    int hi = hexNibble(keyHex[2 * i]);
+    int lo = hexNibble(keyHex[2 * i + 1]);
+    if (hi < 0 || lo < 0) {
+      tlogf("[AUTH] ERROR: Malformed CAN auth key - control frames are NOT authenticated");
+      return false;
+    }
+    authKey[i] = (hi << 4) | lo;
+  }
+
+  Preferences prefs;
+  prefs.begin("auth", true);
+  savedCounter = prefs.getULong("counter", 0);
+  prefs.end();
+  lastCounter = savedCounter;
+
+  authEnabled = true;
+  tlogf("[AUTH] Control frames authenticated (last counter %lu)", savedCounter);
+  return true;
+}
+
+bool ControlAuth::enabled() {
+  return authEnabled;
+}
+
+void ControlAuth::hold(const twai_message_t& msg) {
+  HeldChannel* channel = findChannel(msg.identifier, true);
+  if (!channel) return;
+
+  uint32_t now = millis();
+  if (channel->count > 0 && now - channel->firstHeldMs > HOLD_TIMEOUT_MS) {
+    channel->count = 0;
+  }
+  if (channel->count >= MAX_HELD_FRAMES) {
+    // Overflow can never verify - start over with this frame
+    channel->count = 0;
+  }
+  if (channel->count == 0) channel->firstHeldMs = now;
+  channel->frames[channel->count++] = msg;
+}
+
+bool ControlAuth::holding() {
+  uint32_t now = millis();
+  for (uint8_t i = 0; i < MAX_CHANNELS; i++) {
+    if (channels[i].count > 0 && now - channels[i].firstHeldMs <= HOLD_TIMEOUT_MS) return true;
+  }
+  return false;
+}
+
+bool ControlAuth::verify(const twai_message_t& authMsg, ReleaseHandler handler) {
+  if (!authEnabled || authMsg.data_length_code < 8) return false;
+
+  int64_t start = esp_timer_get_time();
+  uint32_t id = authMsg.data[0] | (authMsg.data[1] << 8);
+  HeldChannel* channel = findChannel(id, false);
+  if (!channel) return false;
+
+  if (lockoutStartMs != 0 && !lockedOut()) lockoutStartMs = 0;
+  if (lockedOut()) {
+    rejected++;
+    tlogf("[AUTH] Locked out - dropped %d frame(s) on 0x%03lX", channel->count, id);
+    channel->count = 0;
+    return false;
+  }
+
+  // Smallest counter above the last accepted one with matching low bits
+  uint16_t low = authMsg.data[2] | (authMsg.data[3] << 8);
+  uint32_t counter = (lastCounter & 0xFFFF0000) | low;
+  if (counter <= lastCounter) counter += 0x10000;
+
+  uint8_t mac[MAC_BYTES];
+  uint8_t diff = 0;
+  bool computed = computeMac(*channel, counter, mac);
+  for (uint8_t i = 0; i < MAC_BYTES; i++) diff |= mac[i] ^ authMsg.data[4 + i];
+
+  uint32_t verifyUs = (uint32_t)(esp_timer_get_time() - start);
+  if (verifyUs > maxVerify) maxVerify = verifyUs;
+
+  if (!computed || diff != 0) {
+    rejected++;
+    if (++failStreak >= MAX_FAILURES) {
+      failStreak = 0;
+      lockoutStartMs = millis();
+      if (lockoutStartMs == 0) lockoutStartMs = 1;
+      tlogf("[AUTH] ERROR: %d AUTH frames rejected in a row - locked out for %lu ms",
+             MAX_FAILURES, LOCKOUT_MS);
+    }
+    tlogf("[AUTH] Rejected %d frame(s) on 0x%03lX (%lu us)", channel->count, id, verifyUs);
+    channel->count = 0;
+    return false;
+  }
+
+  // Persisted by service(): an NVS write here would stall the receive task
+  lastCounter = counter;
+  failStreak = 0;
+
+  tlogf("[AUTH] Accepted %d frame(s) on 0x%03lX, counter %lu (%lu us)",
+         channel->count, id, counter, verifyUs);
+
+  // Copy out first - handlers may take a while (OTA) and new frames may be held
+  uint8_t count = channel->count;
+  twai_message_t frames[MAX_HELD_FRAMES];
+  memcpy(frames, channel->frames, count * sizeof(twai_message_t));
+  channel->count = 0;
+  for (uint8_t i = 0; i < count; i++) handler(frames[i]);
+  return true;
+}
+
+void ControlAuth::service() {
+  uint32_t counter = lastCounter;
+  if (!authEnabled || counter == savedCounter) return;
+
+  FlashStall::beginWrite();
+  Preferences prefs;
+  prefs.begin("auth", false);
+  prefs.putULong("counter", counter);
+  prefs.end();
+  FlashStall::endWrite();
+  savedCounter = counter;
+}
+
+uint32_t ControlAuth::maxVerifyUs() {
+  return maxVerify;
+}
+
+uint32_t ControlAuth::rejectedCount() {
+  return rejected;
+}
+
+bool ControlAuth::lockedOut() {
+  uint32_t startMs = lockoutStartMs;
+  return startMs != 0 && millis() - startMs < LOCKOUT_MS;
+}
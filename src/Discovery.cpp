@@ -0,0 +1,73 @@
+#include "Discovery.h"
+#include "CanTx.h"
+#include "ControlAuth.h"
+#include <esp_app_desc.h>
+#include <esp_mac.h>
+#include <esp_timer.h>
+
+static uint32_t replyId = 0;
+static uint8_t slot = 0;
+static uint16_t enabled = 0;
+static uint8_t identity[8];
+static volatile uint8_t pendingNonce = 0;
+static esp_timer_handle_t replyTimer = nullptr;
+
+void Discovery::begin(uint8_t dipAddress, uint32_t id, uint16_t enabledMask) {
+  replyId = id;
+  slot = dipAddress;
+  enabled = enabledMask;
+
+  uint8_t mac[6];
+  esp_read_mac(mac, ESP_MAC_WIFI_STA);
+  const esp_app_desc_t* app = esp_app_get_description();
+  identity[0] = REPLY_IDENTITY;
+  memcpy(&identity[1], &mac[3], 3);
+  memcpy(&identity[4], app->app_elf_sha256, 4);
+
+  esp_timer_create_args_t args = {};
+  args.callback = sendReply;
+  args.name = "discovery";
+  esp_timer_create(&args, &replyTimer);
+}
+
+void Discovery::setEnabledMask(uint16_t enabledMask) {
+  enabled = enabledMask;
+}
+
+void Discovery::handleRequest(const twai_message_t& msg) {
+  if (!replyTimer) return;
+  pendingNonce = msg.data_length_code >= 1 ? msg.data[0] : 0;
+  // A repeated request restarts the slot rather than queueing a second reply
+  esp_timer_stop(replyTimer);
+  esp_timer_start_once(replyTimer, (uint64_t)slot * SLOT_US + 1);
+}
+
+void Discovery::sendReply(void* arg) {
+  twai_message_t msg = {};
+  msg.identifier = replyId;
+  msg.data_length_code = 8;
+  memcpy(msg.data, identity, sizeof(identity));
+  CanTx::send(msg);
+
+  uint32_t uptime = (uint32_t)(esp_timer_get_time() / 1000000);
+  msg.data[0] = REPLY_STATUS;
+  msg.data[1] = pendingNonce;
+  msg.data[2] = (uint8_t)(uptime & 0xFF);
+  msg.data[3] = (uint8_t)((uptime >> 8) & 0xFF);
+  msg.data[4] = (uint8_t)((uptime >> 16) & 0xFF);
+  msg.data[5] = (uint8_t)(uptime >> 24);
+  msg.data[6] = (uint8_t)(enabled & 0xFF);
+  msg.data[7] = (uint8_t)(enabled >> 8);
+  CanTx::send(msg);
+
+  uint16_t verifyUs = (uint16_t)min(ControlAuth::maxVerifyUs(), (uint32_t)0xFFFF);
+  uint16_t rejected = (uint16_t)min(ControlAuth::rejectedCount(), (uint32_t)0xFFFF);
+  msg.data[0] = REPLY_AUTH;
+  msg.data[2] = (uint8_t)(verifyUs & 0xFF);
+  msg.data[3] = (uint8_t)(verifyUs >> 8);
+  msg.data[4] = (uint8_t)(rejected & 0xFF);
+  msg.data[5] = (uint8_t)(rejected >> 8);
+  msg.data[6] = (ControlAuth::enabled() ? 0x01 : 0) | (ControlAuth::lockedOut() ? 0x02 : 0);
+  msg.data[7] = 0;
+  CanTx::send(msg);
+}
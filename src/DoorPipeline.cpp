@@ -0,0 +1,55 @@
+#include "DoorPipeline.h"
+
+void DoorPipeline::begin(uint16_t state, uint32_t heartbeatMs, uint32_t eventId,
+                         uint32_t heartbeatId) {
+  this->eventId = eventId;
+  this->heartbeatId = heartbeatId;
+  current = state;
+  lastSampleUs = 0;
+  newestEdgeUs = 0;
+  for (int64_t& edgeUs : channelEdgeUs) edgeUs = 0;
+  reporter.begin(state, heartbeatMs);
+}
+
+uint16_t DoorPipeline::sample(uint16_t raw, uint16_t otherState, int64_t sampleUs,
+                              uint32_t nowMs, EdgeReader edges, void* context) {
+  lastSampleUs = sampleUs;
+  uint16_t debounced = debouncer.update(raw, nowMs) | otherState;
+  uint16_t changed = debounced ^ current;
+  current = debounced;
+
+  for (uint8_t i = 0; i < ReedDebouncer::MAX_CHANNELS; i++) {
+    if (!(changed & (1 << i))) continue;
+    // Debounce confirms only after a quiet period, so the newest edge is
+    // the last contact edge of the change
+    int64_t edgeUs = edges ? edges(i, context) : -1;
+    if (edgeUs < 0) {
+      edgeUs = i < debouncer.channelCount() ? (int64_t)debouncer.lastEdgeMs(i) * 1000
+                                            : (int64_t)nowMs * 1000;
+    }
+    channelEdgeUs[i] = edgeUs;
+    if (edgeUs > newestEdgeUs) newestEdgeUs = edgeUs;
+  }
+  return changed;
+}
+
+uint8_t DoorPipeline::report(uint32_t nowMs, CanFrame frames[2]) {
+  uint8_t due = reporter.update(current, nowMs);
+  for (uint8_t kind = 0; kind < 2; kind++) {
+    if (!(due & (kind ? DoorReporter::SEND_HEARTBEAT : DoorReporter::SEND_EVENT))) continue;
+    CanFrame& frame = frames[kind];
+    frame = {};
+    frame.id = kind ? heartbeatId : eventId;
+    frame.dlc = 8;
+    // Bytes 4-7 are filled in by queued()
+    DoorReporter::encodeStatus(reporter.lastState(), lastSampleUs, newestEdgeUs, frame.data);
+    frame.sampleUs = (uint32_t)lastSampleUs;
+  }
+  return due;
+}
+
+void DoorPipeline::queued(CanFrame& frame, int64_t queueUs, int64_t queueBusUs) const {
+  if (frame.id != eventId && frame.id != heartbeatId) return;
+  DoorReporter::encodeQueued((uint32_t)queueUs - frame.sampleUs, (uint16_t)queueBusUs,
+                             frame.data);
+}
@@ -0,0 +1,91 @@
+#include "DoorReporter.h"
+
+void DoorReporter::begin(uint16_t initialState, uint32_t heartbeatMs) {
+  reported = initialState;
+  observed = initialState;
+  this->heartbeatMs = heartbeatMs;
+  started = false;
+  windowOpen = false;
+  transitions = 0;
+  events = 0;
+}
+
+uint8_t DoorReporter::update(uint16_t state, uint32_t nowMs) {
+  if (state != observed) {
+    // Count per channel: each would have been a frame of its own
+    transitions += __builtin_popcount((uint16_t)(state ^ observed));
+    observed = state;
+    if (!windowOpen) {
+      windowOpen = true;
+      windowStartMs = nowMs;
+    }
+  }
+
+  uint8_t due = 0;
+  if (windowOpen) {
+    // The heartbeat waits too, the event follows within the window
+    if (nowMs - windowStartMs < coalesceMs) return 0;
+    windowOpen = false;
+    // A door that bounced back inside the window needs no frame at all
+    if (observed != reported) {
+      reported = observed;
+      events++;
+      due = SEND_EVENT;
+    }
+  }
+  if (!due && (!started || nowMs - lastTxMs >= heartbeatMs)) {
+    due = SEND_HEARTBEAT;
+  }
+  // An event restarts the heartbeat interval, it already carries the state
+  if (due) {
+    started = true;
+    lastTxMs = nowMs;
+  }
+  return due;
+}
+
+void DoorReporter::encodeStatus(uint16_t state, int64_t sampleUs, int64_t lastEdgeUs,
+                                uint8_t *data) {
+  // Byte 0: RSW01-RSW08, byte 1: RSW09-RSW10 in bits 0-1, bits 2-7 reserved
+  data[0] = (uint8_t)(state & 0xFF);
+  data[1] = (uint8_t)((state >> 8) & 0x03);
+
+  uint32_t ageMs = (uint32_t)((sampleUs - lastEdgeUs) / 1000);
+  if (lastEdgeUs == 0 || ageMs > 0xFFFF) ageMs = 0xFFFF;
+  data[2] = (uint8_t)(ageMs & 0xFF);
+  data[3] = (uint8_t)(ageMs >> 8);
+}
+
+void DoorReporter::encodeQueued(uint32_t delayUs, uint16_t queueBusUs, uint8_t *data) {
+  if (delayUs > 0xFFFF) delayUs = 0xFFFF;
+  data[4] = (uint8_t)(delayUs & 0xFF);
+  data[5] = (uint8_t)(delayUs >> 8);
+  data[6] = (uint8_t)(queueBusUs & 0xFF);
+  data[7] = (uint8_t)(queueBusUs >> 8);
+}
+
+uint32_t DoorReporter::msUntilDue(uint32_t nowMs) const {
+  if (windowOpen) {
+    uint32_t open = nowMs - windowStartMs;
+    return open >= coalesceMs ? 0 : coalesceMs - open;
+  }
+  if (!started) return 0;
+  uint32_t elapsed = nowMs - lastTxMs;
+  return elapsed >= heartbeatMs ? 0 : heartbeatMs - elapsed;
+}
+
+void DoorReporter::setBackoff(const HeartbeatStep *steps, uint8_t count) {
+  this->steps = steps;
+  stepCount = count;
+  step = 0;
+  if (count) heartbeatMs = steps[0].heartbeatMs;
+}
+
+bool DoorReporter::applyBusLoad(uint16_t loadPermille) {
+  if (!stepCount) return false;
+  uint8_t previous = step;
+  while (step + 1 < stepCount && loadPermille >= steps[step + 1].enterPermille) step++;
+  while (step > 0 && loadPermille < steps[step].exitPermille) step--;
+  heartbeatMs = steps[step].heartbeatMs;
+  return step != previous;
+}
@@ -0,0 +1,109 @@
+#include "EdgeCapture.h"
+#include <debug.h>
+#include <driver/gptimer.h>
+#include <driver/gptimer_etm.h>
+#include <driver/gpio_etm.h>
+#include <esp_etm.h>
+#include <esp_timer.h>
+
+static gptimer_handle_t captureTimer = nullptr;
+static esp_etm_task_handle_t captureTask = nullptr;
+static esp_etm_event_handle_t edgeEvents[EdgeCapture::MAX_CHANNELS];
+static esp_etm_channel_handle_t etmChannels[EdgeCapture::MAX_CHANNELS];
+static uint16_t covered = 0;
+static uint64_t startCapture = 0;
+static int64_t timerOffsetUs = 0;
+
+// Per-channel times rebuilt from the shared capture (main loop only)
+static int64_t channelEdgeUs[EdgeCapture::MAX_CHANNELS];
+static int64_t attributedUs = -1;
+static uint16_t unmatched = 0;  // Moved, capture not seen yet
+
+static bool routePin(uint8_t index, gpio_num_t pin) {
+  gpio_etm_event_config_t eventConfig = {};
+  eventConfig.edge = GPIO_ETM_EVENT_EDGE_ANY;
+  if (gpio_new_etm_event(&eventConfig, &edgeEvents[index]) != ESP_OK) return false;
+  if (gpio_etm_event_bind_gpio(edgeEvents[index], pin) != ESP_OK) return false;
+
+  esp_etm_channel_config_t channelConfig = {};
+  if (esp_etm_new_channel(&channelConfig, &etmChannels[index]) != ESP_OK) return false;
+  if (esp_etm_channel_connect(etmChannels[index], edgeEvents[index], captureTask) != ESP_OK) {
+    return false;
+  }
+  return esp_etm_channel_enable(etmChannels[index]) == ESP_OK;
+}
+
+uint8_t EdgeCapture::begin(const gpio_num_t* pins, uint8_t count) {
+  gptimer_config_t timerConfig = {};
+  timerConfig.clk_src = GPTIMER_CLK_SRC_DEFAULT;
+  timerConfig.direction = GPTIMER_COUNT_UP;
+  timerConfig.resolution_hz = 1000000;
+  if (gptimer_new_timer(&timerConfig, &captureTimer) != ESP_OK) {
+    debugln("[ETM] ERROR: no general-purpose timer available");
+    return 0;
+  }
+
+  gptimer_etm_task_conf_t taskConfig = {};
+  taskConfig.task_type = GPTIMER_ETM_TASK_CAPTURE;
+  if (gptimer_new_etm_task(captureTimer, &taskConfig, &captureTask) != ESP_OK) {
+    debugln("[ETM] ERROR: failed to create capture task");
+    return 0;
+  }
+
+  if (count > MAX_CHANNELS) count = MAX_CHANNELS;
+  for (uint8_t i = 0; i < MAX_CHANNELS; i++) channelEdgeUs[i] = -1;
+  for (uint8_t i = 0; i < count; i++) {
+    if (!routePin(i, pins[i])) {
+      debugf("[ETM] GPIO%d not routed - falling back to software timestamps\n", pins[i]);
+      break;
+    }
+    covered |= (1 << i);
+  }
+
+  gptimer_enable(captureTimer);
+  gptimer_start(captureTimer);
+
+  // Reading the raw count latches into the same register the ETM capture uses,
+  // so the offset to esp_timer is measured once here and never again. Both
+  // clocks derive from the main crystal and do not drift relative to each other.
+  gptimer_get_raw_count(captureTimer, &startCapture);
+  timerOffsetUs = esp_timer_get_time() - (int64_t)startCapture;
+  return __builtin_popcount(covered);
+}
+
+uint16_t EdgeCapture::coveredMask() {
+  return covered;
+}
+
+int64_t EdgeCapture::capturedUs() {
+  if (!captureTimer) return -1;
+
+  uint64_t captured = 0;
+  gptimer_get_captured_count(captureTimer, &captured);
+  if (captured == startCapture) return -1;
+
+  return timerOffsetUs + (int64_t)captured;
+}
+
+void EdgeCapture::attribute(int64_t capturedUs, uint16_t movedMask) {
+  movedMask &= covered;
+  // A moved channel's newest edge is unknown until a capture is credited
+  for (uint8_t i = 0; i < MAX_CHANNELS; i++) {
+    if (movedMask & (1 << i)) channelEdgeUs[i] = -1;
+  }
+  unmatched |= movedMask;
+  if (capturedUs < 0 || capturedUs == attributedUs) return;
+
+  // New capture: it belongs to one of the channels that moved since the
+  // last one, and is only usable if that is a single channel
+  attributedUs = capturedUs;
+  if (__builtin_popcount(unmatched) == 1) {
+    channelEdgeUs[__builtin_ctz(unmatched)] = capturedUs;
+  }
+  unmatched = 0;
+}
+
+int64_t EdgeCapture::lastEdgeUs(uint8_t channel) {
+  if (channel >= MAX_CHANNELS) return -1;
+  return channelEdgeUs[channel];
+}
@@ -0,0 +1,107 @@
+#include "EventHistory.h"
+#include "CanOta.h"
+#include "CanTx.h"
+#include "EventLog.h"
+
+static const uint8_t FRAMES_PER_BLOCK =
+    (EventLog::BLOCK_SIZE + EventHistory::FRAME_PAYLOAD - 1) / EventHistory::FRAME_PAYLOAD;
+static const unsigned long FRAME_INTERVAL_MS = 1;
+
+static uint8_t targetBit = 0;
+static uint32_t replyId = 0;
+static portMUX_TYPE historyMux = portMUX_INITIALIZER_UNLOCKED;
+
+static uint8_t storage[EventHistory::BLOCK_COUNT * EventLog::BLOCK_SIZE];
+static EventLog eventLog;
+
+// Block being drained: copied on READ, sent by the main loop
+static uint8_t drainBuffer[EventLog::BLOCK_SIZE];
+static uint8_t drainBlock = 0;
+static uint8_t drainFrame = 0;
+static bool drainEmpty = false;
+static volatile bool drainPending = false;
+static unsigned long lastFrameMs = 0;
+
+void EventHistory::begin(uint8_t dipAddress, uint32_t id, uint16_t state, uint64_t timeMs) {
+  targetBit = 1 << dipAddress;
+  replyId = id;
+  taskENTER_CRITICAL(&historyMux);
+  eventLog.begin(storage, BLOCK_COUNT, state, timeMs);
+  taskEXIT_CRITICAL(&historyMux);
+}
+
+void EventHistory::record(uint8_t channel, bool open, uint64_t timeMs) {
+  taskENTER_CRITICAL(&historyMux);
+  eventLog.append(channel, open, timeMs);
+  taskEXIT_CRITICAL(&historyMux);
+}
+
+void EventHistory::handleCommand(const twai_message_t& msg) {
+  if (msg.data_length_code < 2 || !(msg.data[0] & targetBit)) return;
+
+  switch (msg.data[1]) {
+    case CMD_STATUS: {
+      taskENTER_CRITICAL(&historyMux);
+      uint32_t events = eventLog.eventCount();
+      uint8_t args[7] = {
+        (uint8_t)eventLog.blockCount(), (uint8_t)eventLog.usedBlocks(),
+        (uint8_t)eventLog.currentBlock(),
+        (uint8_t)(events & 0xFF), (uint8_t)((events >> 8) & 0xFF),
+        (uint8_t)((events >> 16) & 0xFF), (uint8_t)(events >> 24),
+      };
+      taskEXIT_CRITICAL(&historyMux);
+      CanTx::sendStatus(replyId, STATUS_STATUS, args, sizeof(args));
+      break;
+    }
+    case CMD_READ: {
+      if (msg.data_length_code < 3) return;
+      if (drainPending) {
+        CanTx::sendError(replyId, ERR_BUSY);
+        return;
+      }
+      if (msg.data[2] >= BLOCK_COUNT) {
+        CanTx::sendError(replyId, ERR_RANGE);
+        return;
+      }
+      taskENTER_CRITICAL(&historyMux);
+      memcpy(drainBuffer, eventLog.block(msg.data[2]), sizeof(drainBuffer));
+      // The ring fills from block 0, so blocks past the used count are blank
+      drainEmpty = msg.data[2] >= eventLog.usedBlocks();
+      taskEXIT_CRITICAL(&historyMux);
+      drainBlock = msg.data[2];
+      drainFrame = 0;
+      drainPending = true;
+      break;
+    }
+    default:
+      break;
+  }
+}
+
+void EventHistory::service(unsigned long nowMs) {
+  if (!drainPending || nowMs - lastFrameMs < FRAME_INTERVAL_MS) return;
+  lastFrameMs = nowMs;
+
+  if (!drainEmpty && drainFrame < FRAMES_PER_BLOCK) {
+    uint16_t pos = (uint16_t)drainFrame * FRAME_PAYLOAD;
+    uint8_t length = min((uint16_t)FRAME_PAYLOAD, (uint16_t)(sizeof(drainBuffer) - pos));
+    twai_message_t msg = {};
+    msg.identifier = replyId;
+    msg.data_length_code = 1 + length;
+    msg.data[0] = drainFrame;
+    memcpy(&msg.data[1], &drainBuffer[pos], length);
+    CanTx::send(msg);
+    drainFrame++;
+    return;
+  }
+
+  uint16_t crc = CanOta::crc16(drainBuffer, sizeof(drainBuffer));
+  uint8_t args[4] = { drainBlock, (uint8_t)(crc & 0xFF), (uint8_t)(crc >> 8),
+                      (uint8_t)(drainEmpty ? 1 : 0) };
+  CanTx::sendStatus(replyId, STATUS_END, args, sizeof(args));
+  drainPending = false;
+}
+
+bool EventHistory::draining() {
+  return drainPending;
+}
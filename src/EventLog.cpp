@@ -0,0 +1,94 @@
+#include "EventLog.h"
+
+#include <string.h>
+
+static uint8_t varintLength(uint64_t value) {
+  uint8_t length = 1;
+  while (value >= 0x80) {
+    value >>= 7;
+    length++;
+  }
+  return length;
+}
+
+void EventLog::begin(uint8_t* memory, uint16_t blockCount, uint16_t initialState,
+                     uint64_t timeMs) {
+  storage = memory;
+  blocks = blockCount;
+  memset(storage, END, (uint32_t)blocks * BLOCK_SIZE);
+  used = 0;
+  current = blocks - 1;  // openBlock() advances to block 0
+  sequence = 0;
+  state = initialState;
+  events = 0;
+  bytes = 0;
+  openBlock(timeMs);
+}
+
+void EventLog::openBlock(uint64_t timeMs) {
+  current = (current + 1) % blocks;
+  if (used < blocks) used++;
+
+  uint8_t* out = &storage[(uint32_t)current * BLOCK_SIZE];
+  memset(out, END, BLOCK_SIZE);
+  for (uint8_t i = 0; i < 4; i++) out[i] = (uint8_t)(sequence >> (8 * i));
+  for (uint8_t i = 0; i < 6; i++) out[4 + i] = (uint8_t)(timeMs >> (8 * i));
+  out[10] = (uint8_t)(state & 0xFF);
+  out[11] = (uint8_t)(state >> 8);
+  sequence++;
+
+  length = HEADER_SIZE;
+  runHeader = -1;
+  lastMs = timeMs;
+}
+
+uint8_t EventLog::putVarint(uint64_t value) {
+  uint8_t* out = &storage[(uint32_t)current * BLOCK_SIZE];
+  uint8_t start = length;
+  while (value >= 0x80) {
+    out[length++] = (uint8_t)(value | 0x80);
+    value >>= 7;
+  }
+  out[length++] = (uint8_t)value;
+  return length - start;
+}
+
+void EventLog::append(uint8_t channel, bool open, uint64_t timeMs) {
+  if (!storage || channel >= MAX_CHANNELS) return;
+  if (timeMs < lastMs) timeMs = lastMs;
+  uint64_t delta = timeMs - lastMs;
+  uint8_t* out = &storage[(uint32_t)current * BLOCK_SIZE];
+  uint8_t before = length;
+
+  // Extend the previous record when this is the next toggle of its channel
+  if (runHeader >= 0) {
+    uint8_t header = out[runHeader];
+    uint8_t run = header & 0x07;
+    bool lastOpen = ((header >> 3) & 1) ^ (run & 1);
+    if ((header >> 4) == channel && run < MAX_RUN && open != lastOpen &&
+        BLOCK_SIZE - length >= varintLength(delta)) {
+      out[runHeader] = header + 1;
+      putVarint(delta);
+      bytes += length - before;
+      events++;
+      lastMs = timeMs;
+      state = open ? (state | (1 << channel)) : (state & ~(1 << channel));
+      return;
+    }
+  }
+
+  if (BLOCK_SIZE - length < 1 + varintLength(delta)) {
+    // The checkpoint takes this change's time, so its delta becomes 0
+    openBlock(timeMs);
+    out = &storage[(uint32_t)current * BLOCK_SIZE];
+    delta = 0;
+    before = length;
+  }
+  runHeader = length;
+  out[length++] = (uint8_t)((channel << 4) | (open ? 0x08 : 0));
+  putVarint(delta);
+  bytes += length - before;
+  events++;
+  lastMs = timeMs;
+  state = open ? (state | (1 << channel)) : (state & ~(1 << channel));
+}
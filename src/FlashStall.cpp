@@ -0,0 +1,91 @@
+#include "FlashStall.h"
+#include "TokenLog.h"
+#include <esp_attr.h>
+#include <esp_timer.h>
+
+// Written by the edge interrupt, which runs with the flash cache off -
+// handler in IRAM, everything it touches in DRAM. 0 = no edge yet.
+static DRAM_ATTR volatile int64_t edgeUs[FlashStall::MAX_CHANNELS];
+static DRAM_ATTR volatile uint32_t edgeCount = 0;
+static uint16_t covered = 0;
+static portMUX_TYPE edgeMux = portMUX_INITIALIZER_UNLOCKED;
+
+// Flash operations in progress and started so far
+static volatile uint8_t writeDepth = 0;
+static volatile uint32_t writeEpoch = 0;
+static portMUX_TYPE writeMux = portMUX_INITIALIZER_UNLOCKED;
+
+// Sampling side (main loop only)
+static int64_t lastSampleUs = 0;
+static uint32_t sampledEpoch = 0;
+static uint32_t sampledEdges = 0;
+static uint32_t longestGapUs = 0;
+static uint32_t longestFlashGapUs = 0;
+
+static void IRAM_ATTR onEdge(void* arg) {
+  uint32_t channel = (uint32_t)arg;
+  edgeUs[channel] = esp_timer_get_time();
+  edgeCount = edgeCount + 1;
+}
+
+uint8_t FlashStall::begin(const gpio_num_t* pins, uint8_t count) {
+  // Fails if the service was already installed without ESP_INTR_FLAG_IRAM,
+  // in which case the handler would stall with the cache
+  if (gpio_install_isr_service(ESP_INTR_FLAG_IRAM) != ESP_OK) {
+    tlogf("[FLASH] ERROR: IRAM GPIO interrupt service unavailable");
+    return 0;
+  }
+
+  if (count > MAX_CHANNELS) count = MAX_CHANNELS;
+  for (uint8_t i = 0; i < count; i++) {
+    if (gpio_set_intr_type(pins[i], GPIO_INTR_ANYEDGE) != ESP_OK ||
+        gpio_isr_handler_add(pins[i], onEdge, (void*)(uint32_t)i) != ESP_OK) {
+      continue;
+    }
+    gpio_intr_enable(pins[i]);
+    covered |= (1 << i);
+  }
+  return __builtin_popcount(covered);
+}
+
+int64_t FlashStall::lastEdgeUs(uint8_t channel) {
+  if (channel >= MAX_CHANNELS || !(covered & (1 << channel))) return -1;
+  // 64-bit value written by the interrupt - read it with interrupts masked
+  taskENTER_CRITICAL(&edgeMux);
+  int64_t timeUs = edgeUs[channel];
+  taskEXIT_CRITICAL(&edgeMux);
+  return timeUs ? timeUs : -1;
+}
+
+void FlashStall::beginWrite() {
+  taskENTER_CRITICAL(&writeMux);
+  writeDepth++;
+  writeEpoch++;
+  taskEXIT_CRITICAL(&writeMux);
+}
+
+void FlashStall::endWrite() {
+  taskENTER_CRITICAL(&writeMux);
+  if (writeDepth) writeDepth--;
+  taskEXIT_CRITICAL(&writeMux);
+}
+
+void FlashStall::sample(int64_t nowUs) {
+  taskENTER_CRITICAL(&writeMux);
+  bool flashInGap = writeDepth > 0 || writeEpoch != sampledEpoch;
+  sampledEpoch = writeEpoch;
+  taskEXIT_CRITICAL(&writeMux);
+  uint32_t edges = edgeCount;
+
+  if (lastSampleUs) {
+    uint32_t gapUs = (uint32_t)(nowUs - lastSampleUs);
+    if (gapUs > longestGapUs) longestGapUs = gapUs;
+    if (flashInGap && gapUs > longestFlashGapUs) {
+      longestFlashGapUs = gapUs;
+      tlogf("[FLASH] Sampling gap %lu us during flash write, %lu edges latched "
+            "(longest gap overall %lu us)", gapUs, edges - sampledEdges, longestGapUs);
+    }
+  }
+  lastSampleUs = nowUs;
+  sampledEdges = edges;
+}
@@ -0,0 +1,61 @@
+#include "GlitchFilters.h"
+#include <debug.h>
+#include <driver/gpio_filter.h>
+
+static const uint8_t MAX_FILTERS = 16;
+static gpio_glitch_filter_handle_t filters[MAX_FILTERS];
+static uint8_t filterCount = 0;
+
+static bool enableFilter(gpio_glitch_filter_handle_t filter) {
+  if (gpio_glitch_filter_enable(filter) != ESP_OK) {
+    gpio_del_glitch_filter(filter);
+    return false;
+  }
+  filters[filterCount++] = filter;
+  return true;
+}
+
+uint8_t GlitchFilters::apply(const gpio_num_t* pins, const ReedChannelConfig* config,
+                             uint8_t count) {
+  release();
+
+  for (uint8_t i = 0; i < count && filterCount < MAX_FILTERS; i++) {
+    if (!config[i].enabled || config[i].glitchFilterNs == 0) continue;
+
+    uint16_t windowNs = config[i].glitchFilterNs;
+    if (windowNs > MAX_WINDOW_NS) windowNs = MAX_WINDOW_NS;
+
+    gpio_glitch_filter_handle_t filter = nullptr;
+
+    gpio_flex_glitch_filter_config_t flexConfig = {};
+    flexConfig.clk_src = GLITCH_FILTER_CLK_SRC_DEFAULT;
+    flexConfig.gpio_num = pins[i];
+    flexConfig.window_width_ns = windowNs;
+    flexConfig.window_thres_ns = windowNs;
+    if (gpio_new_flex_glitch_filter(&flexConfig, &filter) == ESP_OK &&
+        enableFilter(filter)) {
+      continue;
+    }
+
+    // Flexible filters exhausted - fixed 2-clock pin filter is better than none
+    gpio_pin_glitch_filter_config_t pinConfig = {};
+    pinConfig.clk_src = GLITCH_FILTER_CLK_SRC_DEFAULT;
+    pinConfig.gpio_num = pins[i];
+    if (gpio_new_pin_glitch_filter(&pinConfig, &filter) == ESP_OK &&
+        enableFilter(filter)) {
+      debugf("[GLITCH] GPIO%d: pin filter only (no flex filter left)\n", pins[i]);
+    } else {
+      debugf("[GLITCH] GPIO%d: no glitch filter available\n", pins[i]);
+    }
+  }
+
+  return filterCount;
+}
+
+void GlitchFilters::release() {
+  for (uint8_t i = 0; i < filterCount; i++) {
+    gpio_glitch_filter_disable(filters[i]);
+    gpio_del_glitch_filter(filters[i]);
+  }
+  filterCount = 0;
+}
@@ -0,0 +1,132 @@
+#include "HealthLed.h"
+#include <esp_timer.h>
+
+// WS2812 bit timing at a 10 MHz RMT clock: 0 = 0.4 us high, 0.8 us low;
+// 1 = 0.8 us high, 0.4 us low
+static const uint32_t RMT_RESOLUTION_HZ = 10000000;
+static const uint16_t BIT_SHORT_TICKS = 4;
+static const uint16_t BIT_LONG_TICKS = 8;
+
+struct Step {
+  uint8_t red;
+  uint8_t green;
+  uint8_t blue;
+  uint16_t ms;  // 0 = hold
+};
+
+struct PatternDef {
+  const Step* steps;
+  uint8_t count;
+  bool repeat;
+};
+
+static const Step STEPS_OFF[] = { { 0, 0, 0, 0 } };
+static const Step STEPS_OK[] = { { 0, 255, 0, 0 } };
+static const Step STEPS_CAPTURE[] = { { 0, 255, 255, 0 } };
+static const Step STEPS_CONFIG[] = {
+  { 255, 255, 255, 150 }, { 0, 0, 0, 150 },
+  { 255, 255, 255, 150 }, { 0, 0, 0, 150 },
+  { 255, 255, 255, 150 }, { 0, 0, 0, 0 },
+};
+static const Step STEPS_FAULT[] = { { 255, 120, 0, 500 }, { 0, 0, 0, 500 } };
+static const Step STEPS_TX_FAILING[] = { { 255, 0, 0, 250 }, { 0, 0, 0, 250 } };
+static const Step STEPS_BUS_OFF[] = { { 255, 0, 0, 0 } };
+static const Step STEPS_UPDATE[] = { { 0, 0, 255, 100 }, { 0, 0, 0, 100 } };
+
+#define PATTERN(steps, repeat) { steps, sizeof(steps) / sizeof(steps[0]), repeat }
+
+static const PatternDef PATTERNS[HealthLed::PATTERN_COUNT] = {
+  PATTERN(STEPS_OFF, false),         // PATTERN_OFF
+  PATTERN(STEPS_OK, false),          // PATTERN_OK
+  PATTERN(STEPS_CAPTURE, false),     // PATTERN_CAPTURE
+  PATTERN(STEPS_CONFIG, false),      // PATTERN_CONFIG
+  PATTERN(STEPS_FAULT, true),        // PATTERN_FAULT
+  PATTERN(STEPS_TX_FAILING, true),   // PATTERN_TX_FAILING
+  PATTERN(STEPS_BUS_OFF, false),     // PATTERN_BUS_OFF
+  PATTERN(STEPS_UPDATE, true),       // PATTERN_UPDATE
+};
+
+static int ledPin = -1;
+static uint8_t brightness = 100;
+static esp_timer_handle_t stepTimer = nullptr;
+static HealthLed::Pattern pattern = HealthLed::PATTERN_OFF;
+static uint8_t step = 0;
+static bool suspended = false;
+
+// Read by the RMT driver while it shifts out - untouched until the next step
+static rmt_data_t symbols[24];
+
+static uint8_t scale(uint8_t value) {
+  if (!value) return 0;
+  uint16_t scaled = (uint16_t)value * brightness / 100;
+  return scaled ? scaled : 1;
+}
+
+static void writeColor(const Step& s) {
+  // WS2812 takes green, red, blue, most significant bit first
+  uint32_t grb = ((uint32_t)scale(s.green) << 16) | ((uint32_t)scale(s.red) << 8) | scale(s.blue);
+  for (uint8_t i = 0; i < 24; i++) {
+    bool one = grb & (1UL << (23 - i));
+    symbols[i].level0 = 1;
+    symbols[i].duration0 = one ? BIT_LONG_TICKS : BIT_SHORT_TICKS;
+    symbols[i].level1 = 0;
+    symbols[i].duration1 = one ? BIT_SHORT_TICKS : BIT_LONG_TICKS;
+  }
+  rmtWriteAsync(ledPin, symbols, 24);
+}
+
+// Show the current step and arm the timer for the next one, if any
+static void showStep() {
+  const PatternDef& def = PATTERNS[pattern];
+  const Step& s = def.steps[step];
+  writeColor(s);
+  if (!s.ms || (step + 1 >= def.count && !def.repeat)) return;
+  esp_timer_start_once(stepTimer, (uint64_t)s.ms * 1000);
+}
+
+// esp_timer task. On the single-core C6 it cannot run in the middle of
+// show(), which stops the timer before touching the pattern.
+static void onStep(void* arg) {
+  if (suspended) return;
+  step = (step + 1) % PATTERNS[pattern].count;
+  showStep();
+}
+
+bool HealthLed::begin(uint8_t pin, uint8_t brightnessPercent) {
+  ledPin = pin;
+  brightness = brightnessPercent > 100 ? 100 : brightnessPercent;
+
+  esp_timer_create_args_t timerArgs = {};
+  timerArgs.callback = onStep;
+  timerArgs.name = "healthled";
+  if (esp_timer_create(&timerArgs, &stepTimer) != ESP_OK) return false;
+
+  return rmtInit(ledPin, RMT_TX_MODE, RMT_MEM_NUM_BLOCKS_1, RMT_RESOLUTION_HZ);
+}
+
+void HealthLed::show(Pattern next) {
+  if (next == pattern || next >= PATTERN_COUNT || !stepTimer) return;
+  esp_timer_stop(stepTimer);
+  pattern = next;
+  step = 0;
+  if (!suspended) showStep();
+}
+
+HealthLed::Pattern HealthLed::current() {
+  return pattern;
+}
+
+void HealthLed::suspend() {
+  suspended = true;
+  if (stepTimer) esp_timer_stop(stepTimer);
+}
+
+void HealthLed::resume() {
+  if (!suspended) return;
+  suspended = false;
+  // The other driver may have re-initialized the pin for itself
+  if (rmtInit(ledPin, RMT_TX_MODE, RMT_MEM_NUM_BLOCKS_1, RMT_RESOLUTION_HZ)) {
+    step = 0;
+    showStep();
+  }
+}
@@ -0,0 +1,91 @@
+#include "ImageCodec.h"
+#include <string.h>
+
+static bool readVarint(const uint8_t*& p, const uint8_t* end, uint32_t& value) {
+  value = 0;
+  for (uint8_t shift = 0; shift < 32; shift += 7) {
+    if (p >= end) return false;
+    uint8_t byte = *p++;
+    value |= (uint32_t)(byte & 0x7F) << shift;
+    if (!(byte & 0x80)) return true;
+  }
+  return false;
+}
+
+bool ImageCodec::parseHeader(const uint8_t* in, size_t inLength, Header& header) {
+  if (inLength < HEADER_SIZE) return false;
+  header.format = in[0];
+  header.outOffset = in[1] | (in[2] << 8) | ((uint32_t)in[3] << 16);
+  header.outLength = in[4] | (in[5] << 8);
+  return header.outLength <= MAX_OUTPUT &&
+         (header.format == FORMAT_RAW || header.format == FORMAT_LZ);
+}
+
+bool ImageCodec::decode(const uint8_t* in, size_t inLength, uint8_t* out,
+                        Header& header, SourceReader source, void* context) {
+  if (!parseHeader(in, inLength, header)) return false;
+
+  const uint8_t* p = in + HEADER_SIZE;
+  const uint8_t* end = in + inLength;
+
+  if (header.format == FORMAT_RAW) {
+    if ((size_t)(end - p) < header.outLength) return false;
+    memcpy(out, p, header.outLength);
+    return true;
+  }
+
+  uint16_t pos = 0;
+  while (pos < header.outLength) {
+    if (p >= end) return false;
+    uint8_t token = *p++;
+    uint8_t kind = token >> 6;
+    uint32_t count = token & 0x3F;
+    if (count == 0x3F) {
+      uint32_t extra;
+      if (!readVarint(p, end, extra)) return false;
+      count += extra;
+    }
+
+    switch (kind) {
+      case 0: {
+        uint32_t length = count + 1;
+        if (length > (uint32_t)(header.outLength - pos) || (size_t)(end - p) < length) {
+          return false;
+        }
+        memcpy(&out[pos], p, length);
+        p += length;
+        pos += length;
+        break;
+      }
+      case 1: {
+        uint32_t length = count + 3;
+        uint32_t distance;
+        if (!readVarint(p, end, distance)) return false;
+        if (distance == 0 || distance > pos || length > (uint32_t)(header.outLength - pos)) {
+          return false;
+        }
+        // Byte-wise so overlapping runs repeat correctly
+        for (uint32_t i = 0; i < length; i++, pos++) {
+          out[pos] = out[pos - distance];
+        }
+        break;
+      }
+      case 2: {
+        uint32_t length = count + 3;
+        uint32_t zigzag;
+        if (!source || !readVarint(p, end, zigzag)) return false;
+        if (length > (uint32_t)(header.outLength - pos)) return false;
+        int32_t delta = (int32_t)(zigzag >> 1) ^ -(int32_t)(zigzag & 1);
+        int64_t offset = (int64_t)header.outOffset + pos + delta;
+        if (offset < 0 || !source((uint32_t)offset, &out[pos], length, context)) {
+          return false;
+        }
+        pos += length;
+        break;
+      }
+      default:
+        return false;
+    }
+  }
+  return true;
+}
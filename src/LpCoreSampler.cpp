@@ -0,0 +1,97 @@
+#include "LpCoreSampler.h"
+
+#if RSW_LP_CORE
+
+#include <debug.h>
+#include <driver/rtc_io.h>
+#include <esp_sleep.h>
+#include "ulp_lp_core.h"
+#include "ulp_main.h"
+
+extern const uint8_t ulp_main_bin_start[] asm("_binary_ulp_main_bin_start");
+extern const uint8_t ulp_main_bin_end[] asm("_binary_ulp_main_bin_end");
+
+static uint8_t lpPinCount = 0;
+
+bool LpCoreSampler::begin(const gpio_num_t* lpPins, uint8_t lpCount,
+                          uint32_t samplePeriodMs, uint32_t debounceMs) {
+  uint32_t mask = 0;
+  for (uint8_t i = 0; i < lpCount; i++) {
+    gpio_num_t pin = lpPins[i];
+    if (!rtc_gpio_is_valid_gpio(pin) || (uint8_t)pin != i) {
+      debugf("[LP] GPIO%d is not LP IO %d - LP sampling disabled\n", pin, i);
+      return false;
+    }
+    rtc_gpio_init(pin);
+    rtc_gpio_set_direction(pin, RTC_GPIO_MODE_INPUT_ONLY);
+    rtc_gpio_pulldown_dis(pin);
+    rtc_gpio_pullup_en(pin);
+    mask |= (1u << i);
+  }
+  lpPinCount = lpCount;
+
+  esp_err_t err = ulp_lp_core_load_binary(ulp_main_bin_start,
+                                          ulp_main_bin_end - ulp_main_bin_start);
+  if (err != ESP_OK) {
+    debugf("[LP] Failed to load LP core program: %s\n", esp_err_to_name(err));
+    return false;
+  }
+
+  ulp_channel_mask = mask;
+  ulp_debounce_samples = (debounceMs + samplePeriodMs - 1) / samplePeriodMs;
+
+  ulp_lp_core_cfg_t cfg = {};
+  cfg.wakeup_source = ULP_LP_CORE_WAKEUP_SOURCE_LP_TIMER;
+  cfg.lp_timer_sleep_duration_us = samplePeriodMs * 1000;
+
+  err = ulp_lp_core_run(&cfg);
+  if (err != ESP_OK) {
+    debugf("[LP] Failed to start LP core: %s\n", esp_err_to_name(err));
+    return false;
+  }
+
+  esp_sleep_enable_ulp_wakeup();
+  debugf("[LP] Sampling %d inputs every %lu ms (%lu samples debounce)\n",
+         lpCount, samplePeriodMs, ulp_debounce_samples);
+  return true;
+}
+
+uint16_t LpCoreSampler::state() {
+  return (uint16_t)(ulp_confirmed_state & ((1u << lpPinCount) - 1));
+}
+
+bool LpCoreSampler::takeChange() {
+  if (!ulp_change_pending) return false;
+  ulp_change_pending = 0;
+  return true;
+}
+
+uint32_t LpCoreSampler::sampleCount() {
+  return ulp_sample_count;
+}
+
+void LpCoreSampler::lightSleep(uint32_t sleepMs, const gpio_num_t* hpPins,
+                               uint8_t hpCount, uint16_t hpLevels) {
+  if (sleepMs == 0) return;
+
+  for (uint8_t i = 0; i < hpCount; i++) {
+    bool high = hpLevels & (1 << i);
+    gpio_wakeup_enable(hpPins[i], high ? GPIO_INTR_LOW_LEVEL : GPIO_INTR_HIGH_LEVEL);
+  }
+  if (hpCount > 0) {
+    esp_sleep_enable_gpio_wakeup();
+  }
+  esp_sleep_enable_timer_wakeup((uint64_t)sleepMs * 1000);
+
+  esp_light_sleep_start();
+
+  esp_sleep_disable_wakeup_source(ESP_SLEEP_WAKEUP_TIMER);
+  if (hpCount > 0) {
+    esp_sleep_disable_wakeup_source(ESP_SLEEP_WAKEUP_GPIO);
+    for (uint8_t i = 0; i < hpCount; i++) {
+      gpio_wakeup_disable(hpPins[i]);
+    }
+  }
+}
+
+#endif
@@ -0,0 +1,105 @@
+#include "ModuleConfig.h"
+
+const ModuleConfig DEFAULT_CONFIG = {
+  0x03FF,  // All channels enabled
+  50,      // Debounce ms
+  800,     // Glitch filter ns: rejects EMI spikes shorter than this
+  200,     // Heartbeat ms when the door state is unchanged (5 Hz)
+  10,      // Door changes within this window of the first share one event frame
+  // Heartbeat back-off by measured bus load: enter at / leave below
+  // (permille), heartbeat interval while in the step
+  { 600, 800 },
+  { 500, 700 },
+  { 500, 1000 },
+  // Wiring classification thresholds (short / closed / open max mV) for a
+  // 2.2k series / 220k EOL resistor loop against the ~45k internal pull-up
+  70, 1000, 3000,
+};
+
+static void put16(uint8_t* out, uint8_t& pos, uint16_t value) {
+  out[pos++] = (uint8_t)(value & 0xFF);
+  out[pos++] = (uint8_t)(value >> 8);
+}
+
+static uint16_t get16(const uint8_t* in, uint8_t& pos) {
+  uint16_t value = in[pos] | (in[pos + 1] << 8);
+  pos += 2;
+  return value;
+}
+
+void ModuleConfigCodec::encode(const ModuleConfig& config, uint8_t* out) {
+  uint8_t pos = 0;
+  out[pos++] = VERSION;
+  put16(out, pos, config.enabledMask);
+  put16(out, pos, config.debounceMs);
+  put16(out, pos, config.glitchFilterNs);
+  put16(out, pos, config.heartbeatMs);
+  out[pos++] = config.coalesceMs;
+  for (uint8_t i = 0; i < 2; i++) {
+    put16(out, pos, config.backoffEnterPermille[i]);
+    put16(out, pos, config.backoffExitPermille[i]);
+    put16(out, pos, config.backoffHeartbeatMs[i]);
+  }
+  put16(out, pos, config.wiringShortMaxMv);
+  put16(out, pos, config.wiringClosedMaxMv);
+  put16(out, pos, config.wiringOpenMaxMv);
+}
+
+bool ModuleConfigCodec::decode(const uint8_t* in, uint8_t length, ModuleConfig& config) {
+  if (length < ENCODED_SIZE || in[0] != VERSION) return false;
+
+  ModuleConfig decoded;
+  uint8_t pos = 1;
+  decoded.enabledMask = get16(in, pos);
+  decoded.debounceMs = get16(in, pos);
+  decoded.glitchFilterNs = get16(in, pos);
+  decoded.heartbeatMs = get16(in, pos);
+  decoded.coalesceMs = in[pos++];
+  for (uint8_t i = 0; i < 2; i++) {
+    decoded.backoffEnterPermille[i] = get16(in, pos);
+    decoded.backoffExitPermille[i] = get16(in, pos);
+    decoded.backoffHeartbeatMs[i] = get16(in, pos);
+  }
+  decoded.wiringShortMaxMv = get16(in, pos);
+  decoded.wiringClosedMaxMv = get16(in, pos);
+  decoded.wiringOpenMaxMv = get16(in, pos);
+
+  if (!valid(decoded)) return false;
+  config = decoded;
+  return true;
+}
+
+bool ModuleConfigCodec::valid(const ModuleConfig& config) {
+  if (config.enabledMask >= (1 << ModuleConfig::CHANNELS)) return false;
+  if (config.debounceMs < 1 || config.debounceMs > 1000) return false;
+  if (config.glitchFilterNs > 800) return false;
+  if (config.heartbeatMs < 50 || config.heartbeatMs > 10000) return false;
+  if (config.coalesceMs > 100) return false;
+
+  // Back-off steps: hysteresis below each threshold, thresholds ascending,
+  // intervals no shorter than the one they replace
+  uint16_t previousEnter = 0;
+  uint16_t previousMs = config.heartbeatMs;
+  for (uint8_t i = 0; i < 2; i++) {
+    uint16_t enter = config.backoffEnterPermille[i];
+    if (enter > 1000 || enter <= previousEnter) return false;
+    if (config.backoffExitPermille[i] >= enter) return false;
+    if (config.backoffHeartbeatMs[i] < previousMs || config.backoffHeartbeatMs[i] > 10000) return false;
+    previousEnter = enter;
+    previousMs = config.backoffHeartbeatMs[i];
+  }
+
+  return config.wiringShortMaxMv < config.wiringClosedMaxMv &&
+         config.wiringClosedMaxMv < config.wiringOpenMaxMv &&
+         config.wiringOpenMaxMv <= 3300;
+}
+
+uint8_t ModuleConfigCodec::heartbeatSteps(const ModuleConfig& config, HeartbeatStep* steps) {
+  steps[0] = { 0, 0, config.heartbeatMs };
+  for (uint8_t i = 0; i < 2; i++) {
+    steps[i + 1] = { config.backoffEnterPermille[i],
+                     config.backoffExitPermille[i],
+                     config.backoffHeartbeatMs[i] };
+  }
+  return HEARTBEAT_STEPS;
+}
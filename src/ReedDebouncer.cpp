@@ -0,0 +1,40 @@
+#include "ReedDebouncer.h"
+
+void ReedDebouncer::begin(const ReedChannelConfig* config, uint8_t count,
+                          uint16_t initialRaw, uint32_t nowMs) {
+  this->config = config;
+  this->count = (count > MAX_CHANNELS) ? MAX_CHANNELS : count;
+  raw = initialRaw & enabledMask();
+  debounced = raw;
+  for (uint8_t i = 0; i < this->count; i++) {
+    edgeMs[i] = nowMs;
+  }
+}
+
+uint16_t ReedDebouncer::update(uint16_t sample, uint32_t nowMs) {
+  sample &= enabledMask();
+
+  uint16_t edges = sample ^ raw;
+  raw = sample;
+
+  for (uint8_t i = 0; i < count; i++) {
+    uint16_t bit = (uint16_t)(1u << i);
+    if (edges & bit) {
+      edgeMs[i] = nowMs;
+    }
+    if (((raw ^ debounced) & bit) &&
+        (nowMs - edgeMs[i]) >= config[i].debounceMs) {
+      debounced = (debounced & ~bit) | (raw & bit);
+    }
+  }
+
+  return debounced;
+}
+
+uint16_t ReedDebouncer::enabledMask() const {
+  uint16_t mask = 0;
+  for (uint8_t i = 0; i < count; i++) {
+    if (config[i].enabled) mask |= (uint16_t)(1u << i);
+  }
+  return mask;
+}
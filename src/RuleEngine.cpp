@@ -0,0 +1,247 @@
+#include "RuleEngine.h"
+
+#include <string.h>
+
+bool RuleEngine::validate(const uint8_t* program, uint8_t length) {
+  RuleEngine scratch;
+  return scratch.load(program, length);
+}
+
+bool RuleEngine::load(const uint8_t* program, uint8_t length) {
+  if (length < 3 || length > MAX_PROGRAM || program[0] != VERSION) return false;
+
+  RuleEngine next;
+  uint8_t pos = 1;
+  next.signalCount = program[pos++];
+  if (next.signalCount > MAX_SIGNALS || pos + next.signalCount * 4 + 1 > length) return false;
+  for (uint8_t i = 0; i < next.signalCount; i++) {
+    Signal& signal = next.signals[i];
+    signal.id = program[pos] | (program[pos + 1] << 8);
+    signal.byte = program[pos + 2];
+    signal.mask = program[pos + 3];
+    if (signal.id > 0x7FF || signal.byte > 7 || signal.mask == 0) return false;
+    pos += 4;
+  }
+
+  next.ruleCount = program[pos++];
+  if (next.ruleCount > MAX_RULES) return false;
+  uint8_t codeLength = 0;
+  uint8_t usedTimers = 0;
+  for (uint8_t r = 0; r < next.ruleCount; r++) {
+    if (pos >= length) return false;
+    Rule& rule = next.rules[r];
+    rule = {};
+    rule.offset = codeLength;
+    rule.length = program[pos++];
+    if (rule.length == 0 || pos + rule.length > length) return false;
+    memcpy(&next.code[codeLength], &program[pos], rule.length);
+    codeLength += rule.length;
+
+    // Walk the bytecode once: operand ranges, stack depth, dependencies
+    const uint8_t* op = &program[pos];
+    uint8_t i = 0;
+    uint8_t depth = 0;
+    while (i < rule.length) {
+      uint8_t operands = 0;
+      switch (op[i]) {
+        case OP_CHANNEL:
+        case OP_SIGNAL:
+        case OP_RULE: {
+          operands = 1;
+          if (i + 1 >= rule.length) return false;
+          uint8_t n = op[i + 1];
+          if (op[i] == OP_CHANNEL) {
+            if (n >= MAX_CHANNELS) return false;
+            rule.channelDeps |= 1 << n;
+          } else if (op[i] == OP_SIGNAL) {
+            if (n >= next.signalCount) return false;
+            rule.signalDeps |= 1 << n;
+          } else {
+            if (n >= r) return false;
+            rule.ruleDeps |= 1 << n;
+          }
+          depth++;
+          break;
+        }
+        case OP_ANY_OPEN:
+        case OP_ALL_OPEN: {
+          operands = 2;
+          if (i + 2 >= rule.length) return false;
+          uint16_t mask = op[i + 1] | (op[i + 2] << 8);
+          if (mask == 0) return false;
+          rule.channelDeps |= mask;
+          depth++;
+          break;
+        }
+        case OP_NOT:
+          if (depth < 1) return false;
+          break;
+        case OP_AND:
+        case OP_OR:
+        case OP_XOR:
+          if (depth < 2) return false;
+          depth--;
+          break;
+        case OP_HELD: {
+          operands = 3;
+          if (i + 3 >= rule.length || depth < 1) return false;
+          uint8_t timer = op[i + 1];
+          if (timer >= MAX_TIMERS || (usedTimers & (1 << timer))) return false;
+          usedTimers |= 1 << timer;
+          rule.timerMask |= 1 << timer;
+          next.timerMs[timer] = op[i + 2] | (op[i + 3] << 8);
+          break;
+        }
+        default:
+          return false;
+      }
+      if (depth > MAX_STACK) return false;
+      i += 1 + operands;
+    }
+    if (depth != 1) return false;
+    pos += rule.length;
+  }
+  if (pos != length) return false;
+
+  *this = next;
+  return true;
+}
+
+void RuleEngine::clear() {
+  *this = RuleEngine();
+}
+
+bool RuleEngine::onFrame(uint32_t id, const uint8_t* data, uint8_t dlc) {
+  bool changed = false;
+  for (uint8_t i = 0; i < signalCount; i++) {
+    const Signal& signal = signals[i];
+    if (signal.id != id || signal.byte >= dlc) continue;
+    uint8_t bit = 1 << i;
+    bool value = (data[signal.byte] & signal.mask) != 0;
+    if (value != ((signalBits & bit) != 0)) {
+      signalBits ^= bit;
+      changedSignals |= bit;
+      changed = true;
+    }
+  }
+  return changed;
+}
+
+bool RuleEngine::update(uint16_t channels, uint32_t nowMs) {
+  updates++;
+  uint16_t changedChannels = started ? channels ^ lastChannels : 0xFFFF;
+  uint8_t signalsChanged = started ? changedSignals : 0xFF;
+  lastChannels = channels;
+  changedSignals = 0;
+
+  uint8_t dueTimers = 0;
+  for (uint8_t t = 0; t < MAX_TIMERS; t++) {
+    uint8_t bit = 1 << t;
+    if ((timerRunning & bit) && !(timerExpired & bit) &&
+        nowMs - timerStartMs[t] >= timerMs[t]) {
+      dueTimers |= bit;
+    }
+  }
+
+  // Rules only read earlier rules, so one pass in order settles everything
+  uint8_t changedResults = 0;
+  for (uint8_t r = 0; r < ruleCount; r++) {
+    const Rule& rule = rules[r];
+    if (started && !(rule.channelDeps & changedChannels) &&
+        !(rule.signalDeps & signalsChanged) && !(rule.ruleDeps & changedResults) &&
+        !(rule.timerMask & dueTimers)) {
+      continue;
+    }
+    evaluations++;
+    uint8_t bit = 1 << r;
+    if (evaluate(rule, channels, nowMs) != ((resultBits & bit) != 0)) {
+      resultBits ^= bit;
+      changedResults |= bit;
+    }
+  }
+  started = true;
+  return changedResults != 0;
+}
+
+bool RuleEngine::evaluate(const Rule& rule, uint16_t channels, uint32_t nowMs) {
+  // Stack of booleans, top in bit 0
+  uint32_t stack = 0;
+  const uint8_t* op = &code[rule.offset];
+  uint8_t i = 0;
+  while (i < rule.length) {
+    switch (op[i]) {
+      case OP_CHANNEL:
+        stack = (stack << 1) | ((channels >> op[i + 1]) & 1);
+        i += 2;
+        break;
+      case OP_SIGNAL:
+        stack = (stack << 1) | ((signalBits >> op[i + 1]) & 1);
+        i += 2;
+        break;
+      case OP_RULE:
+        stack = (stack << 1) | ((resultBits >> op[i + 1]) & 1);
+        i += 2;
+        break;
+      case OP_ANY_OPEN:
+      case OP_ALL_OPEN: {
+        uint16_t mask = op[i + 1] | (op[i + 2] << 8);
+        bool value = op[i] == OP_ANY_OPEN ? (channels & mask) != 0 : (channels & mask) == mask;
+        stack = (stack << 1) | (value ? 1 : 0);
+        i += 3;
+        break;
+      }
+      case OP_NOT:
+        stack ^= 1;
+        i++;
+        break;
+      case OP_AND:
+      case OP_OR:
+      case OP_XOR: {
+        uint32_t a = stack & 1;
+        stack >>= 1;
+        uint32_t b = stack & 1;
+        stack &= ~1u;
+        stack |= op[i] == OP_AND ? (a & b) : op[i] == OP_OR ? (a | b) : (a ^ b);
+        i++;
+        break;
+      }
+      case OP_HELD: {
+        uint8_t t = op[i + 1];
+        uint8_t bit = 1 << t;
+        bool held = false;
+        if (stack & 1) {
+          if (!(timerRunning & bit)) {
+            timerRunning |= bit;
+            timerStartMs[t] = nowMs;
+          }
+          held = nowMs - timerStartMs[t] >= timerMs[t];
+        } else {
+          timerRunning &= ~bit;
+        }
+        if (held) {
+          timerExpired |= bit;
+        } else {
+          timerExpired &= ~bit;
+        }
+        stack = (stack & ~1u) | (held ? 1 : 0);
+        i += 4;
+        break;
+      }
+      default:
+        return false;  // Unreachable for a validated program
+    }
+  }
+  return (stack & 1) != 0;
+}
+
+uint32_t RuleEngine::msUntilDue(uint32_t nowMs) const {
+  uint32_t until = UINT32_MAX;
+  for (uint8_t t = 0; t < MAX_TIMERS; t++) {
+    uint8_t bit = 1 << t;
+    if (!(timerRunning & bit) || (timerExpired & bit)) continue;
+    uint32_t elapsed = nowMs - timerStartMs[t];
+    uint32_t remaining = elapsed >= timerMs[t] ? 0 : timerMs[t] - elapsed;
+    if (remaining < until) until = remaining;
+  }
+  return until;
+}
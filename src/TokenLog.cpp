@@ -0,0 +1,87 @@
+#include "TokenLog.h"
+#include <atomic>
+
+static const uint32_t RING_MASK = TokenLog::RING_WORDS - 1;
+static const uint32_t HEADER_MARK = 0x80000000;
+static const uint8_t RECORD_WORDS = 2;  // Token and timestamp
+
+// Free-running word counters; a record is published by writing its header
+// word last, so the drain task never reads a half-written record
+static uint32_t ring[TokenLog::RING_WORDS];
+static std::atomic<uint32_t> head(0);
+static std::atomic<uint32_t> tail(0);
+static std::atomic<uint32_t> droppedCount(0);
+
+void TokenLog::encodeString(uint32_t *words, uint8_t &count, const char *value) {
+  size_t length = value ? strnlen(value, MAX_STRING) : 0;
+  uint8_t needed = 1 + (length + 3) / 4;
+  if (count + needed > MAX_ARG_WORDS) return;
+  words[count] = length;
+  memset(&words[count + 1], 0, (needed - 1) * 4);
+  memcpy(&words[count + 1], value, length);
+  count += needed;
+}
+
+void TokenLog::commit(uint32_t token, const uint32_t *args, uint8_t count) {
+  uint32_t size = 1 + RECORD_WORDS + count;
+  uint32_t start = head.load(std::memory_order_relaxed);
+  do {
+    if (start + size - tail.load(std::memory_order_acquire) > RING_WORDS) {
+      droppedCount.fetch_add(1, std::memory_order_relaxed);
+      return;
+    }
+  } while (!head.compare_exchange_weak(start, start + size,
+                                       std::memory_order_acq_rel,
+                                       std::memory_order_relaxed));
+
+  ring[(start + 1) & RING_MASK] = token;
+  ring[(start + 2) & RING_MASK] = (uint32_t)esp_timer_get_time();
+  for (uint8_t i = 0; i < count; i++) {
+    ring[(start + 3 + i) & RING_MASK] = args[i];
+  }
+  __atomic_store_n(&ring[start & RING_MASK], HEADER_MARK | size, __ATOMIC_RELEASE);
+}
+
+uint32_t TokenLog::dropped() {
+  return droppedCount.load(std::memory_order_relaxed);
+}
+
+void TokenLog::drainTask(void *param) {
+  uint8_t record[2 + 1 + (1 + RECORD_WORDS + MAX_ARG_WORDS) * 4];
+  uint32_t reportedDrops = 0;
+
+  for (;;) {
+    uint32_t position = tail.load(std::memory_order_relaxed);
+    uint32_t header = __atomic_load_n(&ring[position & RING_MASK], __ATOMIC_ACQUIRE);
+    if (header == 0) {
+      uint32_t drops = dropped();
+      if (drops != reportedDrops) {
+        Serial.printf("[TLOG] %lu records dropped\n", drops - reportedDrops);
+        reportedDrops = drops;
+      }
+      vTaskDelay(pdMS_TO_TICKS(10));
+      continue;
+    }
+
+    uint32_t size = header & ~HEADER_MARK;
+    uint8_t words = size - 1;
+    record[0] = 0xFE;
+    record[1] = 'T';
+    record[2] = words;
+    for (uint8_t i = 0; i < words; i++) {
+      uint32_t word = ring[(position + 1 + i) & RING_MASK];
+      memcpy(&record[3 + i * 4], &word, 4);
+    }
+    // Zero the whole record so a later header landing here reads as empty
+    for (uint32_t i = 0; i < size; i++) {
+      ring[(position + i) & RING_MASK] = 0;
+    }
+    tail.store(position + size, std::memory_order_release);
+
+    Serial.write(record, 3 + words * 4);
+  }
+}
+
+void TokenLog::begin() {
+  xTaskCreate(drainTask, "tlog", 3072, nullptr, 1, nullptr);
+}
@@ -0,0 +1,60 @@
+#include "TxMailbox.h"
+
+bool TxMailbox::post(const CanFrame &frame) {
+  int8_t freeSlot = -1;
+  for (uint8_t i = 0; i < MAX_SLOTS; i++) {
+    if (slots[i].used && slots[i].frame.id == frame.id) {
+      if (slots[i].pending) replaced++;
+      slots[i].frame = frame;
+      slots[i].pending = true;
+      return true;
+    }
+    if (!slots[i].used && freeSlot < 0) freeSlot = i;
+  }
+  if (freeSlot < 0) return false;
+  slots[freeSlot].used = true;
+  slots[freeSlot].frame = frame;
+  slots[freeSlot].pending = true;
+  return true;
+}
+
+bool TxMailbox::next(uint32_t nowMs, CanFrame &frame) {
+  if (inFlight >= 0) {
+    if (nowMs - inFlightSinceMs < IN_FLIGHT_TIMEOUT_MS) return false;
+    timeouts++;
+    transmitted(false);
+  }
+
+  int8_t best = -1;
+  for (uint8_t i = 0; i < MAX_SLOTS; i++) {
+    if (slots[i].pending && (best < 0 || slots[i].frame.id < slots[best].frame.id)) {
+      best = i;
+    }
+  }
+  if (best < 0) return false;
+
+  slots[best].pending = false;
+  frame = slots[best].frame;
+  inFlight = best;
+  inFlightSinceMs = nowMs;
+  return true;
+}
+
+void TxMailbox::transmitted(bool ok) {
+  if (inFlight < 0) return;
+  // Not pending means nothing newer was posted, so the sent value is current
+  if (!ok) slots[inFlight].pending = true;
+  inFlight = -1;
+}
+
+bool TxMailbox::overdue(uint32_t nowMs) const {
+  return inFlight >= 0 && nowMs - inFlightSinceMs >= IN_FLIGHT_TIMEOUT_MS;
+}
+
+bool TxMailbox::busy() const {
+  if (inFlight >= 0) return true;
+  for (uint8_t i = 0; i < MAX_SLOTS; i++) {
+    if (slots[i].pending) return true;
+  }
+  return false;
+}
@@ -0,0 +1,146 @@
+#include "WiringDiagnostics.h"
+#include <debug.h>
+#include <esp_adc/adc_cali.h>
+#include <esp_adc/adc_cali_scheme.h>
+#include <esp_adc/adc_continuous.h>
+
+// Slowest conversion rate the C6 digital controller supports
+static const uint32_t SAMPLE_FREQ_HZ = SOC_ADC_SAMPLE_FREQ_THRES_LOW;
+static const uint8_t SAMPLES_PER_CHANNEL = 16;
+static const uint8_t MAX_ADC_CHANNELS = 7;
+static const uint32_t FRAME_BYTES =
+    MAX_ADC_CHANNELS * SAMPLES_PER_CHANNEL * SOC_ADC_DIGI_RESULT_BYTES;
+
+static adc_continuous_handle_t adcHandle = nullptr;
+static adc_cali_handle_t caliHandle = nullptr;
+static WiringThresholds limits;
+static uint16_t monitored = 0;
+static int8_t channelIndex[SOC_ADC_CHANNEL_NUM(0)];  // ADC channel -> pins index
+static volatile bool burstDone = false;
+static bool burstRunning = false;
+static uint8_t frameBuffer[FRAME_BYTES];
+
+static bool IRAM_ATTR onConversionDone(adc_continuous_handle_t handle,
+                                       const adc_continuous_evt_data_t* edata,
+                                       void* user_data) {
+  burstDone = true;
+  return false;
+}
+
+static WiringStatus classify(uint32_t mv) {
+  if (mv < limits.shortMaxMv) return WIRING_SHORT;
+  if (mv < limits.closedMaxMv) return WIRING_CLOSED;
+  if (mv < limits.openMaxMv) return WIRING_OPEN;
+  return WIRING_OPEN_CIRCUIT;
+}
+
+uint16_t WiringDiagnostics::begin(const gpio_num_t* pins, uint8_t count,
+                                  const WiringThresholds& thresholds) {
+  limits = thresholds;
+  memset(channelIndex, -1, sizeof(channelIndex));
+
+  adc_digi_pattern_config_t pattern[MAX_ADC_CHANNELS] = {};
+  uint8_t patternCount = 0;
+
+  for (uint8_t i = 0; i < count && patternCount < MAX_ADC_CHANNELS; i++) {
+    adc_unit_t unit;
+    adc_channel_t channel;
+    if (adc_continuous_io_to_channel(pins[i], &unit, &channel) != ESP_OK ||
+        unit != ADC_UNIT_1) {
+      continue;
+    }
+    pattern[patternCount].atten = ADC_ATTEN_DB_12;
+    pattern[patternCount].channel = channel;
+    pattern[patternCount].unit = ADC_UNIT_1;
+    pattern[patternCount].bit_width = SOC_ADC_DIGI_MAX_BITWIDTH;
+    patternCount++;
+    channelIndex[channel] = i;
+    monitored |= (1 << i);
+  }
+  if (patternCount == 0) return 0;
+
+  adc_continuous_handle_cfg_t handleConfig = {};
+  handleConfig.max_store_buf_size = FRAME_BYTES;
+  handleConfig.conv_frame_size = patternCount * SAMPLES_PER_CHANNEL * SOC_ADC_DIGI_RESULT_BYTES;
+  if (adc_continuous_new_handle(&handleConfig, &adcHandle) != ESP_OK) {
+    debugln("[DIAG] ERROR: ADC continuous mode unavailable");
+    monitored = 0;
+    return 0;
+  }
+
+  adc_continuous_config_t digiConfig = {};
+  digiConfig.pattern_num = patternCount;
+  digiConfig.adc_pattern = pattern;
+  digiConfig.sample_freq_hz = SAMPLE_FREQ_HZ;
+  digiConfig.conv_mode = ADC_CONV_SINGLE_UNIT_1;
+  digiConfig.format = ADC_DIGI_OUTPUT_FORMAT_TYPE2;
+  adc_continuous_config(adcHandle, &digiConfig);
+
+  adc_continuous_evt_cbs_t callbacks = {};
+  callbacks.on_conv_done = onConversionDone;
+  adc_continuous_register_event_callbacks(adcHandle, &callbacks, nullptr);
+
+  adc_cali_curve_fitting_config_t caliConfig = {};
+  caliConfig.unit_id = ADC_UNIT_1;
+  caliConfig.atten = ADC_ATTEN_DB_12;
+  caliConfig.bitwidth = ADC_BITWIDTH_DEFAULT;
+  if (adc_cali_create_scheme_curve_fitting(&caliConfig, &caliHandle) != ESP_OK) {
+    caliHandle = nullptr;
+  }
+
+  // Configuring the ADC switches the pads to analog; the EOL scheme and the
+  // digital reed reading still need the input buffer and pull-up
+  for (uint8_t i = 0; i < count; i++) {
+    if (monitored & (1 << i)) {
+      gpio_input_enable(pins[i]);
+      gpio_pullup_en(pins[i]);
+    }
+  }
+
+  return monitored;
+}
+
+void WiringDiagnostics::setThresholds(const WiringThresholds& thresholds) {
+  limits = thresholds;
+}
+
+void WiringDiagnostics::startBurst() {
+  if (!adcHandle || burstRunning) return;
+  burstDone = false;
+  burstRunning = adc_continuous_start(adcHandle) == ESP_OK;
+}
+
+bool WiringDiagnostics::poll(WiringStatus* status) {
+  if (!burstRunning || !burstDone) return false;
+
+  uint32_t length = 0;
+  esp_err_t err = adc_continuous_read(adcHandle, frameBuffer, sizeof(frameBuffer), &length, 0);
+  adc_continuous_stop(adcHandle);
+  burstRunning = false;
+  if (err != ESP_OK) return false;
+
+  uint32_t sum[SOC_ADC_CHANNEL_NUM(0)] = {};
+  uint16_t samples[SOC_ADC_CHANNEL_NUM(0)] = {};
+  for (uint32_t i = 0; i + SOC_ADC_DIGI_RESULT_BYTES <= length; i += SOC_ADC_DIGI_RESULT_BYTES) {
+    const adc_digi_output_data_t* result = (const adc_digi_output_data_t*)&frameBuffer[i];
+    uint8_t channel = result->type2.channel;
+    if (channel >= SOC_ADC_CHANNEL_NUM(0) || channelIndex[channel] < 0) continue;
+    sum[channel] += result->type2.data;
+    samples[channel]++;
+  }
+
+  for (uint8_t channel = 0; channel < SOC_ADC_CHANNEL_NUM(0); channel++) {
+    if (channelIndex[channel] < 0 || samples[channel] == 0) continue;
+    int raw = sum[channel] / samples[channel];
+    int mv = 0;
+    if (!caliHandle || adc_cali_raw_to_voltage(caliHandle, raw, &mv) != ESP_OK) {
+      mv = raw * 3300 / ((1 << SOC_ADC_DIGI_MAX_BITWIDTH) - 1);
+    }
+    status[channelIndex[channel]] = classify(mv);
+  }
+  return true;
+}
+
+uint16_t WiringDiagnostics::monitoredMask() {
+  return monitored;
+}
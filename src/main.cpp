@@ -1,10 +1,55 @@
 #include <Arduino.h>
 #include <debug.h>
+#include "BusCapture.h"
+#include "BusClock.h"
+#include "BusLoadMonitor.h"
+#include "CanIdPlan.h"
+#include "CanOta.h"
+#include "CanTx.h"
+#include "ConfigUpdate.h"
+#include "ControlAuth.h"
+#include "Discovery.h"
+#include "DoorPipeline.h"
+#include "DoorReporter.h"
+#include "EventHistory.h"
+#include "FlashStall.h"
+#include "HealthLed.h"
 #include "OtaUpdate.h"
 #include "RgbLed.h"
+#include "TokenLog.h"
 #include "TwaiTaskBased.h"
+#include "TxMailbox.h"
 #include <Preferences.h>
 #include <driver/gpio.h>
+#include "EdgeCapture.h"
+#include "GlitchFilters.h"
+#include "LpCoreSampler.h"
+#include "ModuleConfig.h"
+#include "ReedDebouncer.h"
+#include "RuleEngine.h"
+#include "WiringDiagnostics.h"
+
+#ifndef CAN_AUTH_KEY
+#define CAN_AUTH_KEY ""
+#endif
+#ifndef CAN_AUTH_DISABLED
+#define CAN_AUTH_DISABLED 0
+#endif
+
+// An unset TRAILCURRENT_CAN_AUTH_KEY expands to an empty key, which would
+// quietly accept every control frame. Building without a key takes an
+// explicit -DCAN_AUTH_DISABLED=1.
+#if CAN_AUTH_DISABLED
+#warning "CAN_AUTH_DISABLED: control frames are not authenticated"
+#else
+static_assert(sizeof(CAN_AUTH_KEY) == 65,
+              "CAN_AUTH_KEY must be 64 hex characters - set TRAILCURRENT_CAN_AUTH_KEY, "
+              "or build with -DCAN_AUTH_DISABLED=1 to accept unauthenticated control frames");
+#endif
+
+#if RSW_WIRING_DIAG && RSW_LP_CORE
+#error "RSW_WIRING_DIAG needs GPIO0-GPIO6 on the HP core - not available with RSW_LP_CORE"
+#endif
 
 // =============================================================================
 // Pin Definitions (from schematic global labels)
@@ -26,6 +71,16 @@ static const gpio_num_t RSW_PINS[] = {
 };
 static const uint8_t NUM_RSW = sizeof(RSW_PINS) / sizeof(RSW_PINS[0]);
 
+#if RSW_LP_CORE
+// LP core sampling: RSW03-RSW10 (GPIO0-GPIO7) are LP IOs sampled by the LP
+// core, RSW01-RSW02 (GPIO16-GPIO17) remain on the HP core.
+static const uint8_t LP_RSW_FIRST = 2;
+static const uint8_t LP_RSW_COUNT = NUM_RSW - LP_RSW_FIRST;
+static const uint8_t NUM_HP_RSW = LP_RSW_FIRST;
+#else
+static const uint8_t NUM_HP_RSW = NUM_RSW;
+#endif
+
 // DIP switch address pins (active LOW - switches pull to GND when ON)
 static const gpio_num_t ADDR_PINS[] = {
   GPIO_NUM_18,  // ADDR01 (bit 0 - LSB)
@@ -40,22 +95,84 @@ static const gpio_num_t CAN_RX_PIN = GPIO_NUM_15;
 
 // RGB LED (built-in WS2812 on GPIO8)
 static const uint8_t RGB_LED_PIN = 8;
+static const uint8_t RGB_LED_BRIGHTNESS_PERCENT = 1;
 
 // =============================================================================
 // CAN Bus Configuration
 // =============================================================================
 
-// CAN IDs 0x0A-0x11 reserved for up to 8 Cabinet/Door Sensor modules.
-// Higher priority (lower ID) than DeviceStatusReport (0x1B).
-// DIP switches select offset: CAN_ID = CAN_BASE_ID + dip_value (0-7)
-static const uint32_t CAN_BASE_ID = 0x0A;
-static const uint32_t CAN_BAUDRATE = 500000;
+// All IDs come from the table in CanIdPlan.h. Per-module IDs are the block
+// base + dip_value (0-7).
+
+// Door status: change events 0x0A-0x11, higher priority (lower ID) than
+// DeviceStatusReport (0x1B); routine heartbeats 0x2A-0x31
+static const uint32_t CAN_EVENT_BASE_ID = CanIdPlan::id(CanIdPlan::DOOR_EVENT);
+static const uint32_t CAN_HEARTBEAT_BASE_ID = CanIdPlan::id(CanIdPlan::DOOR_HEARTBEAT);
+
+// Derived-signal rule results: sent on change, repeated while rules are loaded
+static const uint32_t CAN_DERIVED_BASE_ID = CanIdPlan::id(CanIdPlan::DERIVED_SIGNAL);
+static const unsigned long DERIVED_REPEAT_MS = 1000;
 
-// Transmit interval (200ms = 5 Hz)
-static const unsigned long TX_INTERVAL_MS = 200;
+// Authenticates the preceding control frames on the ID it names
+static const uint32_t CAN_AUTH_ID = CanIdPlan::id(CanIdPlan::AUTH);
 
-// Debounce time for reed switch readings
-static const unsigned long DEBOUNCE_MS = 50;
+// Bus time: master SYNC [seq] and FOLLOW_UP [seq, master_us 7 bytes LE].
+// High priority so arbitration delay between master and modules stays small
+static const uint32_t CAN_TIME_SYNC_ID = CanIdPlan::id(CanIdPlan::TIME_SYNC);
+static const uint32_t CAN_TIME_FOLLOW_UP_ID = CanIdPlan::id(CanIdPlan::TIME_FOLLOW_UP);
+
+// Firmware update over CAN: one command ID shared by all modules (target mask
+// in byte 0), one data ID, and a status reply ID per module
+static const uint32_t CAN_OTA_CMD_ID = CanIdPlan::id(CanIdPlan::OTA_COMMAND);
+static const uint32_t CAN_OTA_DATA_ID = CanIdPlan::id(CanIdPlan::OTA_DATA);
+static const uint32_t CAN_OTA_STATUS_BASE_ID = CanIdPlan::id(CanIdPlan::OTA_STATUS);
+
+// Bulk configuration: command and data IDs shared by all modules (target mask
+// in command byte 0), and a status reply ID per module
+static const uint32_t CAN_CONFIG_CMD_ID = CanIdPlan::id(CanIdPlan::CONFIG_COMMAND);
+static const uint32_t CAN_CONFIG_DATA_ID = CanIdPlan::id(CanIdPlan::CONFIG_DATA);
+static const uint32_t CAN_CONFIG_STATUS_BASE_ID = CanIdPlan::id(CanIdPlan::CONFIG_STATUS);
+
+// Bus capture (sniffer): command ID shared by all modules (target mask in
+// byte 0), status and download replies on a per-module ID
+static const uint32_t CAN_CAPTURE_CMD_ID = CanIdPlan::id(CanIdPlan::CAPTURE_COMMAND);
+static const uint32_t CAN_CAPTURE_REPLY_BASE_ID = CanIdPlan::id(CanIdPlan::CAPTURE_REPLY);
+
+// Door event history: command ID shared by all modules (target mask in
+// byte 0), status and block downloads on a per-module ID
+static const uint32_t CAN_HISTORY_CMD_ID = CanIdPlan::id(CanIdPlan::HISTORY_COMMAND);
+static const uint32_t CAN_HISTORY_REPLY_BASE_ID = CanIdPlan::id(CanIdPlan::HISTORY_REPLY);
+
+// Capture sector erases (tens of ms with the flash cache off) only start
+// when no door frame is due for at least this long
+static const uint32_t CAPTURE_ERASE_GUARD_MS = 50;
+
+// Discovery: broadcast request, replies on a per-module ID in DIP time slots
+static const uint32_t CAN_DISCOVER_ID = CanIdPlan::id(CanIdPlan::DISCOVER);
+static const uint32_t CAN_DISCOVERY_REPLY_BASE_ID = CanIdPlan::id(CanIdPlan::DISCOVERY_REPLY);
+
+#if RSW_WIRING_DIAG
+// Wiring diagnostic frames: CAN_ID = CAN_DIAG_BASE_ID + dip_value (0-7), 1 Hz
+static const uint32_t CAN_DIAG_BASE_ID = CanIdPlan::id(CanIdPlan::WIRING_DIAG);
+static const unsigned long DIAG_INTERVAL_MS = 1000;
+#endif
+
+// Status LED: health re-evaluated this often. TX is failing after this many
+// unacknowledged frames in a row; a channel chatters with this many confirmed
+// changes in one window; a committed configuration is flashed this long.
+static const unsigned long HEALTH_INTERVAL_MS = 250;
+static const uint8_t TX_FAIL_STREAK = 3;
+static const unsigned long CHATTER_WINDOW_MS = 10000;
+static const uint8_t CHATTER_CHANGES = 20;
+static const unsigned long CONFIG_FLASH_MS = 1000;
+
+#if RSW_LP_CORE
+// LP core sample period (debounce = debounceMs / LP_SAMPLE_PERIOD_MS samples)
+static const uint32_t LP_SAMPLE_PERIOD_MS = 10;
+
+// Max time the HP core stays awake waiting for a CAN frame to leave the bus
+static const unsigned long LP_TX_DRAIN_TIMEOUT_MS = 5;
+#endif
 
 // =============================================================================
 // Global State
@@ -64,13 +181,72 @@ static const unsigned long DEBOUNCE_MS = 50;
 RgbLed statusLed(RGB_LED_PIN);
 OtaUpdate otaUpdate(statusLed, 180000, "", "");
 
-uint32_t canMessageId = CAN_BASE_ID;
-unsigned long lastTxTime = 0;
+uint32_t canEventId = CAN_EVENT_BASE_ID;
+uint32_t canHeartbeatId = CAN_HEARTBEAT_BASE_ID;
+DoorReporter doorReporter;
 
-// Debounced reed switch state
-uint16_t debouncedState = 0;
+// Derived-signal rules over door channels and received frames
+uint32_t canDerivedId = CAN_DERIVED_BASE_ID;
+RuleEngine ruleEngine;
+portMUX_TYPE ruleEngineMux = portMUX_INITIALIZER_UNLOCKED;
+unsigned long lastDerivedTxMs = 0;
+
+#if RSW_WIRING_DIAG
+uint32_t canDiagMessageId = CAN_DIAG_BASE_ID;
+unsigned long lastDiagTime = 0;
+WiringStatus wiringStatus[NUM_RSW];
+#endif
+
+// Per-channel reed switch configuration (index matches RSW_PINS), filled
+// from the module configuration by loadModuleConfig()
+ReedChannelConfig rswConfig[NUM_RSW];
+static_assert(NUM_RSW <= ModuleConfig::CHANNELS, "enabled mask does not cover every reed switch");
+
+// Active runtime configuration; heartbeatSteps[0] is the unloaded interval
+ModuleConfig moduleConfig = DEFAULT_CONFIG;
+HeartbeatStep heartbeatSteps[ModuleConfigCodec::HEARTBEAT_STEPS];
+
+// Debounced reed switch state and the door status path built on it (the
+// pipeline also keeps the sample and newest contact edge times for the age
+// fields of status frames)
+ReedDebouncer reedDebouncer;
+DoorPipeline doorPipeline(reedDebouncer, doorReporter);
+
+// Local clock disciplined to the bus time master
+BusClock busClock;
+portMUX_TYPE busClockMux = portMUX_INITIALIZER_UNLOCKED;
+
+// Time of the last confirmed change per channel (bus microseconds)
+int64_t rswChangeUs[NUM_RSW] = {};
+
+#if RSW_EDGE_CAPTURE
+// HP pin levels at the previous sample, to tell which channels the shared
+// ETM capture could belong to
 uint16_t lastRawState = 0;
-unsigned long lastChangeTime = 0;
+#endif
+
+// Bus utilisation from frames seen by the TWAI controller
+BusLoadMonitor busLoad;
+portMUX_TYPE busLoadMux = portMUX_INITIALIZER_UNLOCKED;
+
+// Published by the loop for the capture writer: no door change is being
+// debounced or sent and no door frame is due soon
+volatile bool reportingIdle = false;
+
+// Latest-value transmit path for state frames (door status, diagnostics)
+TxMailbox txMailbox;
+portMUX_TYPE txMailboxMux = portMUX_INITIALIZER_UNLOCKED;
+volatile uint32_t txMailboxSequence = 0;  // CanTx number of the in-flight frame
+
+// Health inputs for the status LED
+volatile uint8_t txFailStreak = 0;
+uint8_t chatterChanges[NUM_RSW] = {};
+uint16_t chatterMask = 0;
+unsigned long chatterWindowStart = 0;
+unsigned long configAppliedMs = 0;
+bool configFlash = false;
+unsigned long lastHealthTime = 0;
+
 
 // WiFi credential reception state (CAN ID 0x01 protocol)
 bool wifiConfigInProgress = false;
@@ -86,12 +262,14 @@ uint8_t wifiPasswordReceived = 0;
 // =============================================================================
 
 void saveWifiCredentials(const char* ssid, const char* password) {
+  FlashStall::beginWrite();
   Preferences prefs;
   prefs.begin("wifi", false);
   prefs.putString("ssid", ssid);
   prefs.putString("password", password);
   prefs.end();
-  debugf("[WiFi] Credentials saved to NVS (SSID: %s)\n", ssid);
+  FlashStall::endWrite();
+  tlogf("[WiFi] Credentials saved to NVS (SSID: %s)", ssid);
 }
 
 void handleWifiConfigMessage(const twai_message_t &msg) {
@@ -106,7 +284,7 @@ void handleWifiConfigMessage(const twai_message_t &msg) {
       memset(wifiSsidBuffer, 0, sizeof(wifiSsidBuffer));
       memset(wifiPasswordBuffer, 0, sizeof(wifiPasswordBuffer));
       wifiConfigInProgress = true;
-      debugf("[WiFi] Config start: SSID len=%d, Password len=%d\n",
+      tlogf("[WiFi] Config start: SSID len=%d, Password len=%d",
              wifiSsidLen, wifiPasswordLen);
       break;
     }
@@ -148,7 +326,7 @@ void handleWifiConfigMessage(const twai_message_t &msg) {
         saveWifiCredentials((const char*)wifiSsidBuffer,
                             (const char*)wifiPasswordBuffer);
       } else {
-        debugf("[WiFi] Config failed: checksum %s, SSID %d/%d, Password %d/%d\n",
+        tlogf("[WiFi] Config failed: checksum %s, SSID %d/%d, Password %d/%d",
                (checksum == msg.data[1]) ? "OK" : "MISMATCH",
                wifiSsidReceived, wifiSsidLen,
                wifiPasswordReceived, wifiPasswordLen);
@@ -162,8 +340,8 @@ void handleWifiConfigMessage(const twai_message_t &msg) {
 // CAN Bus Callbacks
 // =============================================================================
 
-void onCanRx(const twai_message_t &msg) {
-  if (msg.identifier == 0x00) {
+void dispatchCanMessage(const twai_message_t &msg) {
+  if (msg.identifier == CanIdPlan::id(CanIdPlan::OTA_TRIGGER)) {
     // OTA update notification - check if it's for this device
     char updateForHostName[14];
     String currentHostName = otaUpdate.getHostName();
@@ -171,7 +349,7 @@ void onCanRx(const twai_message_t &msg) {
             msg.data[0], msg.data[1], msg.data[2]);
 
     if (currentHostName.equals(updateForHostName)) {
-      debugln("[OTA] Hostname matched - reading WiFi credentials from NVS");
+      tlogf("[OTA] Hostname matched - reading WiFi credentials from NVS");
 
       Preferences prefs;
       prefs.begin("wifi", true);
@@ -180,21 +358,132 @@ void onCanRx(const twai_message_t &msg) {
       prefs.end();
 
       if (ssid.length() > 0 && password.length() > 0) {
-        debugf("[OTA] Using stored WiFi credentials (SSID: %s)\n", ssid.c_str());
+        tlogf("[OTA] Using stored WiFi credentials (SSID: %s)", ssid.c_str());
+        // OtaUpdate drives the LED itself while it waits
+        HealthLed::suspend();
         OtaUpdate ota(statusLed, 180000, ssid.c_str(), password.c_str());
         ota.waitForOta();
-        debugln("[OTA] OTA mode exited - resuming normal operation");
+        HealthLed::resume();
+        tlogf("[OTA] OTA mode exited - resuming normal operation");
       } else {
-        debugln("[OTA] ERROR: No WiFi credentials in NVS - cannot start OTA");
+        tlogf("[OTA] ERROR: No WiFi credentials in NVS - cannot start OTA");
       }
     }
-  } else if (msg.identifier == 0x01) {
+  } else if (msg.identifier == CanIdPlan::id(CanIdPlan::WIFI_CONFIG)) {
     handleWifiConfigMessage(msg);
+  } else if (msg.identifier == CAN_OTA_DATA_ID) {
+    CanOta::handleData(msg);
+  } else if (msg.identifier == CAN_OTA_CMD_ID) {
+    CanOta::handleCommand(msg);
+  } else if (msg.identifier == CAN_CONFIG_DATA_ID) {
+    ConfigUpdate::handleData(msg);
+  } else if (msg.identifier == CAN_CONFIG_CMD_ID) {
+    ConfigUpdate::handleCommand(msg);
+  } else if (msg.identifier == CAN_CAPTURE_CMD_ID) {
+    BusCapture::handleCommand(msg);
+  } else if (msg.identifier == CAN_HISTORY_CMD_ID) {
+    EventHistory::handleCommand(msg);
+  }
+}
+
+// Frames that change module state must be authenticated when a key is set.
+// CAN update BLOCK/QUERY/ABORT and data frames stay on the fast path - the
+// authenticated HASH and END commands already bind the image contents. The
+// configuration HASH segments and COMMIT likewise carry and apply the blob's
+// full SHA-256, so its data frames need no authentication either.
+bool requiresAuth(const twai_message_t &msg) {
+  if (msg.identifier == CanIdPlan::id(CanIdPlan::OTA_TRIGGER) ||
+      msg.identifier == CanIdPlan::id(CanIdPlan::WIFI_CONFIG)) {
+    return true;
+  }
+  if (msg.identifier == CAN_OTA_CMD_ID && msg.data_length_code >= 2) {
+    uint8_t command = msg.data[1];
+    return command == CanOta::CMD_BEGIN || command == CanOta::CMD_BASE ||
+           command == CanOta::CMD_HASH || command == CanOta::CMD_END;
+  }
+  if (msg.identifier == CAN_CONFIG_CMD_ID && msg.data_length_code >= 2) {
+    return msg.data[1] == ConfigUpdate::CMD_HASH || msg.data[1] == ConfigUpdate::CMD_COMMIT;
+  }
+  // Capture overwrites the oldest sectors of the ring and costs flash wear
+  if (msg.identifier == CAN_CAPTURE_CMD_ID && msg.data_length_code >= 2) {
+    return msg.data[1] == BusCapture::CMD_START;
+  }
+  return false;
+}
+
+void handleTimeSync(const twai_message_t &msg, int64_t rxUs) {
+  if (msg.data_length_code < 1) return;
+  if (msg.identifier == CAN_TIME_SYNC_ID) {
+    taskENTER_CRITICAL(&busClockMux);
+    busClock.onSync(msg.data[0], rxUs);
+    taskEXIT_CRITICAL(&busClockMux);
+    return;
+  }
+  if (msg.data_length_code < 8) return;
+  int64_t masterUs = 0;
+  for (uint8_t i = 7; i >= 1; i--) {
+    masterUs = (masterUs << 8) | msg.data[i];
+  }
+  taskENTER_CRITICAL(&busClockMux);
+  bool applied = busClock.onFollowUp(msg.data[0], masterUs);
+  int64_t errorUs = busClock.lastErrorUs();
+  int32_t driftPpb = busClock.driftPpb();
+  taskEXIT_CRITICAL(&busClockMux);
+  if (applied) {
+    tlogf("[TIME] Sync %u: error %lld us, drift %ld ppb",
+           msg.data[0], errorUs, (long)driftPpb);
+  }
+}
+
+int64_t toBusTime(int64_t localUs) {
+  taskENTER_CRITICAL(&busClockMux);
+  int64_t busUs = busClock.toBusUs(localUs);
+  taskEXIT_CRITICAL(&busClockMux);
+  return busUs;
+}
+
+void onCanRx(const twai_message_t &msg) {
+  // Timestamp before anything else so SYNC reception jitter stays small
+  int64_t rxUs = esp_timer_get_time();
+  taskENTER_CRITICAL(&busLoadMux);
+  busLoad.addFrame(msg.data_length_code, msg.extd);
+  taskEXIT_CRITICAL(&busLoadMux);
+  BusCapture::record(msg, rxUs);
+
+  // Rule signals may come from any node, control frames included
+  if (!msg.extd) {
+    taskENTER_CRITICAL(&ruleEngineMux);
+    ruleEngine.onFrame(msg.identifier, msg.data, msg.data_length_code);
+    taskEXIT_CRITICAL(&ruleEngineMux);
+  }
+
+  if (msg.identifier == CAN_TIME_SYNC_ID || msg.identifier == CAN_TIME_FOLLOW_UP_ID) {
+    handleTimeSync(msg, rxUs);
+  } else if (msg.identifier == CAN_DISCOVER_ID) {
+    Discovery::handleRequest(msg);
+  } else if (msg.identifier == CAN_AUTH_ID) {
+    ControlAuth::verify(msg, dispatchCanMessage);
+  } else if (ControlAuth::enabled() && requiresAuth(msg)) {
+    ControlAuth::hold(msg);
+  } else {
+    dispatchCanMessage(msg);
   }
 }
 
 void onCanTx(bool ok) {
-  debug_if(!ok, "[CAN] TX FAIL");
+  // Also fires for CAN update, discovery, configuration, capture and
+  // history replies, which bypass the mailbox - only its own frame frees
+  // the in-flight slot
+  uint32_t sequence = CanTx::completed();
+  taskENTER_CRITICAL(&txMailboxMux);
+  if (sequence == txMailboxSequence) txMailbox.transmitted(ok);
+  taskEXIT_CRITICAL(&txMailboxMux);
+  if (ok) {
+    txFailStreak = 0;
+  } else {
+    if (txFailStreak < 0xFF) txFailStreak++;
+    tlogf("[CAN] TX FAIL");
+  }
 }
 
 // =============================================================================
@@ -203,7 +492,7 @@ void onCanTx(bool ok) {
 
 uint16_t readReedSwitches() {
   uint16_t state = 0;
-  for (uint8_t i = 0; i < NUM_RSW; i++) {
+  for (uint8_t i = 0; i < NUM_HP_RSW; i++) {
     // HIGH = door open (pull-up, NO reed switch open)
     // LOW = door closed (reed switch closed by magnet)
     if (digitalRead(RSW_PINS[i]) == HIGH) {
@@ -213,19 +502,71 @@ uint16_t readReedSwitches() {
   return state;
 }
 
-uint16_t readDebouncedSwitches() {
-  uint16_t rawState = readReedSwitches();
+// DoorPipeline::EdgeReader: -1 falls back to the debouncer's edge time
+int64_t hardwareEdgeUs(uint8_t channel, void *) {
+#if RSW_EDGE_CAPTURE
+  // The capture credited to this channel, or -1 when another channel moved
+  // at the same time and the shared capture register cannot say whose edge
+  // it holds
+  int64_t capturedUs = EdgeCapture::lastEdgeUs(channel);
+  if (capturedUs >= 0) return capturedUs;
+#endif
+  // Latched by the IRAM edge interrupt, so exact even when a flash write
+  // held up sampling
+  return FlashStall::lastEdgeUs(channel);
+}
 
-  if (rawState != lastRawState) {
-    lastRawState = rawState;
-    lastChangeTime = millis();
+void stampDoorChanges(uint16_t changed) {
+  uint16_t doorState = doorPipeline.state();
+  for (uint8_t i = 0; i < NUM_RSW; i++) {
+    if (changed & (1 << i)) {
+      rswChangeUs[i] = toBusTime(doorPipeline.changeUs(i));
+      EventHistory::record(i, doorState & (1 << i), rswChangeUs[i] / 1000);
+      if (chatterChanges[i] < 0xFF) chatterChanges[i]++;
+      tlogf("[RSW] RSW%02d %s at %lld us", i + 1,
+             (doorState & (1 << i)) ? "open" : "closed", rswChangeUs[i]);
+    }
   }
+}
 
-  if ((millis() - lastChangeTime) >= DEBOUNCE_MS) {
-    debouncedState = rawState;
+#if RSW_EDGE_CAPTURE
+// Covered channels whose level changed or whose edge interrupt fired since
+// the previous sample
+uint16_t movedChannels(uint16_t raw, int64_t previousSampleUs) {
+  uint16_t moved = raw ^ lastRawState;
+  for (uint8_t i = 0; i < NUM_HP_RSW; i++) {
+    if (FlashStall::lastEdgeUs(i) > previousSampleUs) moved |= (1 << i);
   }
+  lastRawState = raw;
+  return moved & EdgeCapture::coveredMask();
+}
+#endif
+
+uint16_t readDebouncedSwitches() {
+#if RSW_EDGE_CAPTURE
+  int64_t previousSampleUs = doorPipeline.sampleUs();
+  int64_t capturedUs = EdgeCapture::capturedUs();
+#endif
+  int64_t sampleUs = esp_timer_get_time();
+#if !RSW_LP_CORE
+  // Light sleep between samples would read as a gap
+  FlashStall::sample(sampleUs);
+#endif
+  uint16_t raw = readReedSwitches();
+#if RSW_EDGE_CAPTURE
+  EdgeCapture::attribute(capturedUs, movedChannels(raw, previousSampleUs));
+#endif
 
-  return debouncedState;
+  uint16_t otherState = 0;
+#if RSW_LP_CORE
+  // LP channels arrive already debounced by the LP core
+  otherState = LpCoreSampler::state() << LP_RSW_FIRST;
+#endif
+
+  uint16_t changed = doorPipeline.sample(raw, otherState, sampleUs, millis(),
+                                         hardwareEdgeUs, nullptr);
+  if (changed) stampDoorChanges(changed);
+  return doorPipeline.state();
 }
 
 // =============================================================================
@@ -248,18 +589,290 @@ uint8_t readDipAddress() {
 // CAN Message Transmission
 // =============================================================================
 
-void sendDoorStatus(uint16_t doorState) {
+void postFrame(const CanFrame &frame) {
+  taskENTER_CRITICAL(&txMailboxMux);
+  txMailbox.post(frame);
+  taskEXIT_CRITICAL(&txMailboxMux);
+}
+
+void postFrame(const twai_message_t &msg, int64_t sampledUs) {
+  CanFrame frame;
+  frame.id = msg.identifier;
+  frame.dlc = msg.data_length_code;
+  memcpy(frame.data, msg.data, sizeof(frame.data));
+  frame.sampleUs = (uint32_t)sampledUs;
+  postFrame(frame);
+}
+
+// Hand the next pending frame to the driver once the previous one completed
+void serviceTxMailbox() {
+  uint32_t nowMs = millis();
+  taskENTER_CRITICAL(&txMailboxMux);
+  bool overdue = txMailbox.overdue(nowMs);
+  taskEXIT_CRITICAL(&txMailboxMux);
+  // A frame past the in-flight timeout is only given up once the controller
+  // is error-active with nothing left queued. Before that it may still be
+  // waiting in the driver, and a replacement would queue behind it.
+  if (overdue && !CanTx::resync()) return;
+
+  CanFrame frame;
+  taskENTER_CRITICAL(&txMailboxMux);
+  bool ready = txMailbox.next(nowMs, frame);
+  taskEXIT_CRITICAL(&txMailboxMux);
+  if (!ready) return;
+
+  // Door frames: sample-to-queue delay and queue time, known only now
+  int64_t queueUs = esp_timer_get_time();
+  doorPipeline.queued(frame, queueUs, toBusTime(queueUs));
+
+  twai_message_t msg = {};
+  msg.identifier = frame.id;
+  msg.data_length_code = frame.dlc;
+  memcpy(msg.data, frame.data, sizeof(frame.data));
+  CanTx::send(msg, &txMailboxSequence);
+
+  taskENTER_CRITICAL(&busLoadMux);
+  busLoad.addFrame(frame.dlc);
+  taskEXIT_CRITICAL(&busLoadMux);
+}
+
+bool txMailboxBusy() {
+  taskENTER_CRITICAL(&txMailboxMux);
+  bool busy = txMailbox.busy();
+  taskEXIT_CRITICAL(&txMailboxMux);
+  return busy;
+}
+
+// Event on change, heartbeat when quiet; returns true if a frame was posted
+bool sendDueDoorStatus(unsigned long now) {
+  static uint32_t savedReported = 0;
+  CanFrame frames[2];
+  uint8_t due = doorPipeline.report(now, frames);
+  if (due & DoorReporter::SEND_EVENT) postFrame(frames[0]);
+  if (due & DoorReporter::SEND_HEARTBEAT) postFrame(frames[1]);
+
+  // Saved frames are only final once the window's event has been sent
+  if ((due & DoorReporter::SEND_EVENT) && doorReporter.savedCount() != savedReported) {
+    savedReported = doorReporter.savedCount();
+    tlogf("[CAN] Coalesced changes: %lu transitions, %lu event frames, %lu saved",
+          doorReporter.transitionCount(), doorReporter.eventCount(),
+          doorReporter.savedCount());
+  }
+  return due != 0;
+}
+
+// Re-evaluate the heartbeat interval once per bus load window
+void serviceBusLoad(unsigned long now) {
+  taskENTER_CRITICAL(&busLoadMux);
+  bool updated = busLoad.update(now);
+  uint16_t load = busLoad.loadPermille();
+  taskEXIT_CRITICAL(&busLoadMux);
+
+  if (updated && doorPipeline.applyBusLoad(load)) {
+    tlogf("[CAN] Bus load %u.%u%%, heartbeat every %lu ms", load / 10, load % 10,
+          doorReporter.heartbeatInterval());
+  }
+}
+
+void sendDerivedSignals(uint8_t results, uint8_t ruleMask) {
+  twai_message_t msg = {};
+  msg.identifier = canDerivedId;
+  msg.data_length_code = 6;
+
+  // Byte 0: rule results (bit n = rule n true), byte 1: rules loaded
+  msg.data[0] = results;
+  msg.data[1] = ruleMask;
+
+  // Bytes 2-5: program hash, as reported by the configuration QUERY
+  uint32_t hash = ConfigUpdate::activeHash(ConfigUpdate::KIND_RULES);
+  msg.data[2] = (uint8_t)(hash & 0xFF);
+  msg.data[3] = (uint8_t)((hash >> 8) & 0xFF);
+  msg.data[4] = (uint8_t)((hash >> 16) & 0xFF);
+  msg.data[5] = (uint8_t)(hash >> 24);
+
+  postFrame(msg, doorPipeline.sampleUs());
+}
+
+// Re-evaluate rules whose inputs changed; returns true if a frame was posted
+bool serviceRules(uint16_t currentState, unsigned long now) {
+  taskENTER_CRITICAL(&ruleEngineMux);
+  bool changed = ruleEngine.update(currentState, now);
+  uint8_t results = ruleEngine.results();
+  uint8_t ruleMask = ruleEngine.ruleMask();
+  taskEXIT_CRITICAL(&ruleEngineMux);
+
+  if (!ruleMask) return false;
+  if (!changed && now - lastDerivedTxMs < DERIVED_REPEAT_MS) return false;
+  if (changed) tlogf("[RULE] Results 0x%02X", results);
+  lastDerivedTxMs = now;
+  sendDerivedSignals(results, ruleMask);
+  return true;
+}
+
+uint32_t msUntilRulesDue(unsigned long now) {
+  taskENTER_CRITICAL(&ruleEngineMux);
+  uint32_t untilTimer = ruleEngine.msUntilDue(now);
+  bool loaded = ruleEngine.ruleMask() != 0;
+  taskEXIT_CRITICAL(&ruleEngineMux);
+  if (!loaded) return UINT32_MAX;
+  uint32_t sinceTx = now - lastDerivedTxMs;
+  uint32_t untilRepeat = sinceTx >= DERIVED_REPEAT_MS ? 0 : DERIVED_REPEAT_MS - sinceTx;
+  return min(untilTimer, untilRepeat);
+}
+
+void publishReportingIdle(unsigned long now) {
+  reportingIdle = !reedDebouncer.settling() && !txMailboxBusy() &&
+                  doorReporter.msUntilDue(now) > CAPTURE_ERASE_GUARD_MS;
+}
+
+bool doorReportingIdle() {
+  return reportingIdle;
+}
+
+#if RSW_WIRING_DIAG
+void sendWiringStatus(uint16_t doorState) {
   twai_message_t msg = {};
-  msg.identifier = canMessageId;
-  msg.data_length_code = 2;
+  msg.identifier = canDiagMessageId;
+  msg.data_length_code = 5;
+
+  // Bytes 0-2: 2-bit wiring status per channel, RSW01 in bits 0-1 of byte 0.
+  // Channels without ADC fall back to their digital open/closed state.
+  uint16_t monitored = WiringDiagnostics::monitoredMask();
+  for (uint8_t i = 0; i < NUM_RSW; i++) {
+    uint8_t code = (monitored & (1 << i)) ? wiringStatus[i]
+                 : ((doorState & (1 << i)) ? WIRING_OPEN : WIRING_CLOSED);
+    msg.data[i / 4] |= code << ((i % 4) * 2);
+  }
+
+  // Bytes 3-4: channels classified by ADC (bit n = RSW(n+1))
+  msg.data[3] = (uint8_t)(monitored & 0xFF);
+  msg.data[4] = (uint8_t)((monitored >> 8) & 0x03);
+
+  postFrame(msg, esp_timer_get_time());
+}
+
+void serviceWiringDiagnostics(uint16_t doorState, unsigned long now) {
+  if (now - lastDiagTime >= DIAG_INTERVAL_MS) {
+    lastDiagTime = now;
+    WiringDiagnostics::startBurst();
+  }
+  if (WiringDiagnostics::poll(wiringStatus)) {
+    sendWiringStatus(doorState);
+  }
+}
+#endif
+
+// =============================================================================
+// Status LED
+// =============================================================================
+
+// Channels with a wiring fault or too many confirmed changes in the last window
+uint16_t channelFaultMask() {
+  uint16_t faults = chatterMask;
+#if RSW_WIRING_DIAG
+  uint16_t monitored = WiringDiagnostics::monitoredMask();
+  for (uint8_t i = 0; i < NUM_RSW; i++) {
+    if ((monitored & (1 << i)) &&
+        (wiringStatus[i] == WIRING_SHORT || wiringStatus[i] == WIRING_OPEN_CIRCUIT)) {
+      faults |= (1 << i);
+    }
+  }
+#endif
+  return faults & moduleConfig.enabledMask;
+}
+
+HealthLed::Pattern healthPattern() {
+  if (CanOta::active()) return HealthLed::PATTERN_UPDATE;
+  twai_status_info_t twaiStatus;
+  if (twai_get_status_info(&twaiStatus) == ESP_OK &&
+      (twaiStatus.state == TWAI_STATE_BUS_OFF || twaiStatus.state == TWAI_STATE_RECOVERING)) {
+    return HealthLed::PATTERN_BUS_OFF;
+  }
+  if (txFailStreak >= TX_FAIL_STREAK) return HealthLed::PATTERN_TX_FAILING;
+  if (channelFaultMask()) return HealthLed::PATTERN_FAULT;
+  if (configFlash) return HealthLed::PATTERN_CONFIG;
+  if (BusCapture::active()) return HealthLed::PATTERN_CAPTURE;
+  return HealthLed::PATTERN_OK;
+}
+
+// Pick the highest-priority health pattern; the LED is only written on change
+void serviceHealthLed(unsigned long now) {
+  if (now - lastHealthTime < HEALTH_INTERVAL_MS) return;
+  lastHealthTime = now;
+
+  if (now - chatterWindowStart >= CHATTER_WINDOW_MS) {
+    chatterWindowStart = now;
+    uint16_t chattering = 0;
+    for (uint8_t i = 0; i < NUM_RSW; i++) {
+      if (chatterChanges[i] >= CHATTER_CHANGES) chattering |= (1 << i);
+      chatterChanges[i] = 0;
+    }
+    if (chattering != chatterMask) {
+      tlogf("[RSW] Chattering channel mask 0x%03X", chattering);
+      chatterMask = chattering;
+    }
+  }
+  if (configFlash && now - configAppliedMs >= CONFIG_FLASH_MS) configFlash = false;
+
+  HealthLed::Pattern pattern = healthPattern();
+  if (pattern != HealthLed::current()) {
+    tlogf("[LED] Health pattern %u", pattern);
+    HealthLed::show(pattern);
+  }
+}
+
+// =============================================================================
+// Runtime Configuration
+// =============================================================================
+
+// Copy a configuration into the per-channel and heartbeat step tables
+void loadModuleConfig(const ModuleConfig &config) {
+  moduleConfig = config;
+  for (uint8_t i = 0; i < NUM_RSW; i++) {
+    rswConfig[i].enabled = (config.enabledMask & (1 << i)) != 0;
+    rswConfig[i].glitchFilterNs = config.glitchFilterNs;
+    rswConfig[i].debounceMs = config.debounceMs;
+  }
+  ModuleConfigCodec::heartbeatSteps(config, heartbeatSteps);
+}
 
-  // Byte 0: RSW01-RSW08 (bits 0-7), 1=open, 0=closed
-  msg.data[0] = (uint8_t)(doorState & 0xFF);
+#if RSW_WIRING_DIAG
+WiringThresholds wiringThresholds(const ModuleConfig &config) {
+  return { config.wiringShortMaxMv, config.wiringClosedMaxMv, config.wiringOpenMaxMv };
+}
+#endif
 
-  // Byte 1: RSW09-RSW10 (bits 0-1), bits 2-7 reserved
-  msg.data[1] = (uint8_t)((doorState >> 8) & 0x03);
+// Install a committed rule program (validated on reception)
+void applyRules(const uint8_t *program, uint8_t length) {
+  taskENTER_CRITICAL(&ruleEngineMux);
+  ruleEngine.load(program, length);
+  uint8_t ruleMask = ruleEngine.ruleMask();
+  taskEXIT_CRITICAL(&ruleEngineMux);
+  tlogf("[RULE] Loaded rule mask 0x%02X", ruleMask);
+  configAppliedMs = millis();
+  configFlash = true;
+}
+
+// Switch every parameter of a committed configuration at once (main loop).
+// LP core channels keep the debounce they were started with until reset.
+void applyModuleConfig(const ModuleConfig &config) {
+  loadModuleConfig(config);
+
+  GlitchFilters::release();
+  GlitchFilters::apply(RSW_PINS, rswConfig, NUM_HP_RSW);
+  // Seed from the reported state, not the pins: a door that is bouncing
+  // right now must confirm through the new debounce time instead of being
+  // reported from a single unconfirmed sample
+  reedDebouncer.begin(rswConfig, NUM_HP_RSW, doorPipeline.state(), millis());
+#if RSW_WIRING_DIAG
+  WiringDiagnostics::setThresholds(wiringThresholds(config));
+#endif
 
-  TwaiTaskBased::send(msg);
+  doorReporter.setCoalesceWindow(config.coalesceMs);
+  doorReporter.setBackoff(heartbeatSteps, sizeof(heartbeatSteps) / sizeof(heartbeatSteps[0]));
+  Discovery::setEnabledMask(config.enabledMask);
+  configAppliedMs = millis();
+  configFlash = true;
 }
 
 // =============================================================================
@@ -271,18 +884,52 @@ void setup() {
 #if DEBUG == 0
   Serial.println("Debug disabled - no further serial output.");
 #else
-  debugln("[INIT] Cabinet & Door Sensor starting");
+  TokenLog::begin();
+  tlogf("[INIT] Cabinet & Door Sensor starting");
 #endif
 
   // Initialize RGB LED (built-in WS2812 on GPIO8)
   statusLed.begin();
-  statusLed.setBrightnessPercent(1);
+  statusLed.setBrightnessPercent(RGB_LED_BRIGHTNESS_PERCENT);
+  // Health patterns take the pixel over; statusLed only serves WiFi OTA
+  if (!HealthLed::begin(RGB_LED_PIN, RGB_LED_BRIGHTNESS_PERCENT)) {
+    tlogf("[INIT] ERROR: Status LED RMT channel unavailable");
+  }
+
+  // Stored configuration replaces the defaults before any input is set up
+  if (ConfigUpdate::load(moduleConfig)) {
+    tlogf("[INIT] Using stored configuration %08lX", ConfigUpdate::activeHash());
+  }
+  loadModuleConfig(moduleConfig);
 
   // Configure reed switch inputs with internal pull-ups
-  for (uint8_t i = 0; i < NUM_RSW; i++) {
+  for (uint8_t i = 0; i < NUM_HP_RSW; i++) {
     pinMode(RSW_PINS[i], INPUT_PULLUP);
   }
-  debugf("[INIT] Configured %d reed switch inputs\n", NUM_RSW);
+  uint8_t filterCount = GlitchFilters::apply(RSW_PINS, rswConfig, NUM_HP_RSW);
+  tlogf("[INIT] %d hardware glitch filters enabled", filterCount);
+#if RSW_WIRING_DIAG
+  uint16_t diagMask = WiringDiagnostics::begin(RSW_PINS, NUM_RSW,
+                                               wiringThresholds(moduleConfig));
+  tlogf("[INIT] Wiring diagnostics on channel mask 0x%03X", diagMask);
+#endif
+#if RSW_EDGE_CAPTURE
+  uint8_t capturedCount = EdgeCapture::begin(RSW_PINS, NUM_HP_RSW);
+  lastRawState = readReedSwitches();
+  tlogf("[INIT] %d inputs timestamped by ETM capture", capturedCount);
+#endif
+#if !RSW_LP_CORE
+  // Light sleep owns the HP pin interrupts in low-power builds
+  uint8_t latchedCount = FlashStall::begin(RSW_PINS, NUM_HP_RSW);
+  tlogf("[INIT] %d inputs latched by IRAM edge interrupt", latchedCount);
+#endif
+#if RSW_LP_CORE
+  if (!LpCoreSampler::begin(&RSW_PINS[LP_RSW_FIRST], LP_RSW_COUNT,
+                            LP_SAMPLE_PERIOD_MS, moduleConfig.debounceMs)) {
+    tlogf("[INIT] ERROR: LP core sampler failed - RSW03-RSW10 unavailable");
+  }
+#endif
+  tlogf("[INIT] Configured %d reed switch inputs", NUM_RSW);
 
   // Configure DIP switch address pins with internal pull-ups
   for (uint8_t i = 0; i < NUM_ADDR_PINS; i++) {
@@ -291,35 +938,142 @@ void setup() {
 
   // Read DIP switch address and compute CAN message ID
   uint8_t dipAddr = readDipAddress();
-  canMessageId = CAN_BASE_ID + dipAddr;
-  debugf("[INIT] DIP address: %d, CAN ID: 0x%02X\n", dipAddr, canMessageId);
+  canEventId = CAN_EVENT_BASE_ID + dipAddr;
+  canHeartbeatId = CAN_HEARTBEAT_BASE_ID + dipAddr;
+#if RSW_WIRING_DIAG
+  canDiagMessageId = CAN_DIAG_BASE_ID + dipAddr;
+#endif
+  tlogf("[INIT] DIP address: %d, CAN IDs: event 0x%02X, heartbeat 0x%02X",
+        dipAddr, canEventId, canHeartbeatId);
+
+  // Control frame authentication (key from the build environment)
+  ControlAuth::begin(CAN_AUTH_DISABLED ? "" : CAN_AUTH_KEY);
+
+  // Firmware update over CAN (status replies on CAN_OTA_STATUS_BASE_ID + dip)
+  CanOta::begin(dipAddr, CAN_OTA_STATUS_BASE_ID + dipAddr);
+
+  // Bulk configuration (status replies on CAN_CONFIG_STATUS_BASE_ID + dip)
+  ConfigUpdate::begin(dipAddr, CAN_CONFIG_STATUS_BASE_ID + dipAddr);
+
+  // Derived-signal rules stored with the configuration
+  canDerivedId = CAN_DERIVED_BASE_ID + dipAddr;
+  if (ConfigUpdate::loadRules(ruleEngine)) {
+    tlogf("[INIT] Rules %08lX loaded, rule mask 0x%02X",
+          ConfigUpdate::activeHash(ConfigUpdate::KIND_RULES), ruleEngine.ruleMask());
+  }
+
+  // Bus capture into the spiffs partition (replies on CAN_CAPTURE_REPLY_BASE_ID + dip)
+  if (!BusCapture::begin(dipAddr, CAN_CAPTURE_REPLY_BASE_ID + dipAddr, doorReportingIdle)) {
+    tlogf("[INIT] ERROR: No spiffs partition - bus capture unavailable");
+  }
+
+  // Discovery replies carry the enabled channel mask
+  Discovery::begin(dipAddr, CAN_DISCOVERY_REPLY_BASE_ID + dipAddr,
+                   moduleConfig.enabledMask);
 
   // Initialize CAN bus
+  CanTx::begin();
   TwaiTaskBased::onReceive(onCanRx);
   TwaiTaskBased::onTransmit(onCanTx);
-  TwaiTaskBased::begin(CAN_TX_PIN, CAN_RX_PIN, CAN_BAUDRATE);
-  debugln("[INIT] TWAI started on GPIO14 (TX) / GPIO15 (RX)");
+  TwaiTaskBased::begin(CAN_TX_PIN, CAN_RX_PIN, CanIdPlan::BITRATE);
+  tlogf("[INIT] TWAI started on GPIO14 (TX) / GPIO15 (RX)");
 
   // Read initial state
-  debouncedState = readReedSwitches();
-  lastRawState = debouncedState;
-  lastChangeTime = millis();
+  reedDebouncer.begin(rswConfig, NUM_HP_RSW, readReedSwitches(), millis());
+  uint16_t doorState = reedDebouncer.state();
+#if RSW_LP_CORE
+  doorState |= LpCoreSampler::state() << LP_RSW_FIRST;
+#endif
+  doorPipeline.begin(doorState, moduleConfig.heartbeatMs, canEventId, canHeartbeatId);
+  doorReporter.setCoalesceWindow(moduleConfig.coalesceMs);
+  doorReporter.setBackoff(heartbeatSteps, sizeof(heartbeatSteps) / sizeof(heartbeatSteps[0]));
+  busLoad.begin(CanIdPlan::BITRATE, millis());
+
+  // Door event history (replies on CAN_HISTORY_REPLY_BASE_ID + dip)
+  EventHistory::begin(dipAddr, CAN_HISTORY_REPLY_BASE_ID + dipAddr, doorState,
+                      toBusTime(esp_timer_get_time()) / 1000);
 
-  debugf("[INIT] Initial door state: 0x%04X\n", debouncedState);
-  statusLed.green();
-  debugln("[INIT] Setup complete");
+  tlogf("[INIT] Initial door state: 0x%04X", doorState);
+  HealthLed::show(HealthLed::PATTERN_OK);
+  tlogf("[INIT] Setup complete");
 }
 
 // =============================================================================
 // Main Loop
 // =============================================================================
 
+#if RSW_LP_CORE
+
+// The HP core only runs for a few milliseconds per heartbeat or confirmed
+// change, then light-sleeps until the next one.
 void loop() {
+  ConfigUpdate::service(applyModuleConfig, applyRules);
+  ControlAuth::service();
+  LpCoreSampler::takeChange();
   uint16_t currentState = readDebouncedSwitches();
 
   unsigned long now = millis();
-  if (now - lastTxTime >= TX_INTERVAL_MS) {
-    lastTxTime = now;
-    sendDoorStatus(currentState);
+  bool posted = sendDueDoorStatus(now);
+  posted |= serviceRules(currentState, now);
+  if (posted) {
+    serviceTxMailbox();
+    while (txMailboxBusy() && millis() - now < LP_TX_DRAIN_TIMEOUT_MS) {
+      delay(1);
+      serviceTxMailbox();
+    }
+  }
+
+  serviceHealthLed(now);
+  EventHistory::service(millis());
+
+  uint32_t untilDue = min(doorReporter.msUntilDue(millis()), msUntilRulesDue(millis()));
+  publishReportingIdle(millis());
+
+  if (EventHistory::draining()) {
+    // History frames go out one per millisecond - stay awake until done
+    delay(1);
+    return;
+  }
+
+  // Only the timer and the reed inputs wake the HP core, so frames sent to a
+  // sleeping module are lost. Stay awake - nap without sleeping - while the
+  // sniffer runs, a CAN update or configuration push is in progress, or
+  // control frames wait for their AUTH frame.
+  if (BusCapture::active() || CanOta::active() || ConfigUpdate::active() ||
+      ControlAuth::holding()) {
+    delay(min(untilDue, LP_SAMPLE_PERIOD_MS));
+    return;
+  }
+
+  if (reedDebouncer.settling()) {
+    // HP channel still settling - nap one sample period without GPIO wakeup
+    LpCoreSampler::lightSleep(min(untilDue, LP_SAMPLE_PERIOD_MS), nullptr, 0, 0);
+  } else {
+    LpCoreSampler::lightSleep(untilDue, RSW_PINS, NUM_HP_RSW,
+                              reedDebouncer.state());
   }
 }
+
+#else
+
+void loop() {
+  ConfigUpdate::service(applyModuleConfig, applyRules);
+  ControlAuth::service();
+  uint16_t currentState = readDebouncedSwitches();
+
+  unsigned long now = millis();
+  serviceBusLoad(now);
+  sendDueDoorStatus(now);
+  serviceRules(currentState, now);
+
+#if RSW_WIRING_DIAG
+  serviceWiringDiagnostics(currentState, now);
+#endif
+
+  serviceTxMailbox();
+  EventHistory::service(now);
+  serviceHealthLed(now);
+  publishReportingIdle(now);
+}
+
+#endif
@@ -0,0 +1,85 @@
+#include <unity.h>
+#include "BusClock.h"
+
+static BusClock busClock;
+
+void setUp() {
+  busClock = BusClock();
+}
+
+void tearDown() {}
+
+// One SYNC/FOLLOW_UP exchange, the master stamping masterUs
+static bool exchange(uint8_t seq, int64_t localUs, int64_t masterUs) {
+  busClock.onSync(seq, localUs);
+  return busClock.onFollowUp(seq, masterUs);
+}
+
+static void test_identity_until_first_sync() {
+  TEST_ASSERT_FALSE(busClock.synced(0));
+  TEST_ASSERT_EQUAL_INT64(12345, busClock.toBusUs(12345));
+}
+
+static void test_first_sync_anchors_the_clock() {
+  TEST_ASSERT_TRUE(exchange(1, 1000, 5001000));
+  TEST_ASSERT_TRUE(busClock.synced(1000));
+  TEST_ASSERT_EQUAL_INT64(5001500, busClock.toBusUs(1500));
+  TEST_ASSERT_EQUAL_UINT32(1, busClock.syncCount());
+}
+
+static void test_follow_up_must_match_sync() {
+  TEST_ASSERT_FALSE(busClock.onFollowUp(1, 100));
+  busClock.onSync(2, 1000);
+  TEST_ASSERT_FALSE(busClock.onFollowUp(3, 100));
+  TEST_ASSERT_TRUE(busClock.onFollowUp(2, 100));
+  // A SYNC is only used once
+  TEST_ASSERT_FALSE(busClock.onFollowUp(2, 100));
+}
+
+static void test_small_error_slews_by_a_quarter() {
+  exchange(1, 0, 0);
+  exchange(2, 1000000, 1000400);
+  // Drift takes 1/8 of the measured 400 ppm first, which already predicts
+  // 50 us of the error; the phase then takes a quarter of the rest
+  TEST_ASSERT_EQUAL_INT32(50000, busClock.driftPpb());
+  TEST_ASSERT_EQUAL_INT64(350, busClock.lastErrorUs());
+  TEST_ASSERT_EQUAL_INT64(1000050 + 350 / 4, busClock.toBusUs(1000000));
+}
+
+static void test_large_error_steps() {
+  exchange(1, 0, 0);
+  exchange(2, 1000000, 1005000);
+  TEST_ASSERT_EQUAL_INT64(5000, busClock.lastErrorUs());
+  TEST_ASSERT_EQUAL_INT64(1005000, busClock.toBusUs(1000000));
+  // 5000 ppm is an outlier and leaves the drift alone
+  TEST_ASSERT_EQUAL_INT32(0, busClock.driftPpb());
+}
+
+static void test_drift_converges() {
+  // Local busClock runs 100 ppm slow against the master
+  for (uint8_t i = 0; i < 80; i++) {
+    int64_t localUs = (int64_t)i * 1000000;
+    exchange(i, localUs, localUs + localUs / 10000);
+  }
+  TEST_ASSERT_INT_WITHIN(1000, 100000, busClock.driftPpb());
+  int64_t localUs = 80LL * 1000000;
+  TEST_ASSERT_INT64_WITHIN(10, localUs + localUs / 10000, busClock.toBusUs(localUs));
+}
+
+static void test_sync_times_out() {
+  exchange(1, 0, 0);
+  TEST_ASSERT_TRUE(busClock.synced(BusClock::SYNC_TIMEOUT_US - 1));
+  TEST_ASSERT_FALSE(busClock.synced(BusClock::SYNC_TIMEOUT_US));
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_identity_until_first_sync);
+  RUN_TEST(test_first_sync_anchors_the_clock);
+  RUN_TEST(test_follow_up_must_match_sync);
+  RUN_TEST(test_small_error_slews_by_a_quarter);
+  RUN_TEST(test_large_error_steps);
+  RUN_TEST(test_drift_converges);
+  RUN_TEST(test_sync_times_out);
+  return UNITY_END();
+}
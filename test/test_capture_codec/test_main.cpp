@@ -0,0 +1,102 @@
+#include <unity.h>
+#include "CaptureCodec.h"
+
+#include <string.h>
+
+static uint8_t sector[256];
+static CaptureEncoder encoder;
+
+static CapturedFrame frame(int64_t timeUs, uint32_t id, uint8_t dlc, uint8_t fill) {
+  CapturedFrame result = {};
+  result.timeUs = timeUs;
+  result.id = id;
+  result.dlc = dlc;
+  memset(result.data, fill, dlc);
+  return result;
+}
+
+void setUp() {
+  memset(sector, 0xFF, sizeof(sector));
+}
+
+void tearDown() {}
+
+static void test_header() {
+  encoder.beginSector(sector, sizeof(sector), 0x01020304, 0x0506,
+                      CaptureEncoder::FLAG_SESSION_START, 0x0000000A0B0C0D0ELL);
+  const uint8_t expected[] = {
+    'C', 'A', 'P', '1', 0x04, 0x03, 0x02, 0x01, 0x06, 0x05, 0x01, 0x00,
+    0x0E, 0x0D, 0x0C, 0x0B, 0x0A, 0x00, 0x00, 0x00,
+  };
+  TEST_ASSERT_EQUAL_HEX8_ARRAY(expected, sector, sizeof(expected));
+  TEST_ASSERT_EQUAL(CaptureEncoder::HEADER_SIZE, encoder.used());
+  TEST_ASSERT_EQUAL_HEX8(0xFF, sector[CaptureEncoder::HEADER_SIZE]);
+}
+
+static void test_dictionary_and_repeat() {
+  encoder.beginSector(sector, sizeof(sector), 0, 0, 0, 1000);
+  TEST_ASSERT_TRUE(encoder.add(frame(1100, 0x123, 2, 0xAB)));
+  TEST_ASSERT_TRUE(encoder.add(frame(1300, 0x123, 2, 0xAB)));
+  TEST_ASSERT_TRUE(encoder.add(frame(1300, 0x123, 2, 0xCD)));
+  const uint8_t expected[] = {
+    0x40, 0x23, 0x01, 0x02, 100, 0xAB, 0xAB,  // New ID, entry 0
+    0x00, 0x12, 0xC8, 0x01,                   // Entry 0, repeat, +200 us
+    0x00, 0x02, 0x00, 0xCD, 0xCD,             // Entry 0, new data
+  };
+  TEST_ASSERT_EQUAL_HEX8_ARRAY(expected, &sector[CaptureEncoder::HEADER_SIZE], sizeof(expected));
+  TEST_ASSERT_EQUAL(CaptureEncoder::HEADER_SIZE + sizeof(expected), encoder.used());
+}
+
+static void test_extended_rtr_and_marker() {
+  encoder.beginSector(sector, sizeof(sector), 0, 0, 0, 0);
+  CapturedFrame extended = frame(5, 0x18FF1234, 1, 0x77);
+  extended.extended = true;
+  CapturedFrame remote = frame(3, 0x7FF, 4, 0);
+  remote.rtr = true;
+  TEST_ASSERT_TRUE(encoder.add(extended));
+  TEST_ASSERT_TRUE(encoder.add(remote));
+  TEST_ASSERT_TRUE(encoder.addMarker(CaptureEncoder::MARKER_DROPPED, 300));
+  const uint8_t expected[] = {
+    0x41, 0x34, 0x12, 0xFF, 0x18, 0x01, 5, 0x77,  // 29-bit ID, never in the dictionary
+    0x40, 0xFF, 0x07, 0x24, 0,                     // RTR, earlier time clamps to 0
+    0xC1, 0xAC, 0x02,                              // Dropped 300
+  };
+  TEST_ASSERT_EQUAL_HEX8_ARRAY(expected, &sector[CaptureEncoder::HEADER_SIZE], sizeof(expected));
+}
+
+static void test_dictionary_full_falls_back_to_inline_ids() {
+  static uint8_t large[4096];
+  memset(large, 0xFF, sizeof(large));
+  encoder.beginSector(large, sizeof(large), 0, 0, 0, 0);
+  for (uint16_t id = 0; id < CaptureEncoder::DICTIONARY_SIZE; id++) {
+    TEST_ASSERT_TRUE(encoder.add(frame(0, id, 0, 0)));
+  }
+  uint16_t before = encoder.used();
+  TEST_ASSERT_TRUE(encoder.add(frame(0, 0x700, 0, 0)));
+  TEST_ASSERT_TRUE(encoder.add(frame(0, 0x700, 0, 0)));
+  const uint8_t expected[] = { 0x40, 0x00, 0x07, 0x00, 0, 0x40, 0x00, 0x07, 0x00, 0 };
+  TEST_ASSERT_EQUAL_HEX8_ARRAY(expected, &large[before], sizeof(expected));
+  // Entries already in the dictionary still encode by index
+  TEST_ASSERT_TRUE(encoder.add(frame(0, 5, 0, 0)));
+  TEST_ASSERT_EQUAL_HEX8(5, large[before + sizeof(expected)]);
+}
+
+static void test_sector_full_keeps_room_for_a_record() {
+  encoder.beginSector(sector, sizeof(sector), 0, 0, 0, 0);
+  uint16_t frames = 0;
+  while (encoder.add(frame(frames, 0x100 + frames % 8, 8, frames))) frames++;
+  TEST_ASSERT_TRUE(frames > 0);
+  TEST_ASSERT_TRUE(sizeof(sector) - encoder.used() < CaptureEncoder::MAX_RECORD);
+  TEST_ASSERT_FALSE(encoder.addMarker(CaptureEncoder::MARKER_DROPPED, 1));
+  TEST_ASSERT_EQUAL_HEX8(0xFF, sector[encoder.used()]);
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_header);
+  RUN_TEST(test_dictionary_and_repeat);
+  RUN_TEST(test_extended_rtr_and_marker);
+  RUN_TEST(test_dictionary_full_falls_back_to_inline_ids);
+  RUN_TEST(test_sector_full_keeps_room_for_a_record);
+  return UNITY_END();
+}
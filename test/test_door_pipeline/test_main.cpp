@@ -0,0 +1,124 @@
+#include <unity.h>
+#include "DoorPipeline.h"
+
+static const uint32_t EVENT_ID = 0x00C;
+static const uint32_t HEARTBEAT_ID = 0x02C;
+static const uint8_t CHANNELS = 2;
+
+static ReedChannelConfig config[CHANNELS];
+static ReedDebouncer debouncer;
+static DoorReporter reporter;
+static DoorPipeline pipeline(debouncer, reporter);
+static CanFrame frames[2];
+
+// Hardware edge times handed to the pipeline, -1 = none
+static int64_t hardwareUs[ReedDebouncer::MAX_CHANNELS];
+
+static int64_t readEdge(uint8_t channel, void* context) {
+  return static_cast<int64_t*>(context)[channel];
+}
+
+void setUp() {
+  for (int64_t& edge : hardwareUs) edge = -1;
+  config[0] = { true, 0, 50 };
+  config[1] = { true, 0, 50 };
+  debouncer.begin(config, CHANNELS, 0x0000, 0);
+  reporter = DoorReporter();
+  pipeline.begin(0x0000, 200, EVENT_ID, HEARTBEAT_ID);
+}
+
+void tearDown() {}
+
+static void test_first_report_is_a_heartbeat() {
+  pipeline.sample(0x0000, 0x0000, 1000, 1, readEdge, hardwareUs);
+  uint8_t due = pipeline.report(1, frames);
+  TEST_ASSERT_EQUAL_HEX8(DoorReporter::SEND_HEARTBEAT, due);
+  TEST_ASSERT_EQUAL_HEX32(HEARTBEAT_ID, frames[1].id);
+  TEST_ASSERT_EQUAL_UINT8(8, frames[1].dlc);
+  TEST_ASSERT_EQUAL_UINT32(1000, frames[1].sampleUs);
+  // No edge yet: the age saturates
+  TEST_ASSERT_EQUAL_HEX8(0xFF, frames[1].data[2]);
+  TEST_ASSERT_EQUAL_HEX8(0xFF, frames[1].data[3]);
+}
+
+static void test_change_is_timed_from_the_hardware_edge() {
+  hardwareUs[1] = 100250;
+  pipeline.sample(0x0002, 0x0000, 100300, 100, readEdge, hardwareUs);
+  TEST_ASSERT_EQUAL_HEX16(0x0002, pipeline.sample(0x0002, 0x0000, 150300, 150, readEdge, hardwareUs));
+  TEST_ASSERT_EQUAL_HEX16(0x0002, pipeline.state());
+  TEST_ASSERT_EQUAL_INT64(100250, pipeline.changeUs(1));
+  TEST_ASSERT_EQUAL_INT64(100250, pipeline.lastEdgeUs());
+
+  TEST_ASSERT_TRUE(pipeline.report(150, frames) & DoorReporter::SEND_EVENT);
+  TEST_ASSERT_EQUAL_HEX8(0x02, frames[0].data[0]);
+  TEST_ASSERT_EQUAL_UINT16(50, frames[0].data[2] | (frames[0].data[3] << 8));
+}
+
+static void test_without_hardware_edge_the_debouncer_times_the_change() {
+  pipeline.sample(0x0001, 0x0000, 100000, 100, nullptr, nullptr);
+  pipeline.sample(0x0001, 0x0000, 150000, 150, nullptr, nullptr);
+  TEST_ASSERT_EQUAL_INT64(100000, pipeline.changeUs(0));
+}
+
+static void test_other_channels_merge_and_take_the_sample_time() {
+  TEST_ASSERT_EQUAL_HEX16(0x0010, pipeline.sample(0x0000, 0x0010, 7000, 7, readEdge, hardwareUs));
+  TEST_ASSERT_EQUAL_HEX16(0x0010, pipeline.state());
+  TEST_ASSERT_EQUAL_INT64(7000, pipeline.changeUs(4));
+}
+
+static void test_newest_edge_never_goes_back() {
+  hardwareUs[0] = 90000;
+  hardwareUs[1] = 80000;
+  pipeline.sample(0x0003, 0x0000, 95000, 95, readEdge, hardwareUs);
+  pipeline.sample(0x0003, 0x0000, 145000, 145, readEdge, hardwareUs);
+  TEST_ASSERT_EQUAL_INT64(90000, pipeline.lastEdgeUs());
+  TEST_ASSERT_EQUAL_INT64(80000, pipeline.changeUs(1));
+}
+
+static void test_event_after_coalescing() {
+  reporter.setCoalesceWindow(10);
+  pipeline.sample(0x0000, 0x0000, 0, 0, nullptr, nullptr);
+  pipeline.report(0, frames);
+  pipeline.sample(0x0000, 0x0001, 20000, 20, nullptr, nullptr);
+  TEST_ASSERT_EQUAL_HEX8(0, pipeline.report(20, frames));
+  TEST_ASSERT_EQUAL_HEX8(DoorReporter::SEND_EVENT, pipeline.report(30, frames));
+  TEST_ASSERT_EQUAL_HEX32(EVENT_ID, frames[0].id);
+  TEST_ASSERT_EQUAL_HEX8(0x01, frames[0].data[0]);
+}
+
+static void test_queued_fills_only_door_frames() {
+  CanFrame door = {};
+  door.id = EVENT_ID;
+  door.sampleUs = 1000;
+  pipeline.queued(door, 1300, 0x12345);
+  const uint8_t expected[] = { 0x2C, 0x01, 0x45, 0x23 };
+  TEST_ASSERT_EQUAL_HEX8_ARRAY(expected, &door.data[4], sizeof(expected));
+
+  CanFrame other = {};
+  other.id = 0x123;
+  pipeline.queued(other, 1300, 0x12345);
+  TEST_ASSERT_EQUAL_HEX8(0, other.data[4]);
+}
+
+static void test_bus_load_backs_off_the_heartbeat() {
+  static const HeartbeatStep steps[] = { { 0, 0, 200 }, { 600, 500, 500 } };
+  reporter.setBackoff(steps, 2);
+  TEST_ASSERT_TRUE(pipeline.applyBusLoad(650));
+  TEST_ASSERT_EQUAL_UINT32(500, reporter.heartbeatInterval());
+  TEST_ASSERT_FALSE(pipeline.applyBusLoad(550));
+  TEST_ASSERT_TRUE(pipeline.applyBusLoad(450));
+  TEST_ASSERT_EQUAL_UINT32(200, reporter.heartbeatInterval());
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_first_report_is_a_heartbeat);
+  RUN_TEST(test_change_is_timed_from_the_hardware_edge);
+  RUN_TEST(test_without_hardware_edge_the_debouncer_times_the_change);
+  RUN_TEST(test_other_channels_merge_and_take_the_sample_time);
+  RUN_TEST(test_newest_edge_never_goes_back);
+  RUN_TEST(test_event_after_coalescing);
+  RUN_TEST(test_queued_fills_only_door_frames);
+  RUN_TEST(test_bus_load_backs_off_the_heartbeat);
+  return UNITY_END();
+}
@@ -0,0 +1,131 @@
+#include <unity.h>
+#include "EventLog.h"
+
+#include <string.h>
+
+static const uint16_t BLOCKS = 4;
+static uint8_t storage[BLOCKS * EventLog::BLOCK_SIZE];
+static EventLog eventLog;
+
+void setUp() {}
+void tearDown() {}
+
+// tools/test_can_history.py decodes the same block with can_history.py, so
+// the firmware encoder and the host decoder cannot drift apart
+static const uint8_t REFERENCE_BLOCK[] = {
+  0x00, 0x00, 0x00, 0x00,              // sequence 0
+  0xE8, 0x03, 0x00, 0x00, 0x00, 0x00,  // checkpoint 1000 ms
+  0x01, 0x00,                          // RSW01 open
+  0x2A, 0xF4, 0x03, 0x64, 0x0A,        // RSW03 open +500, closed +100, open +10
+  0x00, 0x00,                          // RSW01 closed +0
+  0x98, 0xA0, 0x9C, 0x01,              // RSW10 open +20000
+};
+
+static void appendReferenceEvents() {
+  eventLog.begin(storage, BLOCKS, 0x0001, 1000);
+  eventLog.append(2, true, 1500);
+  eventLog.append(2, false, 1600);
+  eventLog.append(2, true, 1610);
+  eventLog.append(0, false, 1610);
+  eventLog.append(9, true, 21610);
+}
+
+static void test_checkpoint_opens_first_block() {
+  eventLog.begin(storage, BLOCKS, 0x0205, 0x0102030405ULL);
+  const uint8_t* block = eventLog.block(0);
+  const uint8_t expected[] = { 0, 0, 0, 0, 0x05, 0x04, 0x03, 0x02, 0x01, 0x00, 0x05, 0x02 };
+  TEST_ASSERT_EQUAL_HEX8_ARRAY(expected, block, sizeof(expected));
+  TEST_ASSERT_EQUAL_HEX8(EventLog::END, block[EventLog::HEADER_SIZE]);
+  TEST_ASSERT_EQUAL(1, eventLog.usedBlocks());
+  TEST_ASSERT_EQUAL(0, eventLog.currentBlock());
+}
+
+static void test_reference_block() {
+  appendReferenceEvents();
+  TEST_ASSERT_EQUAL_HEX8_ARRAY(REFERENCE_BLOCK, eventLog.block(0), sizeof(REFERENCE_BLOCK));
+  TEST_ASSERT_EQUAL_HEX8(EventLog::END, eventLog.block(0)[sizeof(REFERENCE_BLOCK)]);
+  TEST_ASSERT_EQUAL(5, eventLog.eventCount());
+  TEST_ASSERT_EQUAL(sizeof(REFERENCE_BLOCK) - EventLog::HEADER_SIZE, eventLog.encodedBytes());
+}
+
+static void test_run_stops_at_max_run() {
+  eventLog.begin(storage, BLOCKS, 0, 0);
+  for (uint8_t i = 0; i <= EventLog::MAX_RUN + 1; i++) eventLog.append(4, i % 2 == 0, i);
+  const uint8_t* block = eventLog.block(0);
+  // One header carries MAX_RUN further toggles, the next change starts a record
+  TEST_ASSERT_EQUAL_HEX8(0x48 | EventLog::MAX_RUN, block[EventLog::HEADER_SIZE]);
+  TEST_ASSERT_EQUAL_HEX8(0x48, block[EventLog::HEADER_SIZE + 1 + EventLog::MAX_RUN + 1]);
+}
+
+static void test_same_state_twice_is_not_a_run() {
+  eventLog.begin(storage, BLOCKS, 0, 0);
+  eventLog.append(1, true, 10);
+  eventLog.append(1, true, 20);
+  const uint8_t* block = eventLog.block(0);
+  TEST_ASSERT_EQUAL_HEX8(0x18, block[EventLog::HEADER_SIZE]);
+  TEST_ASSERT_EQUAL_HEX8(0x18, block[EventLog::HEADER_SIZE + 2]);
+}
+
+static void test_earlier_time_is_clamped() {
+  eventLog.begin(storage, BLOCKS, 0, 500);
+  eventLog.append(0, true, 400);
+  TEST_ASSERT_EQUAL_HEX8(0x00, eventLog.block(0)[EventLog::HEADER_SIZE + 1]);
+}
+
+static void test_invalid_channel_is_ignored() {
+  eventLog.begin(storage, BLOCKS, 0, 0);
+  eventLog.append(EventLog::MAX_CHANNELS, true, 10);
+  TEST_ASSERT_EQUAL(0, eventLog.eventCount());
+  TEST_ASSERT_EQUAL_HEX8(EventLog::END, eventLog.block(0)[EventLog::HEADER_SIZE]);
+}
+
+static void test_full_block_opens_checkpoint_with_state() {
+  eventLog.begin(storage, BLOCKS, 0, 0);
+  // Alternating channels never form runs: 2 bytes per change
+  uint32_t timeMs = 0;
+  uint8_t changes = 0;
+  while (eventLog.currentBlock() == 0) {
+    timeMs += 50;
+    eventLog.append(changes % 2, (changes / 2) % 2 == 0, timeMs);
+    changes++;
+  }
+  const uint8_t* block = eventLog.block(1);
+  TEST_ASSERT_EQUAL_HEX8(1, block[0]);  // Sequence
+  uint64_t checkpointMs = 0;
+  for (uint8_t i = 0; i < 6; i++) checkpointMs |= (uint64_t)block[4 + i] << (8 * i);
+  TEST_ASSERT_EQUAL_INT64(timeMs, checkpointMs);
+  // The checkpoint holds the state before the change that opened the block,
+  // and that change follows with delta 0
+  uint8_t last = (changes - 1) % 2;
+  bool lastOpen = ((changes - 1) / 2) % 2 == 0;
+  uint16_t before = (uint16_t)(lastOpen ? 0 : (1 << last)) | (uint16_t)(1 << (last ^ 1));
+  TEST_ASSERT_EQUAL_HEX16(before, block[10] | (block[11] << 8));
+  TEST_ASSERT_EQUAL_HEX8((last << 4) | (lastOpen ? 0x08 : 0), block[EventLog::HEADER_SIZE]);
+  TEST_ASSERT_EQUAL_HEX8(0, block[EventLog::HEADER_SIZE + 1]);
+}
+
+static void test_ring_overwrites_oldest() {
+  eventLog.begin(storage, BLOCKS, 0, 0);
+  for (uint32_t i = 0; eventLog.blockCount() == BLOCKS && i < 1000; i++) {
+    eventLog.append(i % 2, (i / 2) % 2 == 0, i * 100);
+  }
+  TEST_ASSERT_EQUAL(BLOCKS, eventLog.usedBlocks());
+  // Sequence numbers keep counting past the ring size
+  uint8_t current = eventLog.currentBlock();
+  uint8_t previous = (current + BLOCKS - 1) % BLOCKS;
+  TEST_ASSERT_EQUAL(eventLog.block(previous)[0] + 1, eventLog.block(current)[0]);
+  TEST_ASSERT_TRUE(eventLog.block(current)[0] >= BLOCKS);
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_checkpoint_opens_first_block);
+  RUN_TEST(test_reference_block);
+  RUN_TEST(test_run_stops_at_max_run);
+  RUN_TEST(test_same_state_twice_is_not_a_run);
+  RUN_TEST(test_earlier_time_is_clamped);
+  RUN_TEST(test_invalid_channel_is_ignored);
+  RUN_TEST(test_full_block_opens_checkpoint_with_state);
+  RUN_TEST(test_ring_overwrites_oldest);
+  return UNITY_END();
+}
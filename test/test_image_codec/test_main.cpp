@@ -0,0 +1,115 @@
+#include <unity.h>
+#include "ImageCodec.h"
+
+#include <string.h>
+
+static uint8_t out[ImageCodec::MAX_OUTPUT];
+static ImageCodec::Header header;
+
+static const uint8_t BASE_IMAGE[] = "0123456789ABCDEFGHIJ";
+
+static bool readBase(uint32_t offset, uint8_t* dst, uint16_t length, void* context) {
+  (*(int*)context)++;
+  if (offset + length > sizeof(BASE_IMAGE)) return false;
+  memcpy(dst, &BASE_IMAGE[offset], length);
+  return true;
+}
+
+void setUp() {
+  memset(out, 0xEE, sizeof(out));
+}
+
+void tearDown() {}
+
+static void test_header_fields() {
+  const uint8_t block[] = { ImageCodec::FORMAT_LZ, 0x00, 0x10, 0x02, 0x00, 0x10 };
+  TEST_ASSERT_TRUE(ImageCodec::parseHeader(block, sizeof(block), header));
+  TEST_ASSERT_EQUAL_UINT8(ImageCodec::FORMAT_LZ, header.format);
+  TEST_ASSERT_EQUAL_HEX32(0x021000, header.outOffset);
+  TEST_ASSERT_EQUAL_UINT16(ImageCodec::MAX_OUTPUT, header.outLength);
+}
+
+static void test_header_rejects_bad_blocks() {
+  const uint8_t oversized[] = { ImageCodec::FORMAT_RAW, 0, 0, 0, 0x01, 0x10 };
+  const uint8_t unknownFormat[] = { 2, 0, 0, 0, 1, 0 };
+  TEST_ASSERT_FALSE(ImageCodec::parseHeader(oversized, sizeof(oversized), header));
+  TEST_ASSERT_FALSE(ImageCodec::parseHeader(unknownFormat, sizeof(unknownFormat), header));
+  TEST_ASSERT_FALSE(ImageCodec::parseHeader(oversized, ImageCodec::HEADER_SIZE - 1, header));
+}
+
+static void test_raw_block() {
+  const uint8_t block[] = { ImageCodec::FORMAT_RAW, 0, 0, 0, 3, 0, 0xAA, 0xBB, 0xCC, 0xFF };
+  TEST_ASSERT_TRUE(ImageCodec::decode(block, sizeof(block), out, header, nullptr, nullptr));
+  const uint8_t expected[] = { 0xAA, 0xBB, 0xCC, 0xEE };
+  TEST_ASSERT_EQUAL_HEX8_ARRAY(expected, out, sizeof(expected));
+  TEST_ASSERT_FALSE(ImageCodec::decode(block, 8, out, header, nullptr, nullptr));
+}
+
+static void test_literal_and_overlapping_copy() {
+  // "ab", then copy 6 bytes from distance 2
+  const uint8_t block[] = { ImageCodec::FORMAT_LZ, 0, 0, 0, 8, 0, 0x01, 'a', 'b', 0x43, 0x02 };
+  TEST_ASSERT_TRUE(ImageCodec::decode(block, sizeof(block), out, header, nullptr, nullptr));
+  TEST_ASSERT_EQUAL_MEMORY("abababab", out, 8);
+}
+
+static void test_long_count_varint() {
+  // Literal of 63 + 1 + 1 bytes via the count extension
+  uint8_t block[ImageCodec::HEADER_SIZE + 2 + 65] = { ImageCodec::FORMAT_LZ, 0, 0, 0, 65, 0, 0x3F, 0x01 };
+  for (uint8_t i = 0; i < 65; i++) block[8 + i] = i;
+  TEST_ASSERT_TRUE(ImageCodec::decode(block, sizeof(block), out, header, nullptr, nullptr));
+  TEST_ASSERT_EQUAL_HEX8(0, out[0]);
+  TEST_ASSERT_EQUAL_HEX8(64, out[64]);
+  TEST_ASSERT_EQUAL_HEX8(0xEE, out[65]);
+}
+
+static void test_copy_source_reads_base_image() {
+  // At image offset 4: copy 4 bytes from offset 4 + 6, then 3 from 4 + 4 - 3
+  const uint8_t block[] = { ImageCodec::FORMAT_LZ, 4, 0, 0, 7, 0, 0x81, 12, 0x80, 5 };
+  int reads = 0;
+  TEST_ASSERT_TRUE(ImageCodec::decode(block, sizeof(block), out, header, readBase, &reads));
+  TEST_ASSERT_EQUAL_MEMORY("ABCD567", out, 7);
+  TEST_ASSERT_EQUAL(2, reads);
+}
+
+static void test_copy_source_needs_a_base() {
+  const uint8_t block[] = { ImageCodec::FORMAT_LZ, 0, 0, 0, 3, 0, 0x80, 0 };
+  TEST_ASSERT_FALSE(ImageCodec::decode(block, sizeof(block), out, header, nullptr, nullptr));
+  // Before the start of the image
+  const uint8_t negative[] = { ImageCodec::FORMAT_LZ, 0, 0, 0, 3, 0, 0x80, 1 };
+  int reads = 0;
+  TEST_ASSERT_FALSE(ImageCodec::decode(negative, sizeof(negative), out, header, readBase, &reads));
+  TEST_ASSERT_EQUAL(0, reads);
+}
+
+static void test_rejects_malformed_ops() {
+  const uint8_t distanceZero[] = { ImageCodec::FORMAT_LZ, 0, 0, 0, 4, 0, 0x00, 'a', 0x40, 0 };
+  const uint8_t distanceTooFar[] = { ImageCodec::FORMAT_LZ, 0, 0, 0, 4, 0, 0x00, 'a', 0x40, 2 };
+  const uint8_t overruns[] = { ImageCodec::FORMAT_LZ, 0, 0, 0, 2, 0, 0x02, 'a', 'b', 'c' };
+  const uint8_t truncated[] = { ImageCodec::FORMAT_LZ, 0, 0, 0, 4, 0, 0x03, 'a', 'b' };
+  const uint8_t badKind[] = { ImageCodec::FORMAT_LZ, 0, 0, 0, 1, 0, 0xC0, 'a' };
+  TEST_ASSERT_FALSE(ImageCodec::decode(distanceZero, sizeof(distanceZero), out, header, nullptr, nullptr));
+  TEST_ASSERT_FALSE(ImageCodec::decode(distanceTooFar, sizeof(distanceTooFar), out, header, nullptr, nullptr));
+  TEST_ASSERT_FALSE(ImageCodec::decode(overruns, sizeof(overruns), out, header, nullptr, nullptr));
+  TEST_ASSERT_FALSE(ImageCodec::decode(truncated, sizeof(truncated), out, header, nullptr, nullptr));
+  TEST_ASSERT_FALSE(ImageCodec::decode(badKind, sizeof(badKind), out, header, nullptr, nullptr));
+}
+
+static void test_trailing_padding_is_ignored() {
+  const uint8_t block[] = { ImageCodec::FORMAT_LZ, 0, 0, 0, 1, 0, 0x00, 'z', 0xFF, 0xFF, 0xFF };
+  TEST_ASSERT_TRUE(ImageCodec::decode(block, sizeof(block), out, header, nullptr, nullptr));
+  TEST_ASSERT_EQUAL_HEX8('z', out[0]);
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_header_fields);
+  RUN_TEST(test_header_rejects_bad_blocks);
+  RUN_TEST(test_raw_block);
+  RUN_TEST(test_literal_and_overlapping_copy);
+  RUN_TEST(test_long_count_varint);
+  RUN_TEST(test_copy_source_reads_base_image);
+  RUN_TEST(test_copy_source_needs_a_base);
+  RUN_TEST(test_rejects_malformed_ops);
+  RUN_TEST(test_trailing_padding_is_ignored);
+  return UNITY_END();
+}
@@ -0,0 +1,161 @@
+#include <unity.h>
+#include "ModuleConfig.h"
+
+#include <string.h>
+
+static ModuleConfig config;
+
+void setUp() {
+  config = {};
+  config.enabledMask = 0x03FF;
+  config.debounceMs = 50;
+  config.glitchFilterNs = 400;
+  config.heartbeatMs = 200;
+  config.coalesceMs = 10;
+  config.backoffEnterPermille[0] = 500;
+  config.backoffExitPermille[0] = 400;
+  config.backoffHeartbeatMs[0] = 500;
+  config.backoffEnterPermille[1] = 800;
+  config.backoffExitPermille[1] = 700;
+  config.backoffHeartbeatMs[1] = 1000;
+  config.wiringShortMaxMv = 200;
+  config.wiringClosedMaxMv = 1200;
+  config.wiringOpenMaxMv = 3100;
+}
+
+void tearDown() {}
+
+static void assertSameConfig(const ModuleConfig& expected, const ModuleConfig& actual) {
+  TEST_ASSERT_EQUAL_HEX16(expected.enabledMask, actual.enabledMask);
+  TEST_ASSERT_EQUAL_UINT16(expected.debounceMs, actual.debounceMs);
+  TEST_ASSERT_EQUAL_UINT16(expected.glitchFilterNs, actual.glitchFilterNs);
+  TEST_ASSERT_EQUAL_UINT16(expected.heartbeatMs, actual.heartbeatMs);
+  TEST_ASSERT_EQUAL_UINT8(expected.coalesceMs, actual.coalesceMs);
+  for (uint8_t i = 0; i < 2; i++) {
+    TEST_ASSERT_EQUAL_UINT16(expected.backoffEnterPermille[i], actual.backoffEnterPermille[i]);
+    TEST_ASSERT_EQUAL_UINT16(expected.backoffExitPermille[i], actual.backoffExitPermille[i]);
+    TEST_ASSERT_EQUAL_UINT16(expected.backoffHeartbeatMs[i], actual.backoffHeartbeatMs[i]);
+  }
+  TEST_ASSERT_EQUAL_UINT16(expected.wiringShortMaxMv, actual.wiringShortMaxMv);
+  TEST_ASSERT_EQUAL_UINT16(expected.wiringClosedMaxMv, actual.wiringClosedMaxMv);
+  TEST_ASSERT_EQUAL_UINT16(expected.wiringOpenMaxMv, actual.wiringOpenMaxMv);
+}
+
+static void test_encoding() {
+  uint8_t out[ModuleConfigCodec::ENCODED_SIZE];
+  ModuleConfigCodec::encode(config, out);
+  const uint8_t expected[] = {
+    0x01, 0xFF, 0x03, 0x32, 0x00, 0x90, 0x01, 0xC8, 0x00, 0x0A,
+    0xF4, 0x01, 0x90, 0x01, 0xF4, 0x01,
+    0x20, 0x03, 0xBC, 0x02, 0xE8, 0x03,
+    0xC8, 0x00, 0xB0, 0x04, 0x1C, 0x0C,
+  };
+  TEST_ASSERT_EQUAL_HEX8_ARRAY(expected, out, sizeof(expected));
+}
+
+static void test_round_trip_and_longer_blob() {
+  uint8_t blob[ModuleConfigCodec::ENCODED_SIZE + 4];
+  memset(blob, 0xA5, sizeof(blob));
+  ModuleConfigCodec::encode(config, blob);
+  ModuleConfig decoded = {};
+  TEST_ASSERT_TRUE(ModuleConfigCodec::decode(blob, sizeof(blob), decoded));
+  assertSameConfig(config, decoded);
+}
+
+static void test_short_or_other_version_is_rejected() {
+  uint8_t blob[ModuleConfigCodec::ENCODED_SIZE];
+  ModuleConfigCodec::encode(config, blob);
+  ModuleConfig decoded = {};
+  TEST_ASSERT_FALSE(ModuleConfigCodec::decode(blob, sizeof(blob) - 1, decoded));
+  blob[0] = ModuleConfigCodec::VERSION + 1;
+  TEST_ASSERT_FALSE(ModuleConfigCodec::decode(blob, sizeof(blob), decoded));
+}
+
+static void test_invalid_blob_leaves_config_untouched() {
+  uint8_t blob[ModuleConfigCodec::ENCODED_SIZE];
+  config.debounceMs = 0;
+  ModuleConfigCodec::encode(config, blob);
+  ModuleConfig untouched;
+  memset(&untouched, 0x5A, sizeof(untouched));
+  ModuleConfig decoded = untouched;
+  TEST_ASSERT_FALSE(ModuleConfigCodec::decode(blob, sizeof(blob), decoded));
+  TEST_ASSERT_EQUAL_MEMORY(&untouched, &decoded, sizeof(decoded));
+}
+
+static void test_ranges() {
+  TEST_ASSERT_TRUE(ModuleConfigCodec::valid(config));
+  ModuleConfig good = config;
+
+  config.enabledMask = 0x0400;
+  TEST_ASSERT_FALSE(ModuleConfigCodec::valid(config));
+  config = good;
+  config.debounceMs = 1001;
+  TEST_ASSERT_FALSE(ModuleConfigCodec::valid(config));
+  config = good;
+  config.glitchFilterNs = 801;
+  TEST_ASSERT_FALSE(ModuleConfigCodec::valid(config));
+  config = good;
+  config.heartbeatMs = 49;
+  TEST_ASSERT_FALSE(ModuleConfigCodec::valid(config));
+  config = good;
+  config.coalesceMs = 101;
+  TEST_ASSERT_FALSE(ModuleConfigCodec::valid(config));
+}
+
+static void test_backoff_steps() {
+  ModuleConfig good = config;
+  // Exit must sit below enter
+  config.backoffExitPermille[0] = 500;
+  TEST_ASSERT_FALSE(ModuleConfigCodec::valid(config));
+  // Thresholds ascend
+  config = good;
+  config.backoffEnterPermille[1] = 500;
+  TEST_ASSERT_FALSE(ModuleConfigCodec::valid(config));
+  // Intervals never shorten
+  config = good;
+  config.backoffHeartbeatMs[0] = 150;
+  TEST_ASSERT_FALSE(ModuleConfigCodec::valid(config));
+  config = good;
+  config.backoffHeartbeatMs[1] = 400;
+  TEST_ASSERT_FALSE(ModuleConfigCodec::valid(config));
+  config = good;
+  config.backoffEnterPermille[1] = 1001;
+  TEST_ASSERT_FALSE(ModuleConfigCodec::valid(config));
+}
+
+static void test_wiring_thresholds_ascend() {
+  ModuleConfig good = config;
+  config.wiringClosedMaxMv = config.wiringShortMaxMv;
+  TEST_ASSERT_FALSE(ModuleConfigCodec::valid(config));
+  config = good;
+  config.wiringOpenMaxMv = 3301;
+  TEST_ASSERT_FALSE(ModuleConfigCodec::valid(config));
+}
+
+static void test_defaults_and_heartbeat_steps() {
+  TEST_ASSERT_TRUE(ModuleConfigCodec::valid(DEFAULT_CONFIG));
+
+  HeartbeatStep steps[ModuleConfigCodec::HEARTBEAT_STEPS];
+  TEST_ASSERT_EQUAL_UINT8(3, ModuleConfigCodec::heartbeatSteps(config, steps));
+  TEST_ASSERT_EQUAL_UINT16(0, steps[0].enterPermille);
+  TEST_ASSERT_EQUAL_UINT32(200, steps[0].heartbeatMs);
+  TEST_ASSERT_EQUAL_UINT16(500, steps[1].enterPermille);
+  TEST_ASSERT_EQUAL_UINT16(400, steps[1].exitPermille);
+  TEST_ASSERT_EQUAL_UINT32(500, steps[1].heartbeatMs);
+  TEST_ASSERT_EQUAL_UINT16(800, steps[2].enterPermille);
+  TEST_ASSERT_EQUAL_UINT16(700, steps[2].exitPermille);
+  TEST_ASSERT_EQUAL_UINT32(1000, steps[2].heartbeatMs);
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_encoding);
+  RUN_TEST(test_round_trip_and_longer_blob);
+  RUN_TEST(test_short_or_other_version_is_rejected);
+  RUN_TEST(test_invalid_blob_leaves_config_untouched);
+  RUN_TEST(test_ranges);
+  RUN_TEST(test_backoff_steps);
+  RUN_TEST(test_wiring_thresholds_ascend);
+  RUN_TEST(test_defaults_and_heartbeat_steps);
+  return UNITY_END();
+}
@@ -0,0 +1,84 @@
+#include <unity.h>
+#include "ReedDebouncer.h"
+
+static const uint8_t CHANNELS = 3;
+static ReedChannelConfig config[CHANNELS];
+static ReedDebouncer debouncer;
+
+void setUp() {
+  config[0] = { true, 0, 50 };
+  config[1] = { true, 0, 20 };
+  config[2] = { false, 0, 50 };
+}
+
+void tearDown() {}
+
+static void test_begin_adopts_initial_state() {
+  debouncer.begin(config, CHANNELS, 0x0007, 1000);
+  // Disabled channels always read closed
+  TEST_ASSERT_EQUAL_HEX16(0x0003, debouncer.state());
+  TEST_ASSERT_EQUAL_HEX16(0x0003, debouncer.enabledMask());
+  TEST_ASSERT_FALSE(debouncer.settling());
+  TEST_ASSERT_EQUAL_UINT32(1000, debouncer.lastEdgeMs(1));
+}
+
+static void test_change_waits_for_debounce() {
+  debouncer.begin(config, CHANNELS, 0x0000, 0);
+  TEST_ASSERT_EQUAL_HEX16(0x0000, debouncer.update(0x0001, 100));
+  TEST_ASSERT_TRUE(debouncer.settling());
+  TEST_ASSERT_EQUAL_HEX16(0x0000, debouncer.update(0x0001, 149));
+  TEST_ASSERT_EQUAL_HEX16(0x0001, debouncer.update(0x0001, 150));
+  TEST_ASSERT_FALSE(debouncer.settling());
+}
+
+static void test_bounce_restarts_the_window() {
+  debouncer.begin(config, CHANNELS, 0x0000, 0);
+  debouncer.update(0x0001, 100);
+  debouncer.update(0x0000, 130);
+  debouncer.update(0x0001, 140);
+  TEST_ASSERT_EQUAL_UINT32(140, debouncer.lastEdgeMs(0));
+  TEST_ASSERT_EQUAL_HEX16(0x0000, debouncer.update(0x0001, 189));
+  TEST_ASSERT_EQUAL_HEX16(0x0001, debouncer.update(0x0001, 190));
+}
+
+static void test_short_pulse_is_ignored() {
+  debouncer.begin(config, CHANNELS, 0x0001, 0);
+  debouncer.update(0x0000, 100);
+  TEST_ASSERT_EQUAL_HEX16(0x0001, debouncer.update(0x0001, 110));
+  TEST_ASSERT_EQUAL_HEX16(0x0001, debouncer.update(0x0001, 500));
+  TEST_ASSERT_FALSE(debouncer.settling());
+}
+
+static void test_channels_debounce_independently() {
+  debouncer.begin(config, CHANNELS, 0x0000, 0);
+  debouncer.update(0x0003, 100);
+  TEST_ASSERT_EQUAL_HEX16(0x0002, debouncer.update(0x0003, 120));
+  TEST_ASSERT_EQUAL_HEX16(0x0003, debouncer.update(0x0003, 150));
+}
+
+static void test_disabled_channel_is_masked() {
+  debouncer.begin(config, CHANNELS, 0x0000, 0);
+  debouncer.update(0x0004, 100);
+  TEST_ASSERT_EQUAL_HEX16(0x0000, debouncer.update(0x0004, 1000));
+  TEST_ASSERT_EQUAL_HEX16(0x0000, debouncer.lastRaw());
+  TEST_ASSERT_FALSE(debouncer.settling());
+}
+
+static void test_millis_wraparound() {
+  debouncer.begin(config, CHANNELS, 0x0000, 0xFFFFFFF0);
+  debouncer.update(0x0001, 0xFFFFFFF0);
+  TEST_ASSERT_EQUAL_HEX16(0x0000, debouncer.update(0x0001, 0x00000020));
+  TEST_ASSERT_EQUAL_HEX16(0x0001, debouncer.update(0x0001, 0x00000022));
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_begin_adopts_initial_state);
+  RUN_TEST(test_change_waits_for_debounce);
+  RUN_TEST(test_bounce_restarts_the_window);
+  RUN_TEST(test_short_pulse_is_ignored);
+  RUN_TEST(test_channels_debounce_independently);
+  RUN_TEST(test_disabled_channel_is_masked);
+  RUN_TEST(test_millis_wraparound);
+  return UNITY_END();
+}
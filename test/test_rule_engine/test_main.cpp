@@ -0,0 +1,163 @@
+#include <unity.h>
+#include "RuleEngine.h"
+
+static RuleEngine engine;
+
+// Signal 0: bit 0 of byte 1 on 0x120; rule 0: RSW1 and RSW2 open;
+// rule 1: rule 0 held for 1000 ms; rule 2: any of RSW3-RSW4 open while
+// signal 0 is set
+static const uint8_t PROGRAM[] = {
+  RuleEngine::VERSION,
+  1, 0x20, 0x01, 1, 0x01,
+  3,
+  5, RuleEngine::OP_ALL_OPEN, 0x03, 0x00, RuleEngine::OP_NOT, RuleEngine::OP_NOT,
+  6, RuleEngine::OP_RULE, 0, RuleEngine::OP_HELD, 0, 0xE8, 0x03,
+  6, RuleEngine::OP_ANY_OPEN, 0x0C, 0x00, RuleEngine::OP_SIGNAL, 0, RuleEngine::OP_AND,
+};
+
+void setUp() {
+  engine.clear();
+}
+
+void tearDown() {}
+
+static void test_load_accepts_program() {
+  TEST_ASSERT_TRUE(engine.load(PROGRAM, sizeof(PROGRAM)));
+  TEST_ASSERT_EQUAL_HEX8(0x07, engine.ruleMask());
+  TEST_ASSERT_TRUE(RuleEngine::validate(PROGRAM, sizeof(PROGRAM)));
+}
+
+static void test_load_rejects_malformed_programs() {
+  // Each program below breaks this one in a single place
+  const uint8_t minimal[] = { 1, 0, 1, 2, RuleEngine::OP_CHANNEL, 0 };
+  TEST_ASSERT_TRUE(RuleEngine::validate(minimal, sizeof(minimal)));
+
+  const uint8_t badVersion[] = { 2, 0, 1, 2, RuleEngine::OP_CHANNEL, 0 };
+  const uint8_t trailingByte[] = { 1, 0, 1, 2, RuleEngine::OP_CHANNEL, 0, 0 };
+  const uint8_t channelRange[] = { 1, 0, 1, 2, RuleEngine::OP_CHANNEL, RuleEngine::MAX_CHANNELS };
+  const uint8_t unknownSignal[] = { 1, 0, 1, 2, RuleEngine::OP_SIGNAL, 0 };
+  const uint8_t forwardRule[] = { 1, 0, 1, 2, RuleEngine::OP_RULE, 0 };
+  const uint8_t emptyMask[] = { 1, 0, 1, 3, RuleEngine::OP_ANY_OPEN, 0, 0 };
+  const uint8_t underflow[] = { 1, 0, 1, 3, RuleEngine::OP_CHANNEL, 0, RuleEngine::OP_AND };
+  const uint8_t twoResults[] = { 1, 0, 1, 4, RuleEngine::OP_CHANNEL, 0, RuleEngine::OP_CHANNEL, 1 };
+  const uint8_t truncatedOperand[] = { 1, 0, 1, 1, RuleEngine::OP_CHANNEL };
+  const uint8_t unknownOp[] = { 1, 0, 1, 1, 0x7F };
+  const uint8_t extendedSignal[] = { 1, 1, 0x00, 0x08, 0, 1, 1, 2, RuleEngine::OP_SIGNAL, 0 };
+  const uint8_t sharedTimer[] = {
+    1, 0, 2,
+    6, RuleEngine::OP_CHANNEL, 0, RuleEngine::OP_HELD, 3, 10, 0,
+    6, RuleEngine::OP_CHANNEL, 1, RuleEngine::OP_HELD, 3, 10, 0,
+  };
+  const uint8_t* programs[] = {
+    badVersion, trailingByte, channelRange, unknownSignal, forwardRule, emptyMask,
+    underflow, twoResults, truncatedOperand, unknownOp, extendedSignal, sharedTimer,
+  };
+  const uint8_t lengths[] = {
+    sizeof(badVersion), sizeof(trailingByte), sizeof(channelRange), sizeof(unknownSignal),
+    sizeof(forwardRule), sizeof(emptyMask), sizeof(underflow), sizeof(twoResults),
+    sizeof(truncatedOperand), sizeof(unknownOp), sizeof(extendedSignal), sizeof(sharedTimer),
+  };
+  for (uint8_t i = 0; i < sizeof(lengths); i++) {
+    TEST_ASSERT_FALSE(RuleEngine::validate(programs[i], lengths[i]));
+  }
+}
+
+static void test_failed_load_keeps_current_program() {
+  TEST_ASSERT_TRUE(engine.load(PROGRAM, sizeof(PROGRAM)));
+  const uint8_t broken[] = { 1, 0, 1, 2, RuleEngine::OP_RULE, 0 };
+  TEST_ASSERT_FALSE(engine.load(broken, sizeof(broken)));
+  TEST_ASSERT_EQUAL_HEX8(0x07, engine.ruleMask());
+  engine.update(0x0003, 0);
+  TEST_ASSERT_EQUAL_HEX8(0x01, engine.results());
+}
+
+static void test_first_update_evaluates_everything() {
+  engine.load(PROGRAM, sizeof(PROGRAM));
+  TEST_ASSERT_FALSE(engine.update(0x0000, 0));
+  TEST_ASSERT_EQUAL(3, engine.evaluationCount());
+  TEST_ASSERT_TRUE(engine.update(0x0003, 10));
+  TEST_ASSERT_EQUAL_HEX8(0x01, engine.results());
+}
+
+static void test_update_only_reruns_dependent_rules() {
+  engine.load(PROGRAM, sizeof(PROGRAM));
+  engine.update(0x0000, 0);
+  uint32_t before = engine.evaluationCount();
+  // Nothing changed
+  TEST_ASSERT_FALSE(engine.update(0x0000, 5));
+  TEST_ASSERT_EQUAL(before, engine.evaluationCount());
+  // RSW5 is read by no rule
+  TEST_ASSERT_FALSE(engine.update(0x0010, 6));
+  TEST_ASSERT_EQUAL(before, engine.evaluationCount());
+  // RSW3 only feeds rule 2
+  engine.update(0x0014, 7);
+  TEST_ASSERT_EQUAL(before + 1, engine.evaluationCount());
+  // RSW1 feeds rule 0, whose result did not change, so rule 1 is skipped
+  engine.update(0x0015, 8);
+  TEST_ASSERT_EQUAL(before + 2, engine.evaluationCount());
+  TEST_ASSERT_EQUAL(5, engine.updateCount());
+}
+
+static void test_held_timer() {
+  engine.load(PROGRAM, sizeof(PROGRAM));
+  engine.update(0x0000, 0);
+  TEST_ASSERT_EQUAL_UINT32(UINT32_MAX, engine.msUntilDue(0));
+  engine.update(0x0003, 100);
+  TEST_ASSERT_EQUAL_HEX8(0x01, engine.results());
+  TEST_ASSERT_EQUAL_UINT32(600, engine.msUntilDue(500));
+  TEST_ASSERT_FALSE(engine.update(0x0003, 1099));
+  TEST_ASSERT_TRUE(engine.update(0x0003, 1100));
+  TEST_ASSERT_EQUAL_HEX8(0x03, engine.results());
+  TEST_ASSERT_EQUAL_UINT32(UINT32_MAX, engine.msUntilDue(1100));
+  // Dropping the input clears the hold at once and restarts it next time
+  TEST_ASSERT_TRUE(engine.update(0x0001, 1200));
+  TEST_ASSERT_EQUAL_HEX8(0x00, engine.results());
+  engine.update(0x0003, 1300);
+  TEST_ASSERT_EQUAL_UINT32(1000, engine.msUntilDue(1300));
+}
+
+static void test_signals_from_frames() {
+  engine.load(PROGRAM, sizeof(PROGRAM));
+  engine.update(0x0004, 0);
+  TEST_ASSERT_EQUAL_HEX8(0x00, engine.results());
+  const uint8_t set[] = { 0x00, 0x01 };
+  const uint8_t clear[] = { 0xFF, 0xFE };
+  // Wrong ID, or too short to carry the byte
+  TEST_ASSERT_FALSE(engine.onFrame(0x121, set, sizeof(set)));
+  TEST_ASSERT_FALSE(engine.onFrame(0x120, set, 1));
+  TEST_ASSERT_TRUE(engine.onFrame(0x120, set, sizeof(set)));
+  TEST_ASSERT_FALSE(engine.onFrame(0x120, set, sizeof(set)));
+  TEST_ASSERT_TRUE(engine.update(0x0004, 10));
+  TEST_ASSERT_EQUAL_HEX8(0x04, engine.results());
+  TEST_ASSERT_TRUE(engine.onFrame(0x120, clear, sizeof(clear)));
+  TEST_ASSERT_TRUE(engine.update(0x0004, 20));
+  TEST_ASSERT_EQUAL_HEX8(0x00, engine.results());
+}
+
+static void test_xor_and_or() {
+  const uint8_t program[] = {
+    1, 0, 2,
+    5, RuleEngine::OP_CHANNEL, 0, RuleEngine::OP_CHANNEL, 1, RuleEngine::OP_XOR,
+    5, RuleEngine::OP_CHANNEL, 2, RuleEngine::OP_CHANNEL, 3, RuleEngine::OP_OR,
+  };
+  TEST_ASSERT_TRUE(engine.load(program, sizeof(program)));
+  const uint16_t channels[] = { 0x0, 0x1, 0x2, 0x3, 0x4, 0x8, 0xC };
+  const uint8_t expected[] = { 0x0, 0x1, 0x1, 0x0, 0x2, 0x2, 0x2 };
+  for (uint8_t i = 0; i < sizeof(expected); i++) {
+    engine.update(channels[i], i);
+    TEST_ASSERT_EQUAL_HEX8(expected[i], engine.results());
+  }
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_load_accepts_program);
+  RUN_TEST(test_load_rejects_malformed_programs);
+  RUN_TEST(test_failed_load_keeps_current_program);
+  RUN_TEST(test_first_update_evaluates_everything);
+  RUN_TEST(test_update_only_reruns_dependent_rules);
+  RUN_TEST(test_held_timer);
+  RUN_TEST(test_signals_from_frames);
+  RUN_TEST(test_xor_and_or);
+  return UNITY_END();
+}
@@ -0,0 +1,102 @@
+#include <unity.h>
+#include "TxMailbox.h"
+
+static TxMailbox mailbox;
+
+static CanFrame frame(uint32_t id, uint8_t value) {
+  CanFrame result = {};
+  result.id = id;
+  result.dlc = 1;
+  result.data[0] = value;
+  return result;
+}
+
+void setUp() {
+  mailbox = TxMailbox();
+}
+
+void tearDown() {}
+
+static void test_lowest_id_first_one_at_a_time() {
+  CanFrame out;
+  TEST_ASSERT_FALSE(mailbox.next(0, out));
+  mailbox.post(frame(0x300, 1));
+  mailbox.post(frame(0x100, 2));
+  TEST_ASSERT_TRUE(mailbox.busy());
+  TEST_ASSERT_TRUE(mailbox.next(0, out));
+  TEST_ASSERT_EQUAL_HEX32(0x100, out.id);
+  TEST_ASSERT_FALSE(mailbox.next(1, out));
+  mailbox.transmitted(true);
+  TEST_ASSERT_TRUE(mailbox.next(2, out));
+  TEST_ASSERT_EQUAL_HEX32(0x300, out.id);
+  mailbox.transmitted(true);
+  TEST_ASSERT_FALSE(mailbox.busy());
+}
+
+static void test_newer_value_replaces_unsent() {
+  mailbox.post(frame(0x100, 1));
+  mailbox.post(frame(0x100, 2));
+  TEST_ASSERT_EQUAL_UINT32(1, mailbox.replacedCount());
+  CanFrame out;
+  TEST_ASSERT_TRUE(mailbox.next(0, out));
+  TEST_ASSERT_EQUAL_HEX8(2, out.data[0]);
+  mailbox.transmitted(true);
+  TEST_ASSERT_FALSE(mailbox.next(1, out));
+}
+
+static void test_failed_frame_is_retried_unless_superseded() {
+  CanFrame out;
+  mailbox.post(frame(0x100, 1));
+  mailbox.next(0, out);
+  mailbox.transmitted(false);
+  TEST_ASSERT_TRUE(mailbox.next(1, out));
+  TEST_ASSERT_EQUAL_HEX8(1, out.data[0]);
+
+  mailbox.post(frame(0x100, 2));
+  mailbox.transmitted(false);
+  TEST_ASSERT_TRUE(mailbox.next(2, out));
+  TEST_ASSERT_EQUAL_HEX8(2, out.data[0]);
+  // Posting while in flight does not count as replacing a pending frame
+  TEST_ASSERT_EQUAL_UINT32(0, mailbox.replacedCount());
+}
+
+static void test_slots_are_limited() {
+  for (uint8_t i = 0; i < TxMailbox::MAX_SLOTS; i++) {
+    TEST_ASSERT_TRUE(mailbox.post(frame(0x100 + i, i)));
+  }
+  TEST_ASSERT_FALSE(mailbox.post(frame(0x200, 0)));
+  TEST_ASSERT_TRUE(mailbox.post(frame(0x100, 9)));
+}
+
+static void test_in_flight_timeout() {
+  CanFrame out;
+  mailbox.post(frame(0x100, 1));
+  mailbox.next(1000, out);
+  TEST_ASSERT_FALSE(mailbox.overdue(1000 + TxMailbox::IN_FLIGHT_TIMEOUT_MS - 1));
+  TEST_ASSERT_TRUE(mailbox.overdue(1000 + TxMailbox::IN_FLIGHT_TIMEOUT_MS));
+  TEST_ASSERT_FALSE(mailbox.next(1000 + TxMailbox::IN_FLIGHT_TIMEOUT_MS - 1, out));
+  // The lost frame goes out again
+  TEST_ASSERT_TRUE(mailbox.next(1000 + TxMailbox::IN_FLIGHT_TIMEOUT_MS, out));
+  TEST_ASSERT_EQUAL_HEX32(0x100, out.id);
+  TEST_ASSERT_EQUAL_UINT32(1, mailbox.timeoutCount());
+}
+
+static void test_late_completion_after_timeout_is_ignored() {
+  CanFrame out;
+  mailbox.post(frame(0x100, 1));
+  mailbox.next(0, out);
+  mailbox.transmitted(true);
+  mailbox.transmitted(false);
+  TEST_ASSERT_FALSE(mailbox.busy());
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_lowest_id_first_one_at_a_time);
+  RUN_TEST(test_newer_value_replaces_unsent);
+  RUN_TEST(test_failed_frame_is_retried_unless_superseded);
+  RUN_TEST(test_slots_are_limited);
+  RUN_TEST(test_in_flight_timeout);
+  RUN_TEST(test_late_completion_after_timeout_is_ignored);
+  return UNITY_END();
+}
@@ -0,0 +1,112 @@
+#!/usr/bin/env python3
+"""Authenticated control frames for Cabinet & Door Sensor modules.
+
+Control frames are followed by an AUTH frame (ID 0x02) carrying a freshness
+counter and a truncated HMAC-SHA256 over the counter and the frames. The key
+is the same 64-hex-character value the firmware was built with
+(TRAILCURRENT_CAN_AUTH_KEY). The sender counter is kept in a state file so
+it only ever increases.
+
+    export TRAILCURRENT_CAN_AUTH_KEY=...
+    python3 tools/can_auth.py --iface can0 ota-trigger A1B2C3
+    python3 tools/can_auth.py --iface can0 wifi MySSID MyPassword
+"""
+
+import argparse
+import hashlib
+import hmac
+import os
+import struct
+import sys
+
+import can_id_plan
+
+PLAN = can_id_plan.ids()
+AUTH_ID = PLAN["AUTH"]
+OTA_TRIGGER_ID = PLAN["OTA_TRIGGER"]
+WIFI_CONFIG_ID = PLAN["WIFI_CONFIG"]
+MAC_BYTES = 4
+DEFAULT_STATE = os.path.expanduser("~/.trailcurrent_can_counter")
+
+
+class Authenticator:
+    def __init__(self, key_hex, state_file=DEFAULT_STATE):
+        key = bytes.fromhex(key_hex)
+        if len(key) != 32:
+            raise ValueError("auth key must be 64 hex characters")
+        self.key = key
+        self.state_file = state_file
+        self.held = {}
+
+    def record(self, can_id, data):
+        """Remember a control frame that the next AUTH for can_id must cover."""
+        self.held.setdefault(can_id, []).append(bytes(data))
+
+    def _next_counter(self):
+        try:
+            counter = int(open(self.state_file).read().strip()) + 1
+        except (OSError, ValueError):
+            counter = 1
+        with open(self.state_file, "w") as f:
+            f.write(str(counter))
+        return counter
+
+    def auth_frame(self, can_id):
+        """Build the AUTH frame covering every frame recorded on can_id."""
+        counter = self._next_counter()
+        message = struct.pack("<HI", can_id, counter)
+        for data in self.held.pop(can_id, []):
+            message += struct.pack("<HB", can_id, len(data)) + data
+        mac = hmac.new(self.key, message, hashlib.sha256).digest()[:MAC_BYTES]
+        return list(struct.pack("<HH", can_id, counter & 0xFFFF) + mac)
+
+
+def from_environment():
+    key = os.environ.get("TRAILCURRENT_CAN_AUTH_KEY", "")
+    return Authenticator(key) if key else None
+
+
+def main():
+    from can_ota_send import Bus
+
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("--iface", default="can0", help="SocketCAN interface")
+    sub = parser.add_subparsers(dest="command", required=True)
+    trigger = sub.add_parser("ota-trigger", help="start WiFi OTA on one module")
+    trigger.add_argument("mac_suffix", help="last 3 MAC bytes as hex, e.g. A1B2C3")
+    wifi = sub.add_parser("wifi", help="store WiFi credentials for OTA")
+    wifi.add_argument("ssid")
+    wifi.add_argument("password")
+    args = parser.parse_args()
+
+    auth = from_environment()
+    if auth is None:
+        sys.exit("error: TRAILCURRENT_CAN_AUTH_KEY is not set")
+    bus = Bus(args.iface)
+
+    def send(can_id, data):
+        auth.record(can_id, data)
+        bus.send(can_id, data)
+
+    if args.command == "ota-trigger":
+        send(OTA_TRIGGER_ID, list(bytes.fromhex(args.mac_suffix)))
+        bus.send(AUTH_ID, auth.auth_frame(OTA_TRIGGER_ID))
+    else:
+        ssid = args.ssid.encode()
+        password = args.password.encode()
+        if len(ssid) > 32 or len(password) > 63:
+            sys.exit("error: SSID max 32 bytes, password max 63 bytes")
+        send(WIFI_CONFIG_ID, [0x01, len(ssid), len(password)])
+        for msg_type, value in ((0x02, ssid), (0x03, password)):
+            for seq, offset in enumerate(range(0, len(value), 6)):
+                send(WIFI_CONFIG_ID, [msg_type, seq] + list(value[offset:offset + 6]))
+        checksum = 0
+        for byte in ssid + password:
+            checksum ^= byte
+        send(WIFI_CONFIG_ID, [0x04, checksum])
+        bus.send(AUTH_ID, auth.auth_frame(WIFI_CONFIG_ID))
+    print("sent")
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,281 @@
+#!/usr/bin/env python3
+"""Control the bus sniffer of a Cabinet & Door Sensor module and fetch captures.
+
+The module records every frame it receives into its spiffs partition (see
+include/BusCapture.h). `start` and `stop` control capture on any set of
+modules, `status` shows session, sectors used and frames dropped, and
+`download` reads the ring sector by sector over CAN (stop capture first) and
+writes the newest session in candump -L format. tools/can_latency.py and the
+can-utils tools read that format directly. `decode` turns a saved raw image
+into the same log offline. If TRAILCURRENT_CAN_AUTH_KEY is set, START is
+authenticated.
+
+    python3 tools/can_capture.py start --iface can0 --address 3
+    python3 tools/can_capture.py status --iface can0 --address 3
+    python3 tools/can_capture.py stop --iface can0 --address 3
+    python3 tools/can_capture.py download --iface can0 --address 3 -o coach.log --raw coach.bin
+    python3 tools/can_capture.py decode coach.bin -o coach.log --all-sessions
+"""
+
+import argparse
+import binascii
+import struct
+import sys
+
+import can_auth
+import can_id_plan
+from can_ota_send import Bus
+
+PLAN = can_id_plan.ids()
+CMD_ID = PLAN["CAPTURE_COMMAND"]
+REPLY_BASE_ID = PLAN["CAPTURE_REPLY"]
+
+CMD_START = 0x01
+CMD_STOP = 0x02
+CMD_STATUS = 0x03
+CMD_READ = 0x04
+STATUS_STATUS = 0x81
+STATUS_END = 0x83
+STATUS_ERROR = 0x8F
+
+ERRORS = {
+    0x01: "no spiffs partition",
+    0x02: "capture running - stop it first",
+    0x03: "sector or segment out of range",
+    0x04: "flash read failed",
+}
+
+SECTOR_SIZE = 4096
+SEGMENT_SIZE = 512
+FRAME_PAYLOAD = 7
+PARTITION_SIZE = 0x89000
+
+MAGIC = 0x31504143
+HEADER = struct.Struct("<IIHHq")
+FLAG_SESSION_START = 0x0001
+MARKER_DROPPED = 0x01
+MARKER_END = 0x3F
+
+
+def varint(data, pos):
+    value, shift = 0, 0
+    while True:
+        byte = data[pos]
+        pos += 1
+        value |= (byte & 0x7F) << shift
+        shift += 7
+        if byte < 0x80:
+            return value, pos
+
+
+def decode_sector(data):
+    """Return (header dict, [(time_us, id, extended, rtr, data) or ("dropped", n)])."""
+    if len(data) < HEADER.size:
+        return None, []
+    magic, sequence, session, flags, base_us = HEADER.unpack_from(data)
+    if magic != MAGIC:
+        return None, []
+    header = {"sequence": sequence, "session": session, "flags": flags, "base_us": base_us}
+    dictionary, last_data, records = [], {}, []
+    time_us, pos = base_us, HEADER.size
+    try:
+        while pos < len(data) and data[pos] != 0xFF:
+            tag = data[pos]
+            pos += 1
+            if tag >> 6 == 3:
+                value, pos = varint(data, pos)
+                if tag & 0x3F == MARKER_DROPPED:
+                    records.append(("dropped", value))
+                continue
+            entry, extended = None, False
+            if tag < 0x40:
+                entry = tag
+                can_id = dictionary[entry]
+            elif tag == 0x40:
+                can_id = data[pos] | (data[pos + 1] << 8)
+                pos += 2
+                if len(dictionary) < 64:
+                    entry = len(dictionary)
+                    dictionary.append(can_id)
+            elif tag == 0x41:
+                can_id = struct.unpack_from("<I", data, pos)[0]
+                pos += 4
+                extended = True
+            else:
+                break  # Unknown record - the rest of this sector is unreadable
+            dlc_byte = data[pos]
+            pos += 1
+            dlc, repeat, rtr = dlc_byte & 0x0F, bool(dlc_byte & 0x10), bool(dlc_byte & 0x20)
+            delta, pos = varint(data, pos)
+            time_us += delta
+            if repeat:
+                payload = last_data[entry]
+            elif rtr:
+                payload = b""
+            else:
+                payload = bytes(data[pos:pos + dlc])
+                pos += dlc
+            if entry is not None and not rtr:
+                last_data[entry] = payload
+            records.append((time_us, can_id, extended, rtr, payload))
+    except (IndexError, KeyError, struct.error):
+        pass  # Torn tail (power loss mid-write) - keep what decoded
+    header["used"] = pos
+    return header, records
+
+
+def decode_image(image, all_sessions=False):
+    """Decode sectors in sequence order; newest session only unless all_sessions."""
+    sectors = []
+    for offset in range(0, len(image) - SECTOR_SIZE + 1, SECTOR_SIZE):
+        header, records = decode_sector(image[offset:offset + SECTOR_SIZE])
+        if header:
+            sectors.append((header, records))
+    sectors.sort(key=lambda s: s[0]["sequence"])
+    if sectors and not all_sessions:
+        newest = sectors[-1][0]["session"]
+        sectors = [s for s in sectors if s[0]["session"] == newest]
+    return sectors
+
+
+def write_log(sectors, out, iface):
+    frames = dropped = 0
+    for header, records in sectors:
+        if header["flags"] & FLAG_SESSION_START:
+            out.write(f"# session {header['session']}\n")
+        for record in records:
+            if record[0] == "dropped":
+                dropped += record[1]
+                out.write(f"# {record[1]} frame(s) dropped\n")
+                continue
+            time_us, can_id, extended, rtr, payload = record
+            frame_id = f"{can_id:08X}" if extended else f"{can_id:03X}"
+            body = "R" if rtr else payload.hex().upper()
+            out.write(f"({time_us // 1000000}.{time_us % 1000000:06d}) {iface} {frame_id}#{body}\n")
+            frames += 1
+    return frames, dropped
+
+
+class Link:
+    def __init__(self, bus, address, timeout, auth=None):
+        self.bus = bus
+        self.address = address
+        self.reply_id = REPLY_BASE_ID + address
+        self.timeout = timeout
+        self.auth = auth
+
+    def command(self, opcode, args=()):
+        data = [1 << self.address, opcode] + list(args)
+        self.bus.send(CMD_ID, data)
+        if self.auth and opcode == CMD_START:
+            self.auth.record(CMD_ID, data)
+            self.bus.send(can_auth.AUTH_ID, self.auth.auth_frame(CMD_ID))
+
+    def reply(self, expected):
+        fid, data = self.bus.recv({self.reply_id}, self.timeout)
+        if data is None:
+            sys.exit(f"error: module {self.address}: no response")
+        if data[0] == STATUS_ERROR:
+            sys.exit(f"error: module {self.address}: {ERRORS.get(data[1], hex(data[1]))}")
+        if data[0] != expected:
+            sys.exit(f"error: module {self.address}: unexpected reply {bytes(data).hex()}")
+        return data
+
+    def status(self):
+        self.command(CMD_STATUS)
+        data = self.reply(STATUS_STATUS)
+        return {"active": bool(data[1]), "session": data[2] | (data[3] << 8),
+                "sectors": data[4], "dropped": data[5] | (data[6] << 8) | (data[7] << 16)}
+
+    def read_segment(self, sector, segment, retries=3):
+        """Return the segment bytes, or None if it is erased."""
+        for _ in range(retries):
+            self.command(CMD_READ, [sector, segment])
+            buffer = bytearray(b"\xFF" * SEGMENT_SIZE)
+            while True:
+                fid, data = self.bus.recv({self.reply_id}, self.timeout)
+                if data is None:
+                    break
+                if data[0] < 0x80:
+                    pos = data[0] * FRAME_PAYLOAD
+                    chunk = bytes(data[1:])[:SEGMENT_SIZE - pos]
+                    buffer[pos:pos + len(chunk)] = chunk
+                    continue
+                if data[0] == STATUS_ERROR:
+                    sys.exit(f"error: module {self.address}: {ERRORS.get(data[1], hex(data[1]))}")
+                if data[0] == STATUS_END and data[1] == sector and data[2] == segment:
+                    if data[5]:
+                        return None
+                    crc = data[3] | (data[4] << 8)
+                    if binascii.crc_hqx(bytes(buffer), 0xFFFF) == crc:
+                        return bytes(buffer)
+                    break
+        sys.exit(f"error: module {self.address}: sector {sector} segment {segment} failed")
+
+    def download(self, sectors):
+        image = bytearray(b"\xFF" * (sectors * SECTOR_SIZE))
+        for sector in range(sectors):
+            for segment in range(SECTOR_SIZE // SEGMENT_SIZE):
+                data = self.read_segment(sector, segment)
+                if data is None:
+                    break  # Rest of the sector is erased too
+                offset = sector * SECTOR_SIZE + segment * SEGMENT_SIZE
+                image[offset:offset + SEGMENT_SIZE] = data
+            print(f"\rsector {sector + 1}/{sectors}", end="", file=sys.stderr, flush=True)
+        print(file=sys.stderr)
+        return bytes(image)
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__,
+                                     formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("action", choices=["start", "stop", "status", "download", "decode"])
+    parser.add_argument("image", nargs="?", help="decode: raw capture image")
+    parser.add_argument("--iface", default="can0", help="SocketCAN interface")
+    parser.add_argument("--address", type=int, nargs="+", default=[0],
+                        help="DIP address(es); download uses the first")
+    parser.add_argument("-o", "--output", help="candump -L log to write (default stdout)")
+    parser.add_argument("--raw", help="download: also save the raw image")
+    parser.add_argument("--all-sessions", action="store_true",
+                        help="decode every session on flash, not just the newest")
+    parser.add_argument("--log-iface", default="can0", help="interface name in the log")
+    parser.add_argument("--timeout-ms", type=float, default=500.0)
+    args = parser.parse_args()
+
+    if args.action == "decode":
+        if not args.image:
+            parser.error("decode needs a raw capture image")
+        image = open(args.image, "rb").read()
+    else:
+        bus = Bus(args.iface)
+        auth = can_auth.from_environment()
+        links = [Link(bus, a, args.timeout_ms / 1000, auth) for a in sorted(set(args.address))]
+        if args.action in ("start", "stop"):
+            for link in links:
+                link.command(CMD_START if args.action == "start" else CMD_STOP)
+        if args.action != "download":
+            for link in links:
+                state = link.status()
+                print(f"module {link.address}: {'capturing' if state['active'] else 'stopped'}, "
+                      f"session {state['session']}, {state['sectors']} sector(s), "
+                      f"{state['dropped']} dropped")
+            return
+        if links[0].status()["active"]:
+            sys.exit("error: capture running - stop it first")
+        image = links[0].download(PARTITION_SIZE // SECTOR_SIZE)
+        if args.raw:
+            with open(args.raw, "wb") as f:
+                f.write(image)
+
+    sectors = decode_image(image, args.all_sessions)
+    out = open(args.output, "w") if args.output else sys.stdout
+    frames, dropped = write_log(sectors, out, args.log_iface)
+    if args.output:
+        out.close()
+    used = sum(header["used"] for header, _ in sectors)
+    print(f"{frames} frame(s) from {len(sectors)} sector(s), {dropped} dropped"
+          f"{f', {used / frames:.1f} bytes/frame on flash' if frames else ''}", file=sys.stderr)
+
+
+if __name__ == "__main__":
+    main()
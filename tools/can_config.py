@@ -0,0 +1,230 @@
+#!/usr/bin/env python3
+"""Push one configuration to many Cabinet & Door Sensor modules and verify it.
+
+The configuration (channel enables, debounce, glitch filter, heartbeat and
+back-off steps, coalescing window, wiring alarm thresholds) is encoded as the
+versioned ModuleConfig blob, multicast once on 0x602/0x603 and committed
+after its full SHA-256 in HASH segments. Every targeted module stores and
+applies it atomically and acknowledges with the first 4 bytes of that hash on
+0x630 + dip; modules that report an error are retried. `verify` reads back the
+active hash of every module in one QUERY round. If TRAILCURRENT_CAN_AUTH_KEY
+is set, HASH and COMMIT are authenticated.
+
+Settings not given in the JSON file or with --set keep the firmware defaults.
+
+    python3 tools/can_config.py show --set debounce_ms=30
+    python3 tools/can_config.py push --iface can0 --address 0 1 2 3 site.json
+    python3 tools/can_config.py verify --iface can0 --address 0 1 2 3 --expect site.json
+"""
+
+import argparse
+import hashlib
+import json
+import struct
+import sys
+import time
+
+import can_auth
+import can_id_plan
+from can_ota_send import Bus
+
+PLAN = can_id_plan.ids()
+CMD_ID = PLAN["CONFIG_COMMAND"]
+DATA_ID = PLAN["CONFIG_DATA"]
+STATUS_BASE_ID = PLAN["CONFIG_STATUS"]
+FRAME_PAYLOAD = 7
+
+VERSION = 1
+KIND_CONFIG = 0
+CMD_BEGIN = 0x01
+CMD_COMMIT = 0x02
+CMD_QUERY = 0x03
+CMD_HASH = 0x04
+STATUS_APPLIED = 0x81
+STATUS_HASH = 0x82
+STATUS_ERROR = 0x8F
+
+ERRORS = {
+    0x01: "COMMIT without BEGIN or full hash",
+    0x02: "data frames missing",
+    0x03: "hash mismatch",
+    0x04: "invalid configuration",
+    0x05: "NVS write failed",
+    0x06: "unsupported version",
+}
+
+# Firmware defaults (DEFAULT_CONFIG in src/ModuleConfig.cpp)
+DEFAULTS = {
+    "enabled_mask": 0x03FF,
+    "debounce_ms": 50,
+    "glitch_filter_ns": 800,
+    "heartbeat_ms": 200,
+    "coalesce_ms": 10,
+    "backoff": [[600, 500, 500], [800, 700, 1000]],  # enter, exit permille, heartbeat ms
+    "wiring_short_max_mv": 70,
+    "wiring_closed_max_mv": 1000,
+    "wiring_open_max_mv": 3000,
+}
+
+
+def encode(config):
+    """ModuleConfig v1 blob, see include/ModuleConfig.h."""
+    blob = struct.pack("<BHHHHB", VERSION, config["enabled_mask"], config["debounce_ms"],
+                       config["glitch_filter_ns"], config["heartbeat_ms"],
+                       config["coalesce_ms"])
+    for step in config["backoff"]:
+        blob += struct.pack("<HHH", *step)
+    blob += struct.pack("<HHH", config["wiring_short_max_mv"],
+                        config["wiring_closed_max_mv"], config["wiring_open_max_mv"])
+    return blob
+
+
+def config_hash(blob):
+    """First 4 bytes of the SHA-256, as the modules report it."""
+    return hashlib.sha256(blob).digest()[:4]
+
+
+def load_config(path, overrides):
+    config = json.loads(json.dumps(DEFAULTS))
+    if path:
+        with open(path) as f:
+            settings = json.load(f)
+        unknown = set(settings) - set(DEFAULTS)
+        if unknown:
+            sys.exit(f"error: unknown settings {sorted(unknown)}")
+        config.update(settings)
+    for item in overrides:
+        key, _, value = item.partition("=")
+        if key not in DEFAULTS or key == "backoff":
+            sys.exit(f"error: --set {key}: not a scalar setting")
+        config[key] = int(value, 0)
+    if len(config["backoff"]) != 2:
+        sys.exit("error: backoff needs exactly two [enter, exit, heartbeat_ms] steps")
+    return config
+
+
+def describe(reply):
+    if reply[0] == STATUS_ERROR:
+        return ERRORS.get(reply[1], f"error 0x{reply[1]:02X}")
+    return f"unexpected status 0x{reply[0]:02X}"
+
+
+def collect(bus, addresses, expected, timeout):
+    """Return ({address: reply} for `expected`, {address: error text})."""
+    waiting = set(addresses)
+    replies, errors = {}, {}
+    deadline = time.monotonic() + timeout
+    while waiting:
+        fid, reply = bus.recv({STATUS_BASE_ID + a for a in waiting}, deadline - time.monotonic())
+        if reply is None:
+            break
+        address = fid - STATUS_BASE_ID
+        if reply[0] == expected:
+            replies[address] = reply
+        else:
+            errors[address] = describe(reply)
+        waiting.discard(address)
+    for address in waiting:
+        errors[address] = "no response"
+    return replies, errors
+
+
+def push(bus, blob, addresses, auth, timeout, kind=KIND_CONFIG, version=VERSION):
+    """One multicast round; returns ({address: acked hash}, {address: error})."""
+    mask = sum(1 << a for a in addresses)
+    bus.send(CMD_ID, [mask, CMD_BEGIN, len(blob), version, kind])
+    for index in range(0, (len(blob) + FRAME_PAYLOAD - 1) // FRAME_PAYLOAD):
+        bus.send(DATA_ID, [index] + list(blob[index * FRAME_PAYLOAD:(index + 1) * FRAME_PAYLOAD]))
+    digest = hashlib.sha256(blob).digest()
+    commands = [[mask, CMD_HASH, offset] + list(digest[offset:offset + 5])
+                for offset in range(0, len(digest), 5)]
+    commands.append([mask, CMD_COMMIT])
+    for command in commands:
+        if auth:
+            auth.record(CMD_ID, command)
+        bus.send(CMD_ID, command)
+    if auth:
+        bus.send(can_auth.AUTH_ID, auth.auth_frame(CMD_ID))
+    replies, errors = collect(bus, addresses, STATUS_APPLIED, timeout)
+    return {a: bytes(r[1:5]) for a, r in replies.items()}, errors
+
+
+def query(bus, addresses, timeout, kind=KIND_CONFIG):
+    """Returns ({address: (hash, version, stored)}, {address: error})."""
+    mask = sum(1 << a for a in addresses)
+    bus.send(CMD_ID, [mask, CMD_QUERY, kind])
+    replies, errors = collect(bus, addresses, STATUS_HASH, timeout)
+    return {a: (bytes(r[1:5]), r[5], bool(r[6])) for a, r in replies.items()}, errors
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__,
+                                     formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("action", choices=["show", "push", "verify"])
+    parser.add_argument("config", nargs="?", help="JSON file with settings to change")
+    parser.add_argument("--set", action="append", default=[], metavar="KEY=VALUE",
+                        help="override one scalar setting")
+    parser.add_argument("--iface", default="can0", help="SocketCAN interface")
+    parser.add_argument("--address", type=int, nargs="+", default=list(range(8)),
+                        help="DIP addresses to target (default all)")
+    parser.add_argument("--expect", metavar="JSON",
+                        help="verify: configuration every module should run")
+    parser.add_argument("--retries", type=int, default=3)
+    parser.add_argument("--timeout-ms", type=float, default=200.0,
+                        help="how long to wait for replies (default 200)")
+    args = parser.parse_args()
+
+    config = load_config(args.expect if args.action == "verify" else args.config, args.set)
+    blob = encode(config)
+    expected = config_hash(blob)
+    addresses = sorted(set(args.address))
+    timeout = args.timeout_ms / 1000
+
+    if args.action == "show":
+        print(json.dumps(config, indent=2))
+        print(f"blob {blob.hex()} ({len(blob)} bytes), hash {expected.hex()}")
+        return
+
+    bus = Bus(args.iface)
+    if args.action == "push":
+        auth = can_auth.from_environment()
+        pending = addresses
+        for attempt in range(1 + args.retries):
+            acked, errors = push(bus, blob, pending, auth, timeout)
+            for address, acked_hash in sorted(acked.items()):
+                state = "ok" if acked_hash == expected else f"acked {acked_hash.hex()}"
+                print(f"module {address}: applied {expected.hex()} {state}")
+            pending = sorted(errors)
+            if not pending:
+                break
+            for address in pending:
+                print(f"module {address}: {errors[address]}"
+                      f"{' - retrying' if attempt < args.retries else ''}")
+
+    # After a push, read back from the whole target set, not just the modules
+    # that acked
+    check = args.action == "push" or args.expect is not None
+    states, errors = query(bus, addresses, timeout)
+    mismatched = 0
+    for address in addresses:
+        if address in errors:
+            print(f"module {address}: {errors[address]}")
+            mismatched += 1
+            continue
+        active, version, stored = states[address]
+        matches = active == expected
+        mismatched += check and not matches
+        print(f"module {address}: v{version} {active.hex()} "
+              f"{'stored' if stored else 'defaults'}"
+              f"{(' ok' if matches else ' MISMATCH') if check else ''}")
+    if not check:
+        hashes = {states[a][0] for a in states}
+        print(f"{len(states)} module(s), {len(hashes)} distinct configuration(s)")
+    elif mismatched:
+        sys.exit(f"error: {mismatched} module(s) not running {expected.hex()}")
+    else:
+        print(f"all {len(addresses)} module(s) running {expected.hex()}")
+
+
+if __name__ == "__main__":
+    main()
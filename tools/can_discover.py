@@ -0,0 +1,98 @@
+#!/usr/bin/env python3
+"""Inventory every Cabinet & Door Sensor module on the bus.
+
+Broadcasts one DISCOVER request (ID 0x005, [nonce]) and collects the three
+reply frames each module sends on 0x620 + dip in its DIP time slot. Prints
+the hostname, firmware build ID (first 4 bytes of the ELF SHA-256), uptime,
+enabled reed channels, control frame authentication state (slowest MAC check
+in us, rejected AUTH frames, '!' while locked out) and the reply time of
+every module.
+
+    python3 tools/can_discover.py --iface can0
+"""
+
+import argparse
+import os
+import struct
+import time
+
+import can_id_plan
+from can_ota_send import Bus
+
+PLAN = can_id_plan.ids()
+DISCOVER_ID = PLAN["DISCOVER"]
+REPLY_BASE_ID = PLAN["DISCOVERY_REPLY"]
+MODULES = 8
+REPLY_IDENTITY = 0x01
+REPLY_STATUS = 0x02
+REPLY_AUTH = 0x03
+AUTH_ENABLED = 0x01
+AUTH_LOCKED_OUT = 0x02
+
+
+def discover(bus, timeout):
+    """Return {dip: info dict} for every module that answered."""
+    nonce = os.urandom(1)[0]
+    reply_ids = set(range(REPLY_BASE_ID, REPLY_BASE_ID + MODULES))
+    modules = {}
+    start = time.monotonic()
+    bus.send(DISCOVER_ID, [nonce])
+    while True:
+        remaining = timeout - (time.monotonic() - start)
+        if remaining <= 0:
+            break
+        fid, data = bus.recv(reply_ids, remaining)
+        if fid is None:
+            break
+        if len(data) < 8:
+            continue
+        info = modules.setdefault(fid - REPLY_BASE_ID, {})
+        if data[0] == REPLY_IDENTITY:
+            # Same formatting as the firmware's esp32c6-%X%X%X hostname
+            info["hostname"] = "esp32c6-%X%X%X" % (data[1], data[2], data[3])
+            info["build"] = data[4:8].hex()
+        elif data[0] == REPLY_STATUS and data[1] == nonce:
+            uptime, enabled = struct.unpack_from("<IH", data, 2)
+            info["uptime"] = uptime
+            info["enabled"] = enabled
+            info["reply_ms"] = (time.monotonic() - start) * 1000
+        elif data[0] == REPLY_AUTH and data[1] == nonce:
+            verify_us, rejected, flags = struct.unpack_from("<HHB", data, 2)
+            if not flags & AUTH_ENABLED:
+                info["auth"] = "off"
+            else:
+                locked = "!" if flags & AUTH_LOCKED_OUT else ""
+                info["auth"] = f"{verify_us}us/{rejected}{locked}"
+    return {dip: info for dip, info in modules.items() if "reply_ms" in info}
+
+
+def format_uptime(seconds):
+    days, rest = divmod(seconds, 86400)
+    return f"{days}d {rest // 3600:02d}:{rest % 3600 // 60:02d}:{rest % 60:02d}"
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__,
+                                     formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("--iface", default="can0")
+    parser.add_argument("--timeout-ms", type=float, default=50.0,
+                        help="how long to collect replies (default 50)")
+    args = parser.parse_args()
+
+    modules = discover(Bus(args.iface), args.timeout_ms / 1000)
+    if not modules:
+        print("no modules answered")
+        return
+    print(f"{'dip':<4} {'hostname':<16} {'build':<9} {'uptime':<14} {'enabled':<11} "
+          f"{'auth':<13} {'reply_ms':>8}")
+    for dip in sorted(modules):
+        info = modules[dip]
+        enabled = format(info["enabled"], "010b")[::-1]  # RSW01 first
+        print(f"{dip:<4} {info.get('hostname', '?'):<16} {info.get('build', '?'):<9} "
+              f"{format_uptime(info['uptime']):<14} {enabled:<11} {info.get('auth', '?'):<13} "
+              f"{info['reply_ms']:>8.1f}")
+    print(f"{len(modules)} module(s)")
+
+
+if __name__ == "__main__":
+    main()
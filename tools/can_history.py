@@ -0,0 +1,179 @@
+#!/usr/bin/env python3
+"""Read the door event history of Cabinet & Door Sensor modules over CAN.
+
+Each module keeps its most recent confirmed door changes in a RAM ring of
+self-contained 128-byte blocks (see include/EventLog.h). `status` shows how
+much of the ring is in use; `dump` downloads the used blocks and prints the
+changes oldest first, with bus time in seconds. `--since` skips blocks whose
+checkpoint is older than the given bus time, so a periodic collector only
+fetches what is new.
+
+    python3 tools/can_history.py status --iface can0 --address 0 1 2
+    python3 tools/can_history.py dump --iface can0 --address 3
+    python3 tools/can_history.py dump --iface can0 --address 3 --since 5120.5 --csv
+"""
+
+import argparse
+import binascii
+import struct
+import sys
+
+import can_id_plan
+from can_ota_send import Bus
+
+PLAN = can_id_plan.ids()
+CMD_ID = PLAN["HISTORY_COMMAND"]
+REPLY_BASE_ID = PLAN["HISTORY_REPLY"]
+
+CMD_STATUS = 0x01
+CMD_READ = 0x02
+STATUS_STATUS = 0x81
+STATUS_END = 0x83
+STATUS_ERROR = 0x8F
+
+ERRORS = {
+    0x01: "a block download is already in progress",
+    0x02: "block out of range",
+}
+
+BLOCK_SIZE = 128
+FRAME_PAYLOAD = 7
+CHECKPOINT = struct.Struct("<I6sH")
+END = 0xFF
+
+
+def varint(data, pos):
+    value, shift = 0, 0
+    while True:
+        byte = data[pos]
+        pos += 1
+        value |= (byte & 0x7F) << shift
+        shift += 7
+        if byte < 0x80:
+            return value, pos
+
+
+def decode_block(data):
+    """Return (sequence, checkpoint ms, checkpoint state, [(ms, channel, open)])."""
+    sequence, time_bytes, state = CHECKPOINT.unpack_from(data)
+    time_ms = int.from_bytes(time_bytes, "little")
+    checkpoint_ms, events, pos = time_ms, [], CHECKPOINT.size
+    try:
+        while pos < len(data) and data[pos] != END:
+            header = data[pos]
+            pos += 1
+            channel, is_open = header >> 4, bool(header & 0x08)
+            for _ in range((header & 0x07) + 1):
+                delta, pos = varint(data, pos)
+                time_ms += delta
+                events.append((time_ms, channel, is_open))
+                is_open = not is_open
+    except IndexError:
+        pass  # Block copied mid-record - keep what decoded
+    return sequence, checkpoint_ms, state, events
+
+
+class Link:
+    def __init__(self, bus, address, timeout):
+        self.bus = bus
+        self.address = address
+        self.reply_id = REPLY_BASE_ID + address
+        self.timeout = timeout
+
+    def command(self, opcode, args=()):
+        self.bus.send(CMD_ID, [1 << self.address, opcode] + list(args))
+
+    def fail(self, message):
+        sys.exit(f"error: module {self.address}: {message}")
+
+    def status(self):
+        self.command(CMD_STATUS)
+        fid, data = self.bus.recv({self.reply_id}, self.timeout)
+        if data is None:
+            self.fail("no response")
+        if data[0] != STATUS_STATUS:
+            self.fail(f"unexpected reply {bytes(data).hex()}")
+        return {"blocks": data[1], "used": data[2], "current": data[3],
+                "events": struct.unpack_from("<I", bytes(data), 4)[0]}
+
+    def read_block(self, block, retries=3):
+        """Return the block bytes, or None if it was never written."""
+        for _ in range(retries):
+            self.command(CMD_READ, [block])
+            buffer = bytearray(b"\xFF" * BLOCK_SIZE)
+            while True:
+                fid, data = self.bus.recv({self.reply_id}, self.timeout)
+                if data is None:
+                    break
+                if data[0] < 0x80:
+                    pos = data[0] * FRAME_PAYLOAD
+                    chunk = bytes(data[1:])[:BLOCK_SIZE - pos]
+                    buffer[pos:pos + len(chunk)] = chunk
+                    continue
+                if data[0] == STATUS_ERROR:
+                    self.fail(ERRORS.get(data[1], hex(data[1])))
+                if data[0] == STATUS_END and data[1] == block:
+                    if data[4]:
+                        return None
+                    crc = data[2] | (data[3] << 8)
+                    if binascii.crc_hqx(bytes(buffer), 0xFFFF) == crc:
+                        return bytes(buffer)
+                    break
+        self.fail(f"block {block} failed")
+
+    def history(self, since_ms=None):
+        state = self.status()
+        # Oldest block first: the one after the current block once the ring wrapped
+        first = (state["current"] + 1) % state["blocks"] if state["used"] == state["blocks"] else 0
+        order = [(first + i) % state["blocks"] for i in range(state["used"])]
+        blocks = []
+        # Newest first, so --since can stop at the first block that is old enough
+        for block in reversed(order):
+            data = self.read_block(block)
+            if data is None:
+                continue
+            decoded = decode_block(data)
+            blocks.append(decoded)
+            if since_ms is not None and decoded[1] <= since_ms:
+                break
+        blocks.sort(key=lambda b: b[0])
+        events = [e for b in blocks for e in b[3]]
+        if since_ms is not None:
+            events = [e for e in events if e[0] > since_ms]
+        return state, events
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__,
+                                     formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("action", choices=["status", "dump"])
+    parser.add_argument("--iface", default="can0", help="SocketCAN interface")
+    parser.add_argument("--address", type=int, nargs="+", default=[0], help="DIP address(es)")
+    parser.add_argument("--since", type=float, help="dump: only changes after this bus time (s)")
+    parser.add_argument("--csv", action="store_true", help="dump: address,time_s,channel,state")
+    parser.add_argument("--timeout-ms", type=float, default=500.0)
+    args = parser.parse_args()
+
+    bus = Bus(args.iface)
+    for address in sorted(set(args.address)):
+        link = Link(bus, address, args.timeout_ms / 1000)
+        if args.action == "status":
+            state = link.status()
+            print(f"module {address}: {state['used']}/{state['blocks']} blocks, "
+                  f"current {state['current']}, {state['events']} changes recorded")
+            continue
+
+        since_ms = None if args.since is None else int(args.since * 1000)
+        state, events = link.history(since_ms)
+        for time_ms, channel, is_open in events:
+            label = "open" if is_open else "closed"
+            if args.csv:
+                print(f"{address},{time_ms / 1000:.3f},{channel + 1},{label}")
+            else:
+                print(f"module {address}  {time_ms / 1000:12.3f} s  RSW{channel + 1:02d} {label}")
+        print(f"module {address}: {len(events)} change(s) from "
+              f"{state['used']} block(s)", file=sys.stderr)
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,52 @@
+#!/usr/bin/env python3
+"""Print the CAN ID plan from include/CanIdPlan.h.
+
+The CAN_ID_PLAN table in CanIdPlan.h is the single source for every CAN ID
+the module uses. The host tools take their IDs from it through ids(); this
+prints it as a Markdown table for the README, or as Python constants.
+
+    python3 tools/can_id_plan.py            # Markdown
+    python3 tools/can_id_plan.py --python   # NAME_ID = 0x... lines
+"""
+
+import argparse
+import os
+import re
+
+HEADER = os.path.join(os.path.dirname(__file__), "..", "include", "CanIdPlan.h")
+ENTRY = re.compile(r'X\((\w+),\s*(0x[0-9A-Fa-f]+),\s*(\d+),\s*"([^"]*)"\)')
+
+
+def load(path=HEADER):
+    """Return [(name, base, slots, description)] in table order."""
+    return [(name, int(base, 16), int(slots), description)
+            for name, base, slots, description in ENTRY.findall(open(path).read())]
+
+
+def ids(path=HEADER):
+    """Return {name: base ID}, e.g. ids()["OTA_COMMAND"] == 0x600."""
+    return {name: base for name, base, _, _ in load(path)}
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__,
+                                     formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("--python", action="store_true", help="emit Python constants")
+    args = parser.parse_args()
+
+    plan = load()
+    if args.python:
+        for name, base, slots, _ in plan:
+            suffix = "_BASE_ID" if slots > 1 else "_ID"
+            print(f"{name}{suffix} = 0x{base:03X}")
+        return
+
+    print("| CAN ID        | Use |")
+    print("|---------------|-----|")
+    for name, base, slots, description in plan:
+        ids = f"`0x{base:03X}`" if slots == 1 else f"`0x{base:03X}-0x{base + slots - 1:03X}`"
+        print(f"| {ids:<13} | {description} |")
+
+
+if __name__ == "__main__":
+    main()
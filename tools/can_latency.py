@@ -0,0 +1,135 @@
+#!/usr/bin/env python3
+"""End-to-end door status latency per Cabinet & Door Sensor module.
+
+Door status frames (events 0x0A-0x11, heartbeats 0x2A-0x31, DLC 8) carry:
+
+    bytes 2-3  ms from the newest reed contact edge to the sample
+    bytes 4-5  us from the sample to the hand-off to the CAN driver
+    bytes 6-7  low 16 bits of bus time (us) at that hand-off
+
+Event frames give change-to-queue latency (age + delay) on the module's own
+clock. With --synced, the receive timestamps are taken to be on bus time,
+for example when tools/can_time_master.py runs on the same host. The
+queue-to-receive part then comes from bytes 6-7, and the report covers the
+full path from contact edge to reception.
+
+    python3 tools/can_latency.py --iface can0 --seconds 60 --synced
+    python3 tools/can_latency.py --log candump.log      # candump -L format
+"""
+
+import argparse
+import collections
+import re
+import socket
+import struct
+import time
+
+import can_id_plan
+
+PLAN = can_id_plan.ids()
+EVENT_BASE_ID = PLAN["DOOR_EVENT"]
+HEARTBEAT_BASE_ID = PLAN["DOOR_HEARTBEAT"]
+MODULES = 8
+AGE_UNKNOWN = 0xFFFF
+
+CAN_FRAME = struct.Struct("=IB3x8s")
+TIMEVAL = struct.Struct("@ll")
+SO_TIMESTAMP = getattr(socket, "SO_TIMESTAMP", 29)
+CANDUMP_LINE = re.compile(r"\((\d+)\.(\d+)\)\s+\S+\s+([0-9A-Fa-f]+)#([0-9A-Fa-f]*)")
+
+
+def live_frames(iface, seconds):
+    """Yield (rx_us, can_id, data) with kernel receive timestamps."""
+    sock = socket.socket(socket.AF_CAN, socket.SOCK_RAW, socket.CAN_RAW)
+    sock.setsockopt(socket.SOL_SOCKET, SO_TIMESTAMP, 1)
+    sock.bind((iface,))
+    deadline = time.monotonic() + seconds
+    while True:
+        remaining = deadline - time.monotonic()
+        if remaining <= 0:
+            return
+        sock.settimeout(remaining)
+        try:
+            frame, ancdata, _, _ = sock.recvmsg(CAN_FRAME.size,
+                                                socket.CMSG_SPACE(TIMEVAL.size))
+        except socket.timeout:
+            return
+        fid, dlc, data = CAN_FRAME.unpack(frame)
+        rx_us = None
+        for level, kind, value in ancdata:
+            if level == socket.SOL_SOCKET and kind == SO_TIMESTAMP:
+                sec, usec = TIMEVAL.unpack(value[:TIMEVAL.size])
+                rx_us = sec * 1000000 + usec
+        if rx_us is None:
+            rx_us = int(time.time() * 1000000)
+        yield rx_us, fid & socket.CAN_EFF_MASK, data[:dlc]
+
+
+def log_frames(path):
+    """Yield (rx_us, can_id, data) from a candump -L log."""
+    for line in open(path):
+        match = CANDUMP_LINE.search(line)
+        if not match:
+            continue
+        sec, frac, fid, payload = match.groups()
+        rx_us = int(sec) * 1000000 + int(frac.ljust(6, "0")[:6])
+        yield rx_us, int(fid, 16), bytes.fromhex(payload)
+
+
+def percentiles(values):
+    values = sorted(values)
+    pick = lambda p: values[min(len(values) - 1, int(len(values) * p))]
+    return len(values), pick(0.5), pick(0.9), pick(0.99), values[-1]
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__,
+                                     formatter_class=argparse.RawDescriptionHelpFormatter)
+    source = parser.add_mutually_exclusive_group()
+    source.add_argument("--iface", default="can0")
+    source.add_argument("--log", help="candump -L log file instead of a live bus")
+    parser.add_argument("--seconds", type=float, default=60.0,
+                        help="live capture duration (default 60)")
+    parser.add_argument("--synced", action="store_true",
+                        help="receive timestamps are on bus time (host is the time master)")
+    args = parser.parse_args()
+
+    frames = log_frames(args.log) if args.log else live_frames(args.iface, args.seconds)
+
+    # stats[(dip, metric)] = [microseconds...]
+    stats = collections.defaultdict(list)
+    for rx_us, fid, data in frames:
+        if EVENT_BASE_ID <= fid < EVENT_BASE_ID + MODULES:
+            dip, kind = fid - EVENT_BASE_ID, "event"
+        elif HEARTBEAT_BASE_ID <= fid < HEARTBEAT_BASE_ID + MODULES:
+            dip, kind = fid - HEARTBEAT_BASE_ID, "heartbeat"
+        else:
+            continue
+        if len(data) < 8:
+            continue
+        age_ms, delay_us, queue16 = struct.unpack_from("<HHH", data, 2)
+        stats[(dip, kind + " sample-to-queue")].append(delay_us)
+        transit_us = (rx_us - queue16) & 0xFFFF if args.synced else None
+        if transit_us is not None:
+            stats[(dip, kind + " queue-to-receive")].append(transit_us)
+        if kind == "event" and age_ms != AGE_UNKNOWN:
+            change_to_queue = age_ms * 1000 + delay_us
+            stats[(dip, "event edge-to-queue")].append(change_to_queue)
+            if transit_us is not None:
+                stats[(dip, "event edge-to-receive")].append(change_to_queue + transit_us)
+
+    if not stats:
+        print("no door status frames with age fields seen")
+        return
+
+    print(f"{'module':<7} {'metric':<28} {'count':>7} {'p50_us':>9} {'p90_us':>9} "
+          f"{'p99_us':>9} {'max_us':>9}")
+    for (dip, metric) in sorted(stats):
+        count, p50, p90, p99, worst = percentiles(stats[(dip, metric)])
+        print(f"{dip:<7} {metric:<28} {count:>7} {p50:>9} {p90:>9} {p99:>9} {worst:>9}")
+    if not args.synced:
+        print("\nqueue-to-receive needs --synced (receive timestamps on bus time)")
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,329 @@
+#!/usr/bin/env python3
+"""Send a firmware image to Cabinet & Door Sensor modules over CAN.
+
+Uses Linux SocketCAN directly (no extra packages). With a single address the
+image is streamed in flow-controlled blocks. With several addresses (or
+--multicast) one block stream is received by every module concurrently,
+followed by selective repair of the blocks each module reports missing.
+--compress sends independently decodable compressed chunks, and
+--delta-base additionally encodes against the image the modules are running.
+If TRAILCURRENT_CAN_AUTH_KEY is set, BEGIN and END are authenticated.
+The SHA-256 is sent for verification and throughput is reported in KB/s.
+
+    python3 tools/can_ota_send.py --iface can0 --address 3 firmware.bin
+    python3 tools/can_ota_send.py --iface can0 --address 0 1 2 3 4 5 6 7 firmware.bin
+    python3 tools/can_ota_send.py --iface can0 --address 3 --delta-base old.bin new.bin
+"""
+
+import argparse
+import binascii
+import hashlib
+import socket
+import struct
+import sys
+import time
+
+import can_auth
+import can_id_plan
+import fwcodec
+
+PLAN = can_id_plan.ids()
+CMD_ID = PLAN["OTA_COMMAND"]
+DATA_ID = PLAN["OTA_DATA"]
+STATUS_BASE_ID = PLAN["OTA_STATUS"]
+
+CMD_BEGIN = 0x01
+CMD_BLOCK = 0x02
+CMD_HASH = 0x03
+CMD_END = 0x04
+CMD_ABORT = 0x05
+CMD_QUERY = 0x06
+CMD_BASE = 0x07
+
+STATUS_READY = 0x81
+STATUS_ACK = 0x82
+STATUS_DONE = 0x83
+STATUS_MISSING = 0x84
+STATUS_REPORT = 0x85
+STATUS_ERROR = 0x8F
+
+FLAG_MULTICAST = 0x01
+FLAG_COMPRESSED = 0x02
+FLAG_DELTA = 0x04
+
+ERRORS = {
+    0x01: "no OTA partition",
+    0x02: "image too large",
+    0x03: "flash write failed",
+    0x04: "sequence error",
+    0x05: "SHA-256 mismatch",
+    0x06: "image validation failed",
+    0x07: "transfer timed out",
+    0x08: "delta base does not match running image",
+    0x09: "compressed block failed to decode",
+}
+
+FRAME_PAYLOAD = 7
+FRAMES_PER_BLOCK = 256
+BLOCK_SIZE = FRAME_PAYLOAD * FRAMES_PER_BLOCK
+BLOCKS_PER_MISSING_FRAME = 40
+
+CAN_FRAME = struct.Struct("=IB3x8s")
+
+
+class Bus:
+    def __init__(self, iface):
+        self.sock = socket.socket(socket.AF_CAN, socket.SOCK_RAW, socket.CAN_RAW)
+        self.sock.bind((iface,))
+
+    def send(self, can_id, data):
+        frame = CAN_FRAME.pack(can_id, len(data), bytes(data).ljust(8, b"\x00"))
+        while True:
+            try:
+                self.sock.send(frame)
+                return
+            except OSError:
+                # TX queue full - let the controller drain
+                time.sleep(0.0005)
+
+    def recv(self, can_ids, timeout):
+        """Return (can_id, data) for the next frame with an ID in can_ids."""
+        deadline = time.monotonic() + timeout
+        while True:
+            remaining = deadline - time.monotonic()
+            if remaining <= 0:
+                return None, None
+            self.sock.settimeout(remaining)
+            try:
+                frame = self.sock.recv(CAN_FRAME.size)
+            except socket.timeout:
+                return None, None
+            fid, dlc, data = CAN_FRAME.unpack(frame)
+            fid &= socket.CAN_EFF_MASK
+            if fid in can_ids:
+                return fid, data[:dlc]
+
+
+def describe(reply):
+    if reply is None:
+        return "no response"
+    if reply[0] == STATUS_ERROR:
+        return ERRORS.get(reply[1], f"error 0x{reply[1]:02X}")
+    return f"unexpected status 0x{reply[0]:02X}"
+
+
+def base_id(base):
+    """First bytes of the SHA-256 the bootloader appends to an app image."""
+    digest = hashlib.sha256(base[:-32]).digest()
+    if digest != base[-32:]:
+        sys.exit("error: delta base has no appended SHA-256 - use the .bin from the build")
+    return digest[:4]
+
+
+class Sender:
+    def __init__(self, bus, image, addresses, payloads, flags, auth=None):
+        self.bus = bus
+        self.auth = auth
+        self.image = image
+        self.addresses = addresses
+        self.mask = sum(1 << a for a in addresses)
+        self.status_ids = {STATUS_BASE_ID + a: a for a in addresses}
+        self.payloads = payloads
+        self.blocks = len(payloads)
+        self.flags = flags
+        self.start = None
+        self.sent = 0
+
+    def fail(self, message):
+        self.bus.send(CMD_ID, [self.mask, CMD_ABORT])
+        sys.exit("error: " + message)
+
+    def command(self, opcode, args=()):
+        data = [self.mask, opcode] + list(args)
+        if self.auth and opcode in (CMD_BEGIN, CMD_BASE, CMD_HASH, CMD_END):
+            self.auth.record(CMD_ID, data)
+        self.bus.send(CMD_ID, data)
+
+    def authenticate(self):
+        if self.auth:
+            self.bus.send(can_auth.AUTH_ID, self.auth.auth_frame(CMD_ID))
+
+    def collect(self, expected, timeout, addresses=None):
+        """Wait for `expected` status from every module, failing on errors."""
+        waiting = set(addresses if addresses is not None else self.addresses)
+        replies = {}
+        deadline = time.monotonic() + timeout
+        while waiting:
+            fid, reply = self.bus.recv(
+                {STATUS_BASE_ID + a for a in waiting}, deadline - time.monotonic())
+            if reply is None:
+                self.fail(f"modules {sorted(waiting)}: no {expected:#04x} response")
+            address = self.status_ids[fid]
+            if reply[0] == STATUS_ERROR:
+                self.fail(f"module {address}: {describe(reply)}")
+            if reply[0] == expected:
+                replies[address] = reply
+                waiting.discard(address)
+        return replies
+
+    def send_block(self, block):
+        chunk = self.payloads[block]
+        frames = (len(chunk) + FRAME_PAYLOAD - 1) // FRAME_PAYLOAD
+        crc = binascii.crc_hqx(chunk, 0xFFFF)
+        self.command(CMD_BLOCK, [block & 0xFF, block >> 8, frames - 1, crc & 0xFF, crc >> 8])
+        for index in range(frames):
+            payload = chunk[index * FRAME_PAYLOAD:(index + 1) * FRAME_PAYLOAD]
+            self.bus.send(DATA_ID, [index] + list(payload))
+        self.sent += len(chunk)
+        return len(chunk)
+
+    def progress(self, done, label):
+        # Rate is image bytes delivered per second, so compression shows up in it
+        rate = done / 1024 / max(time.monotonic() - self.start, 1e-6)
+        print(f"\r  {label}: {done}/{len(self.image)} bytes  {rate:.1f} KB/s", end="")
+
+    def begin(self, base=None):
+        if base is not None:
+            self.command(CMD_BASE, list(base_id(base)))
+        size = list(len(self.image).to_bytes(3, "little"))
+        self.command(CMD_BEGIN, size + [self.flags, self.blocks & 0xFF, self.blocks >> 8])
+        self.authenticate()
+        # Older firmware erases the whole image range before answering
+        self.collect(STATUS_READY, 20.0)
+        self.start = time.monotonic()
+
+    def image_done(self, blocks_done):
+        return len(self.image) * blocks_done // self.blocks
+
+    def unicast(self, retries):
+        address = self.addresses[0]
+        status_id = STATUS_BASE_ID + address
+        for block in range(self.blocks):
+            for _ in range(retries + 1):
+                self.send_block(block)
+                if self.wait_ack(status_id, block):
+                    break
+            else:
+                self.fail(f"block {block} not acknowledged")
+            self.progress(self.image_done(block + 1), "stream")
+        print()
+
+    def wait_ack(self, status_id, block):
+        deadline = time.monotonic() + 1.0
+        while True:
+            _, reply = self.bus.recv({status_id}, deadline - time.monotonic())
+            if reply is None:
+                return False
+            if reply[0] == STATUS_ERROR:
+                self.fail(describe(reply))
+            if reply[0] == STATUS_ACK and (reply[1] | (reply[2] << 8)) == block:
+                return True
+
+    def query_missing(self):
+        """Return {address: set(missing blocks)} from every module."""
+        self.command(CMD_QUERY)
+        missing = {a: set() for a in self.addresses}
+        waiting = set(self.addresses)
+        deadline = time.monotonic() + 2.0
+        while waiting:
+            fid, reply = self.bus.recv(
+                {STATUS_BASE_ID + a for a in waiting}, deadline - time.monotonic())
+            if reply is None:
+                self.fail(f"modules {sorted(waiting)}: no missing-block report")
+            address = self.status_ids[fid]
+            if reply[0] == STATUS_ERROR:
+                self.fail(f"module {address}: {describe(reply)}")
+            elif reply[0] == STATUS_MISSING:
+                base = reply[1] | (reply[2] << 8)
+                bitmap = int.from_bytes(reply[3:8], "little")
+                for bit in range(BLOCKS_PER_MISSING_FRAME):
+                    if bitmap & (1 << bit):
+                        missing[address].add(base + bit)
+            elif reply[0] == STATUS_REPORT:
+                waiting.discard(address)
+        return missing
+
+    def multicast(self, rounds, gap):
+        for block in range(self.blocks):
+            self.send_block(block)
+            self.progress(self.image_done(block + 1), "stream")
+            time.sleep(gap)
+        print()
+
+        for repair in range(1, rounds + 1):
+            time.sleep(0.1)
+            missing = self.query_missing()
+            wanted = sorted(set().union(*missing.values()))
+            if not wanted:
+                return
+            print(f"  repair {repair}: {len(wanted)} blocks missing "
+                  f"({', '.join(f'{a}:{len(m)}' for a, m in missing.items() if m)})")
+            for block in wanted:
+                self.send_block(block)
+                time.sleep(gap)
+        self.fail(f"blocks still missing after {rounds} repair rounds")
+
+    def finish(self):
+        digest = hashlib.sha256(self.image).digest()
+        for offset in range(0, len(digest), 5):
+            self.command(CMD_HASH, [offset] + list(digest[offset:offset + 5]))
+        self.command(CMD_END)
+        self.authenticate()
+        # Readback and SHA-256 of the whole slot happens before DONE
+        self.collect(STATUS_DONE, 15.0)
+        elapsed = time.monotonic() - self.start
+        print(f"Verified and switched boot slot on {len(self.addresses)} module(s) "
+              f"in {elapsed:.1f} s ({len(self.image) / 1024 / elapsed:.1f} KB/s image, "
+              f"{self.sent / 1024 / elapsed:.1f} KB/s on the bus)")
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("image", help="firmware .bin to send")
+    parser.add_argument("--iface", default="can0", help="SocketCAN interface")
+    parser.add_argument("--address", type=int, nargs="+", required=True,
+                        choices=range(8), help="DIP address(es) of target modules")
+    parser.add_argument("--multicast", action="store_true",
+                        help="use the multicast stream even for a single module")
+    parser.add_argument("--retries", type=int, default=5,
+                        help="unicast retries per block")
+    parser.add_argument("--repair-rounds", type=int, default=10,
+                        help="multicast repair rounds before giving up")
+    parser.add_argument("--block-gap-ms", type=float, default=5.0,
+                        help="multicast pause between blocks for flash writes")
+    parser.add_argument("--compress", action="store_true",
+                        help="send compressed blocks")
+    parser.add_argument("--delta-base", metavar="BIN",
+                        help="image the modules are running; send a delta against it")
+    args = parser.parse_args()
+
+    image = open(args.image, "rb").read()
+    base = open(args.delta_base, "rb").read() if args.delta_base else None
+    addresses = sorted(set(args.address))
+    multicast = args.multicast or len(addresses) > 1
+
+    flags = FLAG_MULTICAST if multicast else 0
+    if args.compress or base is not None:
+        flags |= FLAG_COMPRESSED | (FLAG_DELTA if base is not None else 0)
+        blocks = fwcodec.Encoder(image, base).blocks(BLOCK_SIZE)
+        # Pad to whole frames - the module takes frames * 7 bytes per block
+        payloads = [b + bytes(-len(b) % FRAME_PAYLOAD) for b in blocks]
+    else:
+        payloads = [image[i:i + BLOCK_SIZE] for i in range(0, len(image), BLOCK_SIZE)]
+    sender = Sender(Bus(args.iface), image, addresses, payloads, flags,
+                    can_auth.from_environment())
+
+    on_bus = sum(len(p) for p in payloads)
+    print(f"Sending {len(image)} bytes to module(s) {addresses} "
+          f"({'multicast' if multicast else 'unicast'}, {on_bus} bytes on the bus, "
+          f"{len(image) / on_bus:.1f}x)")
+    sender.begin(base)
+    if multicast:
+        sender.multicast(args.repair_rounds, args.block_gap_ms / 1000.0)
+    else:
+        sender.unicast(args.retries)
+    sender.finish()
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,94 @@
+#!/usr/bin/env python3
+"""Bus time master for Cabinet & Door Sensor modules.
+
+Broadcasts SYNC (ID 0x03, [seq]) and then FOLLOW_UP (ID 0x04, [seq,
+master_us 7 bytes LE]) once per period. The FOLLOW_UP carries the time the
+SYNC actually left the bus, taken from the kernel receive timestamp of our
+own looped-back frame, so host scheduling and TX queueing delays do not
+end up in the modules' clocks. Master time is Unix time in microseconds.
+
+    python3 tools/can_time_master.py --iface can0 --period 1
+"""
+
+import argparse
+import socket
+import struct
+import time
+
+import can_id_plan
+
+PLAN = can_id_plan.ids()
+SYNC_ID = PLAN["TIME_SYNC"]
+FOLLOW_UP_ID = PLAN["TIME_FOLLOW_UP"]
+
+CAN_FRAME = struct.Struct("=IB3x8s")
+TIMEVAL = struct.Struct("@ll")
+SO_TIMESTAMP = getattr(socket, "SO_TIMESTAMP", 29)
+CAN_RAW_RECV_OWN_MSGS = getattr(socket, "CAN_RAW_RECV_OWN_MSGS", 4)
+
+
+class Master:
+    def __init__(self, iface):
+        self.sock = socket.socket(socket.AF_CAN, socket.SOCK_RAW, socket.CAN_RAW)
+        self.sock.setsockopt(socket.SOL_CAN_RAW, CAN_RAW_RECV_OWN_MSGS, 1)
+        self.sock.setsockopt(socket.SOL_SOCKET, SO_TIMESTAMP, 1)
+        # Only our own SYNC frames come back to us
+        self.sock.setsockopt(socket.SOL_CAN_RAW, socket.CAN_RAW_FILTER,
+                             struct.pack("=II", SYNC_ID, socket.CAN_SFF_MASK))
+        self.sock.bind((iface,))
+
+    def _send(self, can_id, data):
+        self.sock.send(CAN_FRAME.pack(can_id, len(data), bytes(data).ljust(8, b"\x00")))
+
+    def sync(self, seq, timeout=0.1):
+        """Send SYNC and FOLLOW_UP; return the SYNC time in us or None."""
+        self._send(SYNC_ID, [seq])
+        deadline = time.monotonic() + timeout
+        while True:
+            remaining = deadline - time.monotonic()
+            if remaining <= 0:
+                return None
+            self.sock.settimeout(remaining)
+            try:
+                frame, ancdata, _, _ = self.sock.recvmsg(
+                    CAN_FRAME.size, socket.CMSG_SPACE(TIMEVAL.size))
+            except socket.timeout:
+                return None
+            fid, dlc, data = CAN_FRAME.unpack(frame)
+            if fid != SYNC_ID or dlc < 1 or data[0] != seq:
+                continue
+            master_us = None
+            for level, kind, value in ancdata:
+                if level == socket.SOL_SOCKET and kind == SO_TIMESTAMP:
+                    sec, usec = TIMEVAL.unpack(value[:TIMEVAL.size])
+                    master_us = sec * 1000000 + usec
+            if master_us is None:
+                master_us = int(time.time() * 1000000)
+            self._send(FOLLOW_UP_ID, [seq] + list(master_us.to_bytes(7, "little")))
+            return master_us
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__,
+                                     formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("--iface", default="can0")
+    parser.add_argument("--period", type=float, default=1.0,
+                        help="seconds between SYNC frames (default 1)")
+    parser.add_argument("--count", type=int, default=0,
+                        help="stop after this many SYNCs (default: run forever)")
+    args = parser.parse_args()
+
+    master = Master(args.iface)
+    seq = 0
+    sent = 0
+    while args.count == 0 or sent < args.count:
+        master_us = master.sync(seq)
+        if master_us is None:
+            print(f"sync {seq}: own frame not seen, is the bus up?")
+        sent += 1
+        seq = (seq + 1) & 0xFF
+        time.sleep(args.period)
+
+
+if __name__ == "__main__":
+    main()
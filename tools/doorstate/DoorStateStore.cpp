@@ -0,0 +1,133 @@
+#include "DoorStateStore.h"
+#include "CanIdPlan.h"
+
+// Staleness needs no finer resolution than 10 ms; 1024 slots span 10 s
+static const uint32_t WHEEL_TICK_US = 10000;
+static const uint32_t WHEEL_SLOTS = 1024;
+
+static const uint16_t AGE_NONE = 0xFFFF;
+
+DoorStateStore::DoorStateStore(uint64_t staleAfter)
+    : staleAfterUs(staleAfter), wheel(WHEEL_TICK_US, WHEEL_SLOTS) {
+  for (uint8_t i = 0; i < MODULES; i++) {
+    modules[i] = Module();
+    modules[i].index = i;
+  }
+}
+
+void DoorStateStore::onChanges(ChangeCallback callback, void *context) {
+  changeCallback = callback;
+  changeContext = context;
+}
+
+void DoorStateStore::onModule(ModuleCallback callback, void *context) {
+  moduleCallback = callback;
+  moduleContext = context;
+}
+
+void DoorStateStore::beginWrite() {
+  sequence.store(sequence.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+}
+
+void DoorStateStore::endWrite() {
+  sequence.store(sequence.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+}
+
+void DoorStateStore::publish(const Module &module) {
+  uint64_t state = module.doors | ((uint64_t)module.seen << 16) | ((uint64_t)module.stale << 17);
+  beginWrite();
+  sharedState[module.index].store(state, std::memory_order_relaxed);
+  sharedLastSeen[module.index].store(module.lastSeenUs, std::memory_order_relaxed);
+  sharedFrames[module.index].store(module.frames, std::memory_order_relaxed);
+  sharedTotals[0].store(frames, std::memory_order_relaxed);
+  sharedTotals[1].store(changes, std::memory_order_relaxed);
+  endWrite();
+}
+
+void DoorStateStore::expired(WheelTimer &timer, uint64_t nowUs, void *context) {
+  DoorStateStore *store = (DoorStateStore *)context;
+  Module &module = (Module &)timer;
+  module.stale = true;
+  store->publish(module);
+  if (store->moduleCallback) {
+    store->moduleCallback(module.index, false, nowUs, store->moduleContext);
+  }
+}
+
+void DoorStateStore::advance(uint64_t nowUs) {
+  if (!started) {
+    wheel.reset(nowUs);
+    started = true;
+    return;
+  }
+  wheel.advance(nowUs, expired, this);
+}
+
+bool DoorStateStore::ingest(uint32_t id, uint8_t dlc, const uint8_t *data, uint64_t timeUs) {
+  advance(timeUs);
+
+  uint32_t index;
+  if (CanIdPlan::contains(CanIdPlan::DOOR_EVENT, id)) {
+    index = id - CanIdPlan::id(CanIdPlan::DOOR_EVENT);
+  } else if (CanIdPlan::contains(CanIdPlan::DOOR_HEARTBEAT, id)) {
+    index = id - CanIdPlan::id(CanIdPlan::DOOR_HEARTBEAT);
+  } else {
+    return false;
+  }
+  if (dlc < 2 || index >= MODULES) return false;
+
+  Module &module = modules[index];
+  uint16_t doors = data[0] | ((data[1] & 0x03) << 8);
+  bool online = !module.seen || module.stale;
+
+  // A module's first frame sets its state; later frames report differences,
+  // including those that happened while it was offline
+  DoorChange batch[CHANNELS];
+  uint8_t count = 0;
+  uint16_t diff = module.seen ? (doors ^ module.doors) : 0;
+  if (diff) {
+    // Age runs from the edge to the sample, delay from the sample to the queue
+    uint16_t ageMs = dlc >= 4 ? (uint16_t)(data[2] | (data[3] << 8)) : AGE_NONE;
+    uint64_t ageUs = ageMs == AGE_NONE ? 0 : (uint64_t)ageMs * 1000;
+    if (ageMs != AGE_NONE && dlc >= 6) ageUs += (uint16_t)(data[4] | (data[5] << 8));
+    uint64_t edgeUs = ageUs < timeUs ? timeUs - ageUs : timeUs;
+    for (uint8_t channel = 0; channel < CHANNELS; channel++) {
+      if (!(diff & (1 << channel))) continue;
+      batch[count++] = { (uint8_t)index, channel, (doors & (1 << channel)) != 0, timeUs, edgeUs };
+    }
+  }
+
+  module.doors = doors;
+  module.seen = true;
+  module.stale = false;
+  module.lastSeenUs = timeUs;
+  module.frames++;
+  frames++;
+  changes += count;
+  wheel.arm(module.timer, timeUs + staleAfterUs);
+  publish(module);
+
+  if (online && moduleCallback) moduleCallback(module.index, true, timeUs, moduleContext);
+  if (count && changeCallback) changeCallback(batch, count, changeContext);
+  return true;
+}
+
+void DoorStateStore::snapshot(Snapshot &out) const {
+  for (;;) {
+    uint32_t before = sequence.load(std::memory_order_acquire);
+    if (before & 1) continue;  // Writer mid-update
+    for (uint8_t i = 0; i < MODULES; i++) {
+      uint64_t state = sharedState[i].load(std::memory_order_relaxed);
+      out.modules[i].doors = (uint16_t)(state & 0xFFFF);
+      out.modules[i].seen = (state >> 16) & 1;
+      out.modules[i].stale = (state >> 17) & 1;
+      out.modules[i].lastSeenUs = sharedLastSeen[i].load(std::memory_order_relaxed);
+      out.modules[i].frames = sharedFrames[i].load(std::memory_order_relaxed);
+    }
+    out.frames = sharedTotals[0].load(std::memory_order_relaxed);
+    out.changes = sharedTotals[1].load(std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if (sequence.load(std::memory_order_relaxed) == before) return;
+  }
+}
@@ -0,0 +1,112 @@
+#pragma once
+
+#include "TimerWheel.h"
+#include <atomic>
+#include <stdint.h>
+
+// =============================================================================
+// Door State Store
+// =============================================================================
+//
+// Host library for gateways and log tools: feed it every CAN frame and it
+// keeps the state of all 80 doors (8 modules x 10 channels) from the door
+// event and heartbeat frames (IDs from CanIdPlan.h), so consumers stop
+// writing their own decode-and-diff loops.
+//
+// One writer thread calls ingest() (and advance() while the bus is quiet).
+// Changed doors are reported through one callback per frame, with every door
+// that frame changed. A module that has not been heard from for staleAfterUs
+// goes offline through the module callback; a timer wheel tracks this
+// without scanning. Any number of reader threads take consistent snapshots
+// of the whole table without locks (seqlock): the writer never waits, and a
+// reader retries only if a frame was applied while it copied.
+//
+// Times are whatever the frame source provides (receive time in us).
+
+class DoorStateStore {
+public:
+  static const uint8_t MODULES = 8;
+  static const uint8_t CHANNELS = 10;
+  static const uint8_t DOORS = MODULES * CHANNELS;
+
+  struct DoorChange {
+    uint8_t module;   // DIP address
+    uint8_t channel;  // 0 = RSW01
+    bool open;
+    uint64_t timeUs;  // Receive time of the frame that carried it
+    uint64_t edgeUs;  // Receive time minus the age and delay fields (= timeUs
+                      // if the frame has no age)
+  };
+
+  struct ModuleState {
+    uint16_t doors;  // Bit n = RSW(n+1) open
+    bool seen;
+    bool stale;
+    uint64_t lastSeenUs;
+    uint64_t frames;
+  };
+
+  struct Snapshot {
+    ModuleState modules[MODULES];
+    uint64_t frames;  // Door frames ingested
+    uint64_t changes;
+
+    bool open(uint8_t door) const {
+      return modules[door / CHANNELS].doors & (1 << (door % CHANNELS));
+    }
+  };
+
+  typedef void (*ChangeCallback)(const DoorChange *changes, uint8_t count, void *context);
+  typedef void (*ModuleCallback)(uint8_t module, bool online, uint64_t timeUs, void *context);
+
+  // Modules silent for longer than staleAfterUs go offline; 3 s covers the
+  // slowest heartbeat back-off step three times over
+  explicit DoorStateStore(uint64_t staleAfterUs = 3000000);
+
+  void onChanges(ChangeCallback callback, void *context);
+  void onModule(ModuleCallback callback, void *context);
+
+  // Writer thread. Returns true if the frame was a door frame.
+  bool ingest(uint32_t id, uint8_t dlc, const uint8_t *data, uint64_t timeUs);
+
+  // Writer thread: expire modules by time alone (ingest() also does this)
+  void advance(uint64_t nowUs);
+
+  // Any thread, lock-free
+  void snapshot(Snapshot &out) const;
+
+private:
+  struct Module {
+    WheelTimer timer;  // First, so the expiry callback can cast back
+    uint8_t index;
+    uint16_t doors;
+    bool seen;
+    bool stale;
+    uint64_t lastSeenUs;
+    uint64_t frames;
+  };
+
+  static void expired(WheelTimer &timer, uint64_t nowUs, void *context);
+  void publish(const Module &module);
+  void beginWrite();
+  void endWrite();
+
+  uint64_t staleAfterUs;
+  TimerWheel wheel;
+  bool started = false;
+  Module modules[MODULES];
+  uint64_t frames = 0;
+  uint64_t changes = 0;
+
+  ChangeCallback changeCallback = nullptr;
+  void *changeContext = nullptr;
+  ModuleCallback moduleCallback = nullptr;
+  void *moduleContext = nullptr;
+
+  // Reader-visible copy: doors | seen << 16 | stale << 17, last seen, frames
+  std::atomic<uint32_t> sequence{0};
+  std::atomic<uint64_t> sharedState[MODULES] = {};
+  std::atomic<uint64_t> sharedLastSeen[MODULES] = {};
+  std::atomic<uint64_t> sharedFrames[MODULES] = {};
+  std::atomic<uint64_t> sharedTotals[2] = {};
+};
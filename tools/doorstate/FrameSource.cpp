@@ -0,0 +1,196 @@
+#include "FrameSource.h"
+#include <string.h>
+
+#ifdef __linux__
+#include <linux/can.h>
+#include <net/if.h>
+#include <poll.h>
+#include <sys/ioctl.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <unistd.h>
+#endif
+
+static const size_t READ_BUFFER_SIZE = 1 << 20;
+
+// Hex digit value, or 0xFF
+static inline uint8_t hexValue(char c) {
+  if (c >= '0' && c <= '9') return c - '0';
+  if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+  if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+  return 0xFF;
+}
+
+// =============================================================================
+// candump -L log
+// =============================================================================
+
+LogSource::~LogSource() {
+  if (file) fclose(file);
+}
+
+bool LogSource::open(const char *path) {
+  file = fopen(path, "rb");
+  if (!file) return false;
+  buffer.resize(READ_BUFFER_SIZE);
+  pos = end = 0;
+  eof = false;
+  skippedLines = 0;
+  return true;
+}
+
+// Move the unread tail to the front and fill the rest; false once nothing is left
+bool LogSource::refill() {
+  if (eof) return false;
+  if (pos > 0) {
+    memmove(buffer.data(), buffer.data() + pos, end - pos);
+    end -= pos;
+    pos = 0;
+  }
+  if (end == buffer.size()) {
+    // A line longer than the buffer cannot be a frame - drop it
+    end = 0;
+    skippedLines++;
+  }
+  size_t got = fread(buffer.data() + end, 1, buffer.size() - end, file);
+  end += got;
+  if (got == 0) eof = true;
+  return true;
+}
+
+bool LogSource::next(CanFrame &frame) {
+  for (;;) {
+    const char *start = buffer.data() + pos;
+    const char *newline = (const char *)memchr(start, '\n', end - pos);
+    if (!newline) {
+      if (refill()) continue;
+      // Last line without a newline
+      if (pos == end) return false;
+      newline = buffer.data() + end;
+    }
+    pos = newline - buffer.data() + (newline < buffer.data() + end ? 1 : 0);
+    if (newline > start && parse(start, newline, frame)) return true;
+    if (newline > start) skippedLines++;
+  }
+}
+
+// (seconds.fraction) iface ID#DATA
+bool LogSource::parse(const char *p, const char *end, CanFrame &frame) {
+  while (p < end && (*p == ' ' || *p == '\t')) p++;
+  if (p == end || *p++ != '(') return false;
+
+  uint64_t seconds = 0;
+  while (p < end && *p >= '0' && *p <= '9') seconds = seconds * 10 + (*p++ - '0');
+  if (p == end || *p++ != '.') return false;
+  // Fraction scaled to microseconds whatever its number of digits
+  uint64_t micros = 0;
+  int digits = 0;
+  while (p < end && *p >= '0' && *p <= '9') {
+    if (digits < 6) micros = micros * 10 + (*p - '0');
+    digits++;
+    p++;
+  }
+  for (; digits < 6; digits++) micros *= 10;
+  if (p == end || *p++ != ')') return false;
+  frame.timeUs = seconds * 1000000 + micros;
+
+  // Interface name
+  while (p < end && *p == ' ') p++;
+  while (p < end && *p != ' ') p++;
+  while (p < end && *p == ' ') p++;
+
+  const char *idStart = p;
+  uint32_t id = 0;
+  uint8_t value;
+  while (p < end && (value = hexValue(*p)) != 0xFF) {
+    id = (id << 4) | value;
+    p++;
+  }
+  size_t idDigits = p - idStart;
+  if (idDigits == 0 || idDigits > 8 || p == end || *p++ != '#') return false;
+  frame.id = idDigits > 3 ? (id | 0x80000000u) : id;
+
+  // Remote (#R) and CAN FD (##) frames carry no door state
+  if (p < end && (*p == 'R' || *p == '#')) return false;
+
+  uint8_t dlc = 0;
+  while (p + 1 < end && dlc < 8) {
+    uint8_t high = hexValue(p[0]);
+    uint8_t low = hexValue(p[1]);
+    if (high == 0xFF || low == 0xFF) break;
+    frame.data[dlc++] = (high << 4) | low;
+    p += 2;
+  }
+  frame.dlc = dlc;
+  // Trailing whitespace or a carriage return is fine, anything else is not
+  while (p < end && (*p == ' ' || *p == '\r')) p++;
+  return p == end;
+}
+
+// =============================================================================
+// SocketCAN
+// =============================================================================
+
+#ifdef __linux__
+SocketSource::~SocketSource() {
+  if (fd >= 0) close(fd);
+}
+
+bool SocketSource::open(const char *iface) {
+  fd = socket(PF_CAN, SOCK_RAW, CAN_RAW);
+  if (fd < 0) return false;
+
+  struct ifreq ifr = {};
+  strncpy(ifr.ifr_name, iface, IFNAMSIZ - 1);
+  if (ioctl(fd, SIOCGIFINDEX, &ifr) < 0) return false;
+
+  // Kernel receive timestamps, so queueing in the socket adds no error
+  int on = 1;
+  setsockopt(fd, SOL_SOCKET, SO_TIMESTAMP, &on, sizeof(on));
+
+  struct sockaddr_can addr = {};
+  addr.can_family = AF_CAN;
+  addr.can_ifindex = ifr.ifr_ifindex;
+  return bind(fd, (struct sockaddr *)&addr, sizeof(addr)) == 0;
+}
+
+bool SocketSource::next(CanFrame &frame, uint32_t timeoutMs) {
+  struct pollfd waitFor = { fd, POLLIN, 0 };
+  int ready = poll(&waitFor, 1, (int)timeoutMs);
+  if (ready <= 0) {
+    error = ready < 0;
+    return false;
+  }
+
+  struct can_frame raw;
+  char control[CMSG_SPACE(sizeof(struct timeval))];
+  struct iovec iov = { &raw, sizeof(raw) };
+  struct msghdr msg = {};
+  msg.msg_iov = &iov;
+  msg.msg_iovlen = 1;
+  msg.msg_control = control;
+  msg.msg_controllen = sizeof(control);
+  if (recvmsg(fd, &msg, 0) != (ssize_t)sizeof(raw)) {
+    error = true;
+    return false;
+  }
+
+  struct timeval stamp = {};
+  struct cmsghdr *cmsg = CMSG_FIRSTHDR(&msg);
+  if (cmsg && cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SO_TIMESTAMP) {
+    memcpy(&stamp, CMSG_DATA(cmsg), sizeof(stamp));
+  } else {
+    gettimeofday(&stamp, nullptr);
+  }
+  frame.timeUs = (uint64_t)stamp.tv_sec * 1000000 + stamp.tv_usec;
+
+  // Remote and error frames carry no door state; report them as an ID that
+  // matches nothing rather than as a timeout
+  bool extended = raw.can_id & CAN_EFF_FLAG;
+  frame.id = extended ? ((raw.can_id & CAN_EFF_MASK) | 0x80000000u) : (raw.can_id & CAN_SFF_MASK);
+  if (raw.can_id & (CAN_RTR_FLAG | CAN_ERR_FLAG)) frame.id = 0xFFFFFFFFu;
+  frame.dlc = raw.can_dlc > 8 ? 8 : raw.can_dlc;
+  memcpy(frame.data, raw.data, frame.dlc);
+  return true;
+}
+#endif
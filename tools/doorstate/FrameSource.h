@@ -0,0 +1,60 @@
+#pragma once
+
+#include <stdint.h>
+#include <stdio.h>
+#include <vector>
+
+// =============================================================================
+// Door State Store - Frame Sources
+// =============================================================================
+//
+// Raw classic CAN frames for DoorStateStore::ingest(), from a candump -L log
+// (the format can-utils, tools/can_capture.py and tools/can_latency.py share)
+// or, on Linux, a SocketCAN interface.
+
+struct CanFrame {
+  uint64_t timeUs;
+  uint32_t id;  // Extended IDs have bit 31 set so they never match the plan
+  uint8_t dlc;
+  uint8_t data[8];
+};
+
+// Hand-written parser over a large read buffer: log replays are bound by
+// parsing, and sscanf or iostreams would cost several times the ingest.
+// Remote, CAN FD and malformed lines are skipped and counted.
+class LogSource {
+public:
+  ~LogSource();
+
+  bool open(const char *path);
+  bool next(CanFrame &frame);
+  uint64_t skipped() const { return skippedLines; }
+
+private:
+  bool parse(const char *line, const char *end, CanFrame &frame);
+  bool refill();
+
+  FILE *file = nullptr;
+  std::vector<char> buffer;
+  size_t pos = 0;
+  size_t end = 0;
+  bool eof = false;
+  uint64_t skippedLines = 0;
+};
+
+#ifdef __linux__
+class SocketSource {
+public:
+  ~SocketSource();
+
+  bool open(const char *iface);
+
+  // Waits up to timeoutMs; false on timeout or error (see failed())
+  bool next(CanFrame &frame, uint32_t timeoutMs);
+  bool failed() const { return error; }
+
+private:
+  int fd = -1;
+  bool error = false;
+};
+#endif
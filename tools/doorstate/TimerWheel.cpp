@@ -0,0 +1,63 @@
+#include "TimerWheel.h"
+
+TimerWheel::TimerWheel(uint32_t tick, uint32_t slots) : tickUs(tick ? tick : 1) {
+  uint32_t size = 1;
+  while (size < slots) size <<= 1;
+  mask = size - 1;
+  heads.assign(size, nullptr);
+}
+
+void TimerWheel::reset(uint64_t nowUs) {
+  currentTick = nowUs / tickUs;
+}
+
+void TimerWheel::link(WheelTimer &timer) {
+  WheelTimer *&head = heads[timer.expiresTick & mask];
+  timer.prev = nullptr;
+  timer.next = head;
+  if (head) head->prev = &timer;
+  head = &timer;
+  timer.armed = true;
+}
+
+void TimerWheel::arm(WheelTimer &timer, uint64_t expiresUs) {
+  cancel(timer);
+  // Round up, so a timer never fires before its time
+  timer.expiresTick = (expiresUs + tickUs - 1) / tickUs;
+  if (timer.expiresTick <= currentTick) timer.expiresTick = currentTick + 1;
+  link(timer);
+}
+
+void TimerWheel::cancel(WheelTimer &timer) {
+  if (!timer.armed) return;
+  if (timer.prev) {
+    timer.prev->next = timer.next;
+  } else {
+    heads[timer.expiresTick & mask] = timer.next;
+  }
+  if (timer.next) timer.next->prev = timer.prev;
+  timer.prev = timer.next = nullptr;
+  timer.armed = false;
+}
+
+void TimerWheel::advance(uint64_t nowUs, ExpiredFn expired, void *context) {
+  uint64_t target = nowUs / tickUs;
+  if (target <= currentTick) return;
+
+  // One full turn visits every slot, so a longer gap needs no more steps
+  uint64_t steps = target - currentTick;
+  if (steps > (uint64_t)mask + 1) steps = (uint64_t)mask + 1;
+  for (uint64_t i = 1; i <= steps; i++) {
+    WheelTimer *timer = heads[(currentTick + i) & mask];
+    while (timer) {
+      // The callback may re-arm its own timer, so step past it first
+      WheelTimer *next = timer->next;
+      if (timer->expiresTick <= target) {
+        cancel(*timer);
+        expired(*timer, nowUs, context);
+      }
+      timer = next;
+    }
+  }
+  currentTick = target;
+}
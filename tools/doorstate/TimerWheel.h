@@ -0,0 +1,47 @@
+#pragma once
+
+#include <stdint.h>
+#include <vector>
+
+// =============================================================================
+// Door State Store - Timer Wheel
+// =============================================================================
+//
+// Hashed timing wheel with intrusive timers: arming, re-arming and
+// cancelling are O(1) list operations with no allocation, so a timer can be
+// pushed back on every received frame. advance() visits only the slots that
+// elapsed - at most one full turn however long the gap, which keeps replays
+// of sparse logs cheap. Timers further out than one turn stay in their slot
+// until their tick comes round.
+
+struct WheelTimer {
+  WheelTimer *prev = nullptr;
+  WheelTimer *next = nullptr;
+  uint64_t expiresTick = 0;
+  bool armed = false;
+};
+
+class TimerWheel {
+public:
+  typedef void (*ExpiredFn)(WheelTimer &timer, uint64_t nowUs, void *context);
+
+  // slots is rounded up to a power of two
+  TimerWheel(uint32_t tickUs, uint32_t slots);
+
+  // Starts at nowUs; timers armed before this would fire on the first advance
+  void reset(uint64_t nowUs);
+
+  void arm(WheelTimer &timer, uint64_t expiresUs);
+  void cancel(WheelTimer &timer);
+
+  // Fire every timer due by nowUs, oldest slot first
+  void advance(uint64_t nowUs, ExpiredFn expired, void *context);
+
+private:
+  void link(WheelTimer &timer);
+
+  uint32_t tickUs;
+  uint32_t mask;
+  uint64_t currentTick = 0;
+  std::vector<WheelTimer *> heads;
+};
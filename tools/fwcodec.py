@@ -0,0 +1,196 @@
+"""Compressed / delta firmware block encoder.
+
+Produces blocks in the format decoded by src/ImageCodec.cpp. Each block
+decodes on its own into at most MAX_OUTPUT bytes of the image at a known
+offset, so blocks can be delivered in any order. With a base image the
+encoder also emits copy-source ops that reference the module's running slot,
+turning an update into a binary delta.
+"""
+
+import struct
+
+HEADER_SIZE = 6
+MAX_OUTPUT = 4096
+FORMAT_RAW = 0
+FORMAT_LZ = 1
+
+MIN_MATCH = 4
+KEY = 4
+
+
+def _varint(value):
+    out = bytearray()
+    while True:
+        byte = value & 0x7F
+        value >>= 7
+        if value:
+            out.append(byte | 0x80)
+        else:
+            out.append(byte)
+            return bytes(out)
+
+
+def _token(kind, count):
+    if count < 0x3F:
+        return bytes([(kind << 6) | count])
+    return bytes([(kind << 6) | 0x3F]) + _varint(count - 0x3F)
+
+
+def _literal(data):
+    return _token(0, len(data) - 1) + data
+
+
+def _match_len(a, ai, b, bi, limit):
+    n = 0
+    while n + 32 <= limit and a[ai + n:ai + n + 32] == b[bi + n:bi + n + 32]:
+        n += 32
+    while n < limit and a[ai + n] == b[bi + n]:
+        n += 1
+    return n
+
+
+def _index(data):
+    index = {}
+    for i in range(len(data) - KEY + 1):
+        index[data[i:i + KEY]] = i
+    return index
+
+
+class Encoder:
+    def __init__(self, image, base=None):
+        self.image = image
+        self.base = base
+        self.base_index = _index(base) if base else None
+
+    def blocks(self, block_size):
+        """Split the image into encoded blocks of at most block_size bytes."""
+        budget = block_size - HEADER_SIZE
+        out = []
+        offset = 0
+        while offset < len(self.image):
+            body, length = self._encode_chunk(offset, budget)
+            raw_length = min(len(self.image) - offset, budget, MAX_OUTPUT)
+            if length <= raw_length and len(body) >= length:
+                # Incompressible here - raw carries more image per block
+                length = raw_length
+                body = self.image[offset:offset + length]
+                fmt = FORMAT_RAW
+            else:
+                fmt = FORMAT_LZ
+            header = struct.pack("<B", fmt) + offset.to_bytes(3, "little") + \
+                struct.pack("<H", length)
+            out.append(header + body)
+            offset += length
+        return out
+
+    def _encode_chunk(self, start, budget):
+        image = self.image
+        end = min(len(image), start + MAX_OUTPUT)
+        body = bytearray()
+        literals = bytearray()
+        chunk_index = {}
+        base_delta = 0
+        pos = start
+
+        def literal_cost(n):
+            # Literal runs of up to 63 bytes cost one token byte
+            return n + (n + 62) // 63
+
+        while pos < end:
+            limit = end - pos
+            best_len, best_op = 0, None
+
+            if limit >= MIN_MATCH:
+                key = image[pos:pos + KEY]
+                prev = chunk_index.get(key)
+                if prev is not None:
+                    length = _match_len(image, pos, image, prev, limit)
+                    if length > best_len:
+                        best_len, best_op = length, (1, pos - prev)
+                if self.base is not None:
+                    for candidate in (pos + base_delta, self.base_index.get(key)):
+                        if candidate is None or not 0 <= candidate < len(self.base):
+                            continue
+                        length = _match_len(image, pos, self.base, candidate,
+                                            min(limit, len(self.base) - candidate))
+                        if length > best_len:
+                            best_len, best_op = length, (2, candidate - pos)
+
+            if best_len >= MIN_MATCH:
+                kind, arg = best_op
+                if kind == 1:
+                    op = _token(1, best_len - 3) + _varint(arg)
+                else:
+                    zigzag = (arg << 1) ^ (arg >> 63)
+                    op = _token(2, best_len - 3) + _varint(zigzag & 0xFFFFFFFF)
+                    base_delta = arg
+                pending = literal_cost(len(literals))
+                if len(body) + pending + len(op) > budget:
+                    break
+                body += self._flush(literals)
+                body += op
+                for i in range(pos, min(pos + best_len, end - KEY + 1)):
+                    chunk_index[image[i:i + KEY]] = i
+                pos += best_len
+            else:
+                if len(body) + literal_cost(len(literals) + 1) > budget:
+                    break
+                if pos + KEY <= end:
+                    chunk_index[image[pos:pos + KEY]] = pos
+                literals.append(image[pos])
+                pos += 1
+
+        body += self._flush(literals)
+        return bytes(body), pos - start
+
+    @staticmethod
+    def _flush(literals):
+        out = bytearray()
+        for i in range(0, len(literals), 63):
+            out += _literal(bytes(literals[i:i + 63]))
+        literals.clear()
+        return bytes(out)
+
+
+def decode_block(block, base=None):
+    """Reference decoder, used to self-check encoded blocks before sending."""
+    fmt = block[0]
+    offset = int.from_bytes(block[1:4], "little")
+    length = struct.unpack_from("<H", block, 4)[0]
+    p = HEADER_SIZE
+    if fmt == FORMAT_RAW:
+        return offset, bytes(block[p:p + length])
+    out = bytearray()
+
+    def varint():
+        nonlocal p
+        value, shift = 0, 0
+        while True:
+            byte = block[p]
+            p += 1
+            value |= (byte & 0x7F) << shift
+            shift += 7
+            if not byte & 0x80:
+                return value
+
+    while len(out) < length:
+        token = block[p]
+        p += 1
+        kind, count = token >> 6, token & 0x3F
+        if count == 0x3F:
+            count += varint()
+        if kind == 0:
+            out += block[p:p + count + 1]
+            p += count + 1
+        elif kind == 1:
+            distance = varint()
+            for _ in range(count + 3):
+                out.append(out[-distance])
+        elif kind == 2:
+            zigzag = varint()
+            delta = (zigzag >> 1) ^ -(zigzag & 1)
+            src = offset + len(out) + delta
+            out += base[src:src + count + 3]
+        else:
+            raise ValueError("bad token")
+    return offset, bytes(out)
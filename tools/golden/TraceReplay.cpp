@@ -0,0 +1,307 @@
+#include "TraceReplay.h"
+#include "BusLoadMonitor.h"
+#include "CanIdPlan.h"
+#include "DoorPipeline.h"
+#include "SimBus.h"
+#include <algorithm>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// =============================================================================
+// Files
+// =============================================================================
+
+static bool parseConfig(const char *text, TraceConfig &config) {
+  char key[16];
+  char value[16];
+  int used;
+  while (sscanf(text, " %15[a-z]=%15s%n", key, value, &used) == 2) {
+    text += used;
+    unsigned long number = strtoul(value, nullptr, 0);
+    if (!strcmp(key, "debounce")) config.debounceMs = number;
+    else if (!strcmp(key, "heartbeat")) config.heartbeatMs = number;
+    else if (!strcmp(key, "coalesce")) config.coalesceMs = number;
+    else if (!strcmp(key, "enabled")) config.enabledMask = number;
+    else if (!strcmp(key, "dip")) config.dip = number;
+    else if (!strcmp(key, "loop")) config.loopUs = number;
+    else return false;
+  }
+  while (*text == ' ' || *text == '\t') text++;
+  return *text == '\0' && config.dip < 8 && config.loopUs > 0 && config.heartbeatMs > 0;
+}
+
+bool loadTrace(const std::string &path, Trace &trace, std::string &error) {
+  FILE *file = fopen(path.c_str(), "r");
+  if (!file) {
+    error = "cannot open " + path;
+    return false;
+  }
+  trace = Trace();
+  char line[256];
+  uint32_t number = 0;
+  bool ok = true;
+  while (ok && fgets(line, sizeof(line), file)) {
+    number++;
+    char *comment = strchr(line, '#');
+    if (comment) *comment = '\0';
+    line[strcspn(line, "\r\n")] = '\0';
+
+    unsigned long long timeUs;
+    unsigned raw;
+    unsigned permille;
+    char rest[2];
+    if (!strncmp(line, "config", 6)) {
+      ok = parseConfig(line + 6, trace.config);
+    } else if (sscanf(line, " load %llu %u %1s", &timeUs, &permille, rest) == 2) {
+      ok = permille <= 1000 && (trace.loads.empty() || timeUs >= trace.loads.back().timeUs);
+      trace.loads.push_back({ timeUs, (uint16_t)permille });
+    } else if (sscanf(line, " end %llu %1s", &timeUs, rest) == 1) {
+      trace.endUs = timeUs;
+    } else if (sscanf(line, " %llu %x %1s", &timeUs, &raw, rest) == 2) {
+      // Samples must not go back in time; equal times keep the later level
+      ok = trace.samples.empty() || timeUs >= trace.samples.back().timeUs;
+      trace.samples.push_back({ timeUs, (uint16_t)(raw & 0x03FF) });
+    } else {
+      ok = strspn(line, " \t") == strlen(line);
+    }
+  }
+  fclose(file);
+  if (!ok) {
+    error = path + ":" + std::to_string(number) + ": bad line";
+    return false;
+  }
+  if (trace.samples.empty()) {
+    error = path + ": no samples";
+    return false;
+  }
+  if (!trace.endUs) trace.endUs = trace.samples.back().timeUs + 1000000;
+  return true;
+}
+
+// (seconds.micros) iface ID#DATA, as written by writeFrames()
+bool loadFrames(const std::string &path, std::vector<ReplayFrame> &frames, std::string &error) {
+  FILE *file = fopen(path.c_str(), "r");
+  if (!file) {
+    error = "cannot open " + path;
+    return false;
+  }
+  frames.clear();
+  char line[128];
+  while (fgets(line, sizeof(line), file)) {
+    unsigned long long seconds, micros;
+    unsigned id;
+    char hex[17] = {};
+    if (sscanf(line, "(%llu.%6llu) %*s %x#%16[0-9A-Fa-f]", &seconds, &micros, &id, hex) < 3) {
+      continue;
+    }
+    ReplayFrame frame = {};
+    frame.timeUs = seconds * 1000000 + micros;
+    frame.id = id;
+    frame.dlc = strlen(hex) / 2;
+    for (uint8_t i = 0; i < frame.dlc; i++) {
+      char byte[3] = { hex[i * 2], hex[i * 2 + 1], '\0' };
+      frame.data[i] = (uint8_t)strtoul(byte, nullptr, 16);
+    }
+    frames.push_back(frame);
+  }
+  fclose(file);
+  return true;
+}
+
+bool writeFrames(const std::string &path, const std::vector<ReplayFrame> &frames) {
+  FILE *file = fopen(path.c_str(), "w");
+  if (!file) return false;
+  for (const ReplayFrame &frame : frames) {
+    fprintf(file, "(%llu.%06llu) replay %03X#", (unsigned long long)(frame.timeUs / 1000000),
+            (unsigned long long)(frame.timeUs % 1000000), frame.id);
+    for (uint8_t i = 0; i < frame.dlc; i++) fprintf(file, "%02X", frame.data[i]);
+    fprintf(file, "\n");
+  }
+  return fclose(file) == 0;
+}
+
+// =============================================================================
+// Replay
+// =============================================================================
+
+// DoorPipeline::EdgeReader over the per-channel edge latch
+static int64_t latchedEdgeUs(uint8_t channel, void *context) {
+  return static_cast<const int64_t *>(context)[channel];
+}
+
+// One pass of the polling build's loop() per config.loopUs: the same
+// DoorPipeline calls as readDebouncedSwitches(), serviceBusLoad(),
+// sendDueDoorStatus() and serviceTxMailbox() in src/main.cpp. The IRAM edge
+// latch is exact here: the trace provides every edge time. Other nodes'
+// traffic only adds bus load; each of the module's frames completes one
+// frame time after it is handed to the driver.
+std::vector<ReplayFrame> replayTrace(const Trace &trace) {
+  const TraceConfig &config = trace.config;
+  ReedChannelConfig channels[ModuleConfig::CHANNELS];
+  for (uint8_t i = 0; i < ModuleConfig::CHANNELS; i++) {
+    channels[i] = { (config.enabledMask & (1 << i)) != 0, 0, config.debounceMs };
+  }
+  ModuleConfig moduleConfig = DEFAULT_CONFIG;
+  moduleConfig.heartbeatMs = config.heartbeatMs;
+  HeartbeatStep steps[ModuleConfigCodec::HEARTBEAT_STEPS];
+  ModuleConfigCodec::heartbeatSteps(moduleConfig, steps);
+  SimBus timing(CanIdPlan::BITRATE);
+
+  uint16_t raw = trace.samples.front().raw;
+  size_t next = 1;
+  int64_t latchedUs[ModuleConfig::CHANNELS];
+  for (int64_t &latched : latchedUs) latched = -1;
+
+  uint64_t nowUs = trace.samples.front().timeUs;
+  ReedDebouncer debouncer;
+  DoorReporter reporter;
+  DoorPipeline pipeline(debouncer, reporter);
+  debouncer.begin(channels, ModuleConfig::CHANNELS, raw, (uint32_t)(nowUs / 1000));
+  pipeline.begin(debouncer.state(), config.heartbeatMs,
+                 CanIdPlan::id(CanIdPlan::DOOR_EVENT, config.dip),
+                 CanIdPlan::id(CanIdPlan::DOOR_HEARTBEAT, config.dip));
+  reporter.setCoalesceWindow(config.coalesceMs);
+  reporter.setBackoff(steps, ModuleConfigCodec::HEARTBEAT_STEPS);
+  TxMailbox mailbox;
+  BusLoadMonitor busLoad;
+  busLoad.begin(CanIdPlan::BITRATE, (uint32_t)(nowUs / 1000));
+  uint64_t txDoneUs = 0;
+  bool txPending = false;
+
+  // Other nodes' traffic as 8-byte frames, in bit-microseconds owed
+  size_t nextLoad = 0;
+  uint16_t backgroundPermille = 0;
+  uint64_t backgroundBits = 0;
+  const uint64_t backgroundFrame = (uint64_t)BusLoadMonitor::frameBits(8, false) * 1000000;
+
+  std::vector<ReplayFrame> frames;
+  for (; nowUs <= trace.endUs; nowUs += config.loopUs) {
+    uint32_t nowMs = (uint32_t)(nowUs / 1000);
+    if (txPending && nowUs >= txDoneUs) {
+      mailbox.transmitted(true);
+      txPending = false;
+    }
+
+    // Pin edges up to now, latched per channel like the edge interrupt
+    for (; next < trace.samples.size() && trace.samples[next].timeUs <= nowUs; next++) {
+      uint16_t edges = raw ^ trace.samples[next].raw;
+      raw = trace.samples[next].raw;
+      for (uint8_t i = 0; i < ModuleConfig::CHANNELS; i++) {
+        if (edges & (1 << i)) latchedUs[i] = trace.samples[next].timeUs;
+      }
+    }
+
+    // Frames received from other nodes (onCanRx())
+    for (; nextLoad < trace.loads.size() && trace.loads[nextLoad].timeUs <= nowUs; nextLoad++) {
+      backgroundPermille = trace.loads[nextLoad].permille;
+    }
+    backgroundBits += (uint64_t)backgroundPermille * CanIdPlan::BITRATE * config.loopUs / 1000;
+    for (; backgroundBits >= backgroundFrame; backgroundBits -= backgroundFrame) {
+      busLoad.addFrame(8);
+    }
+
+    // readDebouncedSwitches()
+    pipeline.sample(raw, 0, nowUs, nowMs, latchedEdgeUs, latchedUs);
+
+    // serviceBusLoad()
+    if (busLoad.update(nowMs)) pipeline.applyBusLoad(busLoad.loadPermille());
+
+    // sendDueDoorStatus()
+    CanFrame due[2];
+    uint8_t send = pipeline.report(nowMs, due);
+    if (send & DoorReporter::SEND_EVENT) mailbox.post(due[0]);
+    if (send & DoorReporter::SEND_HEARTBEAT) mailbox.post(due[1]);
+
+    // serviceTxMailbox()
+    CanFrame frame;
+    if (mailbox.next(nowMs, frame)) {
+      pipeline.queued(frame, nowUs, nowUs);
+      ReplayFrame out = { nowUs, frame.id, frame.dlc, {} };
+      memcpy(out.data, frame.data, sizeof(out.data));
+      frames.push_back(out);
+      busLoad.addFrame(frame.dlc);
+      txPending = true;
+      txDoneUs = nowUs + timing.frameUs(frame.dlc);
+    }
+  }
+  return frames;
+}
+
+// =============================================================================
+// Comparison
+// =============================================================================
+
+struct StateChange {
+  uint64_t timeUs;
+  uint16_t state;
+};
+
+static void countFrames(const std::vector<ReplayFrame> &frames, int32_t &events,
+                        int32_t &heartbeats, std::vector<StateChange> &changes) {
+  events = heartbeats = 0;
+  bool first = true;
+  uint16_t last = 0;
+  for (const ReplayFrame &frame : frames) {
+    bool event = CanIdPlan::contains(CanIdPlan::DOOR_EVENT, frame.id);
+    bool heartbeat = CanIdPlan::contains(CanIdPlan::DOOR_HEARTBEAT, frame.id);
+    if (!event && !heartbeat) continue;
+    events += event;
+    heartbeats += heartbeat;
+    uint16_t state = frame.data[0] | ((frame.data[1] & 0x03) << 8);
+    // The first frame sets the state; the first frame carrying each new
+    // state marks when the change became visible on the bus
+    if (first || state != last) changes.push_back({ frame.timeUs, state });
+    first = false;
+    last = state;
+  }
+}
+
+ReplayDiff compareFrames(const std::vector<ReplayFrame> &golden,
+                         const std::vector<ReplayFrame> &current) {
+  ReplayDiff diff = {};
+  diff.identical = golden.size() == current.size();
+  for (size_t i = 0; diff.identical && i < golden.size(); i++) {
+    const ReplayFrame &a = golden[i];
+    const ReplayFrame &b = current[i];
+    diff.identical = a.timeUs == b.timeUs && a.id == b.id && a.dlc == b.dlc &&
+                     !memcmp(a.data, b.data, a.dlc);
+  }
+
+  std::vector<StateChange> changes[2];
+  countFrames(golden, diff.events[0], diff.heartbeats[0], changes[0]);
+  countFrames(current, diff.events[1], diff.heartbeats[1], changes[1]);
+  diff.frames[0] = golden.size();
+  diff.frames[1] = current.size();
+
+  size_t common = std::min(changes[0].size(), changes[1].size());
+  diff.correct = changes[0].size() == changes[1].size();
+  double sum = 0;
+  for (size_t i = 0; i < common; i++) {
+    const StateChange &a = changes[0][i];
+    const StateChange &b = changes[1][i];
+    if (a.state != b.state) {
+      char text[128];
+      snprintf(text, sizeof(text), "change %zu: golden 0x%03X at %.3f s, now 0x%03X at %.3f s", i,
+               a.state, a.timeUs / 1e6, b.state, b.timeUs / 1e6);
+      diff.mismatch = text;
+      diff.correct = false;
+      break;
+    }
+    // The first frame only sets the state; it has no latency
+    if (i == 0) continue;
+    double deltaMs = ((double)b.timeUs - (double)a.timeUs) / 1000;
+    sum += deltaMs;
+    if (fabs(deltaMs) > fabs(diff.latencyMaxMs)) diff.latencyMaxMs = deltaMs;
+    diff.changes++;
+  }
+  diff.latencyMeanMs = diff.changes ? sum / diff.changes : 0;
+  if (!diff.correct && diff.mismatch.empty()) {
+    char text[96];
+    snprintf(text, sizeof(text), "%zu state changes in golden, %zu now", changes[0].size(),
+             changes[1].size());
+    diff.mismatch = text;
+  }
+  return diff;
+}
@@ -0,0 +1,86 @@
+#pragma once
+
+#include "ModuleConfig.h"
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+// =============================================================================
+// Golden Trace Replay
+// =============================================================================
+//
+// Replays raw reed pin levels through the firmware's door path - the
+// DoorPipeline the main loop runs, with its ReedDebouncer and DoorReporter,
+// plus the TxMailbox and BusLoadMonitor from src/ - under a simulated clock,
+// and compares the frames it hands to the driver against a stored golden
+// stream.
+//
+// Trace file, one directive or sample per line ('#' starts a comment):
+//
+//   config debounce=50 heartbeat=200 coalesce=10 enabled=0x3FF dip=0 loop=100
+//   0 0x000          time in us, raw pin levels (bit n = RSW(n+1) HIGH/open)
+//   1250000 0x001
+//   load 5000000 650 other nodes' bus load in permille from this time on
+//   end 20000000     replay length in us (default: last sample + 1 s)
+//
+// Unset config keys and the heartbeat back-off steps are the firmware
+// defaults (DEFAULT_CONFIG in ModuleConfig.h); the load directive drives the
+// back-off.
+//
+// Golden files are candump -L logs, so tools/can_latency.py and door_state
+// read them too.
+
+struct TraceConfig {
+  uint16_t debounceMs = DEFAULT_CONFIG.debounceMs;
+  uint16_t heartbeatMs = DEFAULT_CONFIG.heartbeatMs;
+  uint8_t coalesceMs = DEFAULT_CONFIG.coalesceMs;
+  uint16_t enabledMask = DEFAULT_CONFIG.enabledMask;
+  uint8_t dip = 0;
+  uint32_t loopUs = 100;  // Main loop pass period
+};
+
+struct TraceSample {
+  uint64_t timeUs;
+  uint16_t raw;
+};
+
+struct TraceLoad {
+  uint64_t timeUs;
+  uint16_t permille;
+};
+
+struct Trace {
+  TraceConfig config;
+  std::vector<TraceSample> samples;
+  std::vector<TraceLoad> loads;
+  uint64_t endUs = 0;
+};
+
+struct ReplayFrame {
+  uint64_t timeUs;  // Handed to the driver
+  uint32_t id;
+  uint8_t dlc;
+  uint8_t data[8];
+};
+
+// Both return false with a message in error
+bool loadTrace(const std::string &path, Trace &trace, std::string &error);
+bool loadFrames(const std::string &path, std::vector<ReplayFrame> &frames, std::string &error);
+
+std::vector<ReplayFrame> replayTrace(const Trace &trace);
+bool writeFrames(const std::string &path, const std::vector<ReplayFrame> &frames);
+
+struct ReplayDiff {
+  bool identical;  // Byte-for-byte, including times
+  bool correct;    // Same sequence of reported door states
+  std::string mismatch;  // First difference in the state sequence
+  int32_t frames[2];     // Golden, current
+  int32_t events[2];
+  int32_t heartbeats[2];
+  uint32_t changes;      // State changes compared
+  double latencyMeanMs;  // Current minus golden, per change
+  double latencyMaxMs;   // Largest absolute difference, signed
+};
+
+ReplayDiff compareFrames(const std::vector<ReplayFrame> &golden,
+                         const std::vector<ReplayFrame> &current);
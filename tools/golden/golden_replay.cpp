@@ -0,0 +1,198 @@
+// =============================================================================
+// Golden Trace Replay Tool
+// =============================================================================
+//
+// Replays door traces (raw reed pin levels, see TraceReplay.h) through the
+// firmware's debounce and transmit logic and checks the frames against the
+// stored golden streams, so a change to DoorPipeline, ReedDebouncer,
+// DoorReporter or TxMailbox shows what it does to the observable frames
+// before it ships.
+//
+// Build and run from the repository root:
+//
+//   g++ -std=c++17 -O2 -Iinclude -Itools/sim -Itools/golden -o golden_replay
+//       tools/golden/*.cpp tools/sim/SimBus.cpp src/DoorPipeline.cpp
+//       src/ReedDebouncer.cpp src/DoorReporter.cpp src/TxMailbox.cpp
+//       src/BusLoadMonitor.cpp src/ModuleConfig.cpp
+//   ./golden_replay check
+//
+// Commands:
+//   check [TRACE|DIR]...   Compare against TRACE's .golden file (default: all
+//                          traces in tools/golden/traces). Fails on a
+//                          different sequence of door states; frame count
+//                          and latency changes are reported. --strict also
+//                          fails when the streams are not byte-identical.
+//   update TRACE...        Rewrite the golden files from the current code.
+//   run TRACE              Print the frame stream as a candump -L log.
+//
+// --debounce-ms, --coalesce-ms and --heartbeat-ms override every trace's
+// config line, to see what a parameter change would do.
+
+#include "TraceReplay.h"
+#include <algorithm>
+#include <filesystem>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <vector>
+
+struct Options {
+  std::string command;
+  std::vector<std::string> paths;
+  bool strict = false;
+  int32_t debounceMs = -1;
+  int32_t coalesceMs = -1;
+  int32_t heartbeatMs = -1;
+};
+
+static const char *DEFAULT_TRACES = "tools/golden/traces";
+static const char *TRACE_EXTENSION = ".trace";
+static const char *GOLDEN_EXTENSION = ".golden";
+
+static void usage() {
+  fprintf(stderr,
+          "usage: golden_replay check [TRACE|DIR]... [--strict]\n"
+          "       golden_replay update TRACE...\n"
+          "       golden_replay run TRACE\n"
+          "       [--debounce-ms N] [--coalesce-ms N] [--heartbeat-ms N]\n");
+  exit(2);
+}
+
+static std::string goldenPath(const std::string &trace) {
+  std::filesystem::path path(trace);
+  path.replace_extension(GOLDEN_EXTENSION);
+  return path.string();
+}
+
+// Directories expand to their traces, sorted by name
+static std::vector<std::string> expandPaths(const std::vector<std::string> &paths) {
+  std::vector<std::string> traces;
+  for (const std::string &path : paths) {
+    if (!std::filesystem::is_directory(path)) {
+      traces.push_back(path);
+      continue;
+    }
+    std::vector<std::string> found;
+    for (const auto &entry : std::filesystem::directory_iterator(path)) {
+      if (entry.path().extension() == TRACE_EXTENSION) found.push_back(entry.path().string());
+    }
+    std::sort(found.begin(), found.end());
+    traces.insert(traces.end(), found.begin(), found.end());
+  }
+  return traces;
+}
+
+static bool replay(const Options &options, const std::string &path,
+                   std::vector<ReplayFrame> &frames) {
+  Trace trace;
+  std::string error;
+  if (!loadTrace(path, trace, error)) {
+    fprintf(stderr, "error: %s\n", error.c_str());
+    return false;
+  }
+  if (options.debounceMs >= 0) trace.config.debounceMs = options.debounceMs;
+  if (options.coalesceMs >= 0) trace.config.coalesceMs = options.coalesceMs;
+  if (options.heartbeatMs > 0) trace.config.heartbeatMs = options.heartbeatMs;
+  frames = replayTrace(trace);
+  return true;
+}
+
+static const char *signedCount(int32_t golden, int32_t current) {
+  static char text[32];
+  if (golden == current) return "";
+  snprintf(text, sizeof(text), " (%+d)", current - golden);
+  return text;
+}
+
+static int check(const Options &options) {
+  std::vector<std::string> traces = expandPaths(options.paths);
+  if (traces.empty()) {
+    fprintf(stderr, "error: no traces\n");
+    return 1;
+  }
+  uint32_t failed = 0;
+  for (const std::string &path : traces) {
+    std::string name = std::filesystem::path(path).stem().string();
+    std::vector<ReplayFrame> current;
+    std::vector<ReplayFrame> golden;
+    std::string error;
+    if (!replay(options, path, current)) {
+      failed++;
+      continue;
+    }
+    if (!loadFrames(goldenPath(path), golden, error)) {
+      printf("FAIL  %-20s %s (run update)\n", name.c_str(), error.c_str());
+      failed++;
+      continue;
+    }
+
+    ReplayDiff diff = compareFrames(golden, current);
+    bool pass = diff.correct && (diff.identical || !options.strict);
+    if (!pass) failed++;
+    printf("%-5s %-20s ", pass ? (diff.identical ? "OK" : "PASS") : "FAIL", name.c_str());
+    if (diff.identical) {
+      printf("%d frames identical\n", diff.frames[0]);
+      continue;
+    }
+    printf("frames %d -> %d%s", diff.frames[0], diff.frames[1],
+           signedCount(diff.frames[0], diff.frames[1]));
+    printf(", events %d -> %d%s", diff.events[0], diff.events[1],
+           signedCount(diff.events[0], diff.events[1]));
+    printf(", heartbeats %d -> %d%s\n", diff.heartbeats[0], diff.heartbeats[1],
+           signedCount(diff.heartbeats[0], diff.heartbeats[1]));
+    // Latency pairs changes up by position, which only means something while
+    // the state sequences agree
+    if (diff.correct) {
+      printf("      %-20s latency %+.1f ms mean, %+.1f ms max over %u changes\n", "",
+             diff.latencyMeanMs, diff.latencyMaxMs, diff.changes);
+    } else {
+      printf("      %-20s %s\n", "", diff.mismatch.c_str());
+    }
+  }
+  printf("%zu trace(s), %u failed\n", traces.size(), failed);
+  return failed ? 1 : 0;
+}
+
+static int update(const Options &options) {
+  for (const std::string &path : expandPaths(options.paths)) {
+    std::vector<ReplayFrame> frames;
+    if (!replay(options, path, frames)) return 1;
+    std::string golden = goldenPath(path);
+    if (!writeFrames(golden, frames)) {
+      fprintf(stderr, "error: cannot write %s\n", golden.c_str());
+      return 1;
+    }
+    printf("%s: %zu frames\n", golden.c_str(), frames.size());
+  }
+  return 0;
+}
+
+static int run(const Options &options) {
+  std::vector<ReplayFrame> frames;
+  if (options.paths.size() != 1 || !replay(options, options.paths[0], frames)) return 1;
+  return writeFrames("/dev/stdout", frames) ? 0 : 1;
+}
+
+int main(int argc, char **argv) {
+  Options options;
+  for (int i = 1; i < argc; i++) {
+    const char *arg = argv[i];
+    bool hasValue = i + 1 < argc;
+    if (!strcmp(arg, "--strict")) options.strict = true;
+    else if (!strcmp(arg, "--debounce-ms") && hasValue) options.debounceMs = atoi(argv[++i]);
+    else if (!strcmp(arg, "--coalesce-ms") && hasValue) options.coalesceMs = atoi(argv[++i]);
+    else if (!strcmp(arg, "--heartbeat-ms") && hasValue) options.heartbeatMs = atoi(argv[++i]);
+    else if (arg[0] != '-' && options.command.empty()) options.command = arg;
+    else if (arg[0] != '-') options.paths.push_back(arg);
+    else usage();
+  }
+
+  if (options.command == "check") {
+    if (options.paths.empty()) options.paths.push_back(DEFAULT_TRACES);
+    return check(options);
+  }
+  if (options.command == "update" && !options.paths.empty()) return update(options);
+  if (options.command == "run") return run(options);
+  usage();
+}
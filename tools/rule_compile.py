@@ -0,0 +1,311 @@
+#!/usr/bin/env python3
+"""Compile derived-signal rules for Cabinet & Door Sensor modules.
+
+Rules are boolean expressions over the module's reed channels (1-10, 1 =
+open), bits of frames received from other nodes and hold timers. They are
+compiled into the RuleEngine bytecode (include/RuleEngine.h), with channel
+terms folded into precomputed masks, and pushed through the bulk
+configuration transport (see tools/can_config.py). Rule n drives bit n of the
+module's derived-signal frame on 0x012 + dip.
+
+    # ignition.rules
+    signal ignition = 0x1B0 byte 0 mask 0x01
+    rule latched = closed(1-10)
+    rule open_while_driving = ignition and open(1-10)
+    rule left_open = held(open(5, 6), 30000)
+
+    python3 tools/rule_compile.py ignition.rules
+    python3 tools/rule_compile.py ignition.rules --push --iface can0 --address 0 1 2
+    python3 tools/rule_compile.py --clear --push --iface can0
+
+Expressions: `or`, `and`, `xor`, `not`, parentheses, signal and earlier rule
+names, and
+    open(channels)      any listed channel open
+    closed(channels)    every listed channel closed
+    all_open(channels)  every listed channel open
+    any_closed(channels)
+    held(expr, ms)      expr has been true for ms (up to 65535)
+Channel lists are numbers and ranges: `1, 3, 5-8`.
+"""
+
+import argparse
+import re
+import sys
+
+VERSION = 1
+MAX_PROGRAM = 128
+MAX_SIGNALS = 8
+MAX_RULES = 8
+MAX_TIMERS = 8
+CHANNELS = 10
+KIND_RULES = 1
+
+OP_CHANNEL = 0x01
+OP_SIGNAL = 0x02
+OP_RULE = 0x03
+OP_ANY_OPEN = 0x04
+OP_ALL_OPEN = 0x05
+OP_NOT = 0x10
+OP_AND = 0x11
+OP_OR = 0x12
+OP_XOR = 0x13
+OP_HELD = 0x20
+
+TOKEN = re.compile(r"\s*(?:(\d+)|([A-Za-z_]\w*)|(.))")
+
+
+class CompileError(Exception):
+    pass
+
+
+class Parser:
+    """Recursive descent over one expression, producing a small AST:
+    ("any", mask), ("all", mask), ("sig", n), ("rule", n), ("not", x),
+    ("and" | "or" | "xor", [x, ...]), ("held", x, ms)."""
+
+    def __init__(self, text, signals, rules):
+        self.tokens = [m.group(m.lastindex) for m in TOKEN.finditer(text) if m.lastindex]
+        self.pos = 0
+        self.signals = signals
+        self.rules = rules
+
+    def peek(self):
+        return self.tokens[self.pos] if self.pos < len(self.tokens) else None
+
+    def take(self, expected=None):
+        token = self.peek()
+        if token is None or (expected is not None and token != expected):
+            raise CompileError(f"expected {expected or 'more input'}, got {token!r}")
+        self.pos += 1
+        return token
+
+    def parse(self):
+        node = self.binary(0)
+        if self.peek() is not None:
+            raise CompileError(f"unexpected {self.peek()!r}")
+        return node
+
+    LEVELS = ["or", "xor", "and"]
+
+    def binary(self, level):
+        if level == len(self.LEVELS):
+            return self.unary()
+        op = self.LEVELS[level]
+        terms = [self.binary(level + 1)]
+        while self.peek() == op:
+            self.take()
+            terms.append(self.binary(level + 1))
+        return terms[0] if len(terms) == 1 else (op, terms)
+
+    def unary(self):
+        token = self.take()
+        if token == "not":
+            return ("not", self.unary())
+        if token == "(":
+            node = self.binary(0)
+            self.take(")")
+            return node
+        if token in ("open", "closed", "all_open", "any_closed"):
+            self.take("(")
+            mask = self.channels()
+            self.take(")")
+            if token == "open":
+                return ("any", mask)
+            if token == "closed":
+                return ("not", ("any", mask))
+            if token == "all_open":
+                return ("all", mask)
+            return ("not", ("all", mask))
+        if token == "held":
+            self.take("(")
+            node = self.binary(0)
+            self.take(",")
+            ms = int(self.take())
+            self.take(")")
+            if ms > 0xFFFF:
+                raise CompileError("held() time is at most 65535 ms")
+            return ("held", node, ms)
+        if token in self.signals:
+            return ("sig", self.signals[token])
+        if token in self.rules:
+            return ("rule", self.rules[token])
+        raise CompileError(f"unknown name {token!r}")
+
+    def channels(self):
+        mask = 0
+        while True:
+            first = int(self.take())
+            last = first
+            if self.peek() == "-":
+                self.take()
+                last = int(self.take())
+            if not 1 <= first <= last <= CHANNELS:
+                raise CompileError(f"channels are 1-{CHANNELS}")
+            for channel in range(first, last + 1):
+                mask |= 1 << (channel - 1)
+            if self.peek() != ",":
+                return mask
+            self.take()
+
+
+def fold(node):
+    """Merge channel terms into single masks:
+    open(a) or open(b) -> open(a|b), closed(a) and closed(b) -> closed(a|b),
+    all_open(a) and all_open(b) -> all_open(a|b)."""
+    kind = node[0]
+    if kind == "not":
+        return ("not", fold(node[1]))
+    if kind == "held":
+        return ("held", fold(node[1]), node[2])
+    if kind not in ("and", "or"):
+        return node
+    terms = []
+    for term in (fold(t) for t in node[1]):
+        # Flatten nested operators of the same kind
+        terms.extend(term[1] if term[0] == kind else [term])
+    merged, rest = {}, []
+    for term in terms:
+        if kind == "or" and term[0] == "any":
+            merged["any"] = merged.get("any", 0) | term[1]
+        elif kind == "and" and term[0] == "all":
+            merged["all"] = merged.get("all", 0) | term[1]
+        elif kind == "and" and term[0] == "not" and term[1][0] == "any":
+            merged["closed"] = merged.get("closed", 0) | term[1][1]
+        else:
+            rest.append(term)
+    for key, mask in merged.items():
+        rest.append(("not", ("any", mask)) if key == "closed" else (key, mask))
+    return rest[0] if len(rest) == 1 else (kind, rest)
+
+
+class Emitter:
+    def __init__(self):
+        self.timers = 0
+
+    def emit(self, node):
+        kind = node[0]
+        if kind in ("any", "all"):
+            mask = node[1]
+            if kind == "any" and mask & (mask - 1) == 0:
+                return bytes([OP_CHANNEL, mask.bit_length() - 1])
+            return bytes([OP_ANY_OPEN if kind == "any" else OP_ALL_OPEN, mask & 0xFF, mask >> 8])
+        if kind == "sig":
+            return bytes([OP_SIGNAL, node[1]])
+        if kind == "rule":
+            return bytes([OP_RULE, node[1]])
+        if kind == "not":
+            return self.emit(node[1]) + bytes([OP_NOT])
+        if kind == "held":
+            if self.timers == MAX_TIMERS:
+                raise CompileError(f"at most {MAX_TIMERS} held() timers")
+            timer = self.timers
+            self.timers += 1
+            return self.emit(node[1]) + bytes([OP_HELD, timer, node[2] & 0xFF, node[2] >> 8])
+        op = {"and": OP_AND, "or": OP_OR, "xor": OP_XOR}[kind]
+        code = self.emit(node[1][0])
+        for term in node[1][1:]:
+            code += self.emit(term) + bytes([op])
+        return code
+
+
+SIGNAL_LINE = re.compile(
+    r"signal\s+(\w+)\s*=\s*(0x[0-9a-fA-F]+|\d+)\s+byte\s+(\d+)\s+mask\s+(0x[0-9a-fA-F]+|\d+)$")
+RULE_LINE = re.compile(r"rule\s+(\w+)\s*=\s*(.+)$")
+
+
+def compile_rules(text):
+    """Return (program bytes, [rule names])."""
+    signals, rules, signal_specs, rule_code = {}, {}, [], []
+    emitter = Emitter()
+    for number, line in enumerate(text.splitlines(), 1):
+        line = line.split("#", 1)[0].strip()
+        if not line:
+            continue
+        try:
+            match = SIGNAL_LINE.match(line)
+            if match:
+                name, can_id, byte, mask = match.groups()
+                can_id, byte, mask = int(can_id, 0), int(byte), int(mask, 0)
+                if len(signals) == MAX_SIGNALS:
+                    raise CompileError(f"at most {MAX_SIGNALS} signals")
+                if can_id > 0x7FF or byte > 7 or not 0 < mask <= 0xFF:
+                    raise CompileError("signal needs an 11-bit ID, byte 0-7 and a mask")
+                signals[name] = len(signal_specs)
+                signal_specs.append(bytes([can_id & 0xFF, can_id >> 8, byte, mask]))
+                continue
+            match = RULE_LINE.match(line)
+            if not match:
+                raise CompileError("expected `signal ...` or `rule NAME = EXPR`")
+            name, expression = match.groups()
+            if name in rules or name in signals:
+                raise CompileError(f"{name!r} is already defined")
+            if len(rules) == MAX_RULES:
+                raise CompileError(f"at most {MAX_RULES} rules")
+            code = emitter.emit(fold(Parser(expression, signals, rules).parse()))
+            if len(code) > 0xFF:
+                raise CompileError("rule too long")
+            rules[name] = len(rule_code)
+            rule_code.append(code)
+        except (CompileError, ValueError) as error:
+            raise CompileError(f"line {number}: {error}") from None
+
+    program = bytes([VERSION, len(signal_specs)]) + b"".join(signal_specs)
+    program += bytes([len(rule_code)]) + b"".join(bytes([len(c)]) + c for c in rule_code)
+    if len(program) > MAX_PROGRAM:
+        raise CompileError(f"program is {len(program)} bytes, limit {MAX_PROGRAM}")
+    return program, list(rules)
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__,
+                                     formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("rules", nargs="?", help="rule file")
+    parser.add_argument("--clear", action="store_true", help="compile an empty program")
+    parser.add_argument("--push", action="store_true", help="push to modules and verify")
+    parser.add_argument("--iface", default="can0", help="SocketCAN interface")
+    parser.add_argument("--address", type=int, nargs="+", default=list(range(8)),
+                        help="DIP addresses to target (default all)")
+    parser.add_argument("--timeout-ms", type=float, default=200.0)
+    args = parser.parse_args()
+
+    if args.clear:
+        text = ""
+    elif args.rules:
+        text = open(args.rules).read()
+    else:
+        parser.error("give a rule file or --clear")
+    try:
+        program, names = compile_rules(text)
+    except CompileError as error:
+        sys.exit(f"error: {error}")
+
+    for bit, name in enumerate(names):
+        print(f"bit {bit}: {name}")
+    print(f"program {program.hex()} ({len(program)} bytes)")
+    if not args.push:
+        return
+
+    import can_auth
+    import can_config
+    from can_ota_send import Bus
+
+    bus = Bus(args.iface)
+    addresses = sorted(set(args.address))
+    timeout = args.timeout_ms / 1000
+    acked, errors = can_config.push(bus, program, addresses, can_auth.from_environment(),
+                                    timeout, kind=KIND_RULES, version=VERSION)
+    states, query_errors = can_config.query(bus, addresses, timeout, kind=KIND_RULES)
+    expected = can_config.config_hash(program)
+    failed = 0
+    for address in addresses:
+        error = errors.get(address) or query_errors.get(address)
+        if error is None and states[address][0] != expected:
+            error = f"running {states[address][0].hex()}"
+        print(f"module {address}: {error or 'ok'}")
+        failed += error is not None
+    if failed:
+        sys.exit(f"error: {failed} module(s) not running {expected.hex()}")
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,64 @@
+#include "EnergyModel.h"
+#include <stdlib.h>
+#include <string.h>
+
+struct ProfileField {
+  const char *name;
+  double PowerProfile::*value;
+  const char *unit;
+};
+
+static const ProfileField FIELDS[] = {
+  { "active80", &PowerProfile::active80Ma, "mA" },
+  { "active160", &PowerProfile::active160Ma, "mA" },
+  { "light-sleep", &PowerProfile::lightSleepMa, "mA" },
+  { "lp-core", &PowerProfile::lpCoreMa, "mA" },
+  { "twai-tx", &PowerProfile::twaiTxMa, "mA" },
+  { "transceiver", &PowerProfile::transceiverMa, "mA" },
+  { "led", &PowerProfile::ledMa, "mA" },
+  { "pullup", &PowerProfile::pullupMa, "mA" },
+  { "lp-run", &PowerProfile::lpRunUs, "us" },
+  { "wake", &PowerProfile::wakeUs, "us" },
+  { "ldo-quiescent", &PowerProfile::ldoQuiescentMa, "mA" },
+  { "rail", &PowerProfile::railV, "V" },
+  { "buck-efficiency", &PowerProfile::buckEfficiency, "" },
+  { "battery", &PowerProfile::batteryV, "V" },
+};
+
+bool PowerProfile::set(const char *assignment) {
+  const char *equals = strchr(assignment, '=');
+  if (!equals) return false;
+  size_t length = equals - assignment;
+  for (const ProfileField &field : FIELDS) {
+    if (strlen(field.name) == length && !strncmp(field.name, assignment, length)) {
+      char *end;
+      double value = strtod(equals + 1, &end);
+      if (end == equals + 1 || *end) return false;
+      this->*field.value = value;
+      return true;
+    }
+  }
+  return false;
+}
+
+void PowerProfile::print(FILE *out) const {
+  for (const ProfileField &field : FIELDS) {
+    fprintf(out, "  %-16s %8.3f%s%s\n", field.name, this->*field.value, *field.unit ? " " : "",
+            field.unit);
+  }
+}
+
+double EnergyMeter::batteryMahPerDay(const PowerProfile &profile, uint64_t periodUs,
+                                     Consumer consumer) const {
+  if (!periodUs) return 0;
+  double railMa = charge[consumer] / periodUs;
+  return railMa * profile.batteryScale() * 24;
+}
+
+double EnergyMeter::batteryMahPerDay(const PowerProfile &profile, uint64_t periodUs) const {
+  double total = 0;
+  for (uint8_t c = 0; c < CONSUMER_COUNT; c++) {
+    total += batteryMahPerDay(profile, periodUs, (Consumer)c);
+  }
+  return total;
+}
@@ -0,0 +1,70 @@
+#pragma once
+
+#include <stdint.h>
+#include <stdio.h>
+
+// =============================================================================
+// CAN Bus Simulator - Energy Model
+// =============================================================================
+//
+// Per-state supply currents for one Cabinet & Door Sensor, charged against
+// the simulated module timeline, and the conversion from the 3.3 V rail to
+// the 12 V house battery through the board's 5 V buck converter and 3.3 V
+// LDO. The defaults are typical datasheet figures (ESP32-C6, SN65HVD230,
+// AMS1117); override them with values measured on a real board.
+
+enum class PowerMode {
+  POLLING,  // Default build: the HP core runs the loop continuously
+  LP_CORE,  // RSW_LP_CORE: HP core light-sleeps, LP core samples every 10 ms
+};
+
+struct PowerProfile {
+  // 3.3 V rail currents in mA
+  double active80Ma = 23.0;       // HP core running at 80 MHz, radio off
+  double active160Ma = 32.0;      // HP core running at 160 MHz, radio off
+  double lightSleepMa = 0.18;     // HP core in light sleep
+  double lpCoreMa = 0.8;          // LP core running a sample pass
+  double twaiTxMa = 4.0;          // Extra while one of the module's frames is on the wire
+  double transceiverMa = 10.0;    // SN65HVD230 with Rs grounded, always in high-speed mode
+  double ledMa = 0.6;             // Status LED controller idle
+  double pullupMa = 0.073;        // Per closed reed loop, 3.3 V over the ~45k internal pull-up
+
+  // Timings in us
+  double lpRunUs = 100;           // LP core run time per 10 ms sample
+  double wakeUs = 1500;           // HP light-sleep exit, loop pass and re-entry
+
+  // Supply chain
+  double ldoQuiescentMa = 5.0;    // AMS1117 ground current, drawn from the 5 V rail
+  double railV = 5.0;
+  double buckEfficiency = 0.85;
+  double batteryV = 12.8;
+
+  // Set one value from "name=value" (names as listed by print()); false if unknown
+  bool set(const char *assignment);
+  void print(FILE *out) const;
+
+  // mA on the 3.3 V rail to mA at the battery (the LDO passes its load current)
+  double batteryScale() const { return railV / (buckEfficiency * batteryV); }
+};
+
+// Charge drawn on the 3.3 V rail by each consumer, in mA*us
+class EnergyMeter {
+public:
+  enum Consumer {
+    CPU_ACTIVE,
+    CPU_SLEEP,
+    LP_CORE,
+    TWAI_TX,
+    BOARD,  // Transceiver, LED, reed pull-ups and LDO ground current
+    CONSUMER_COUNT,
+  };
+
+  void add(Consumer consumer, double mA, double us) { charge[consumer] += mA * us; }
+
+  // Average draw at the battery over periodUs, scaled to one day
+  double batteryMahPerDay(const PowerProfile &profile, uint64_t periodUs, Consumer consumer) const;
+  double batteryMahPerDay(const PowerProfile &profile, uint64_t periodUs) const;
+
+private:
+  double charge[CONSUMER_COUNT] = {};
+};
@@ -0,0 +1,52 @@
+#include "SimBus.h"
+
+// Standard 11-bit frame: SOF, ID, RTR, IDE, r0, DLC, data and CRC are
+// stuffed (34 + 8n bits), then CRC delimiter, ACK and EOF (10 bits) and the
+// 3-bit interframe space
+uint32_t SimBus::frameBits(uint8_t dlc) {
+  uint32_t stuffed = 34 + 8 * dlc;
+  return stuffed + (stuffed - 1) / 4 + 10 + 3;
+}
+
+uint32_t SimBus::frameUs(uint8_t dlc) const {
+  return (uint32_t)(frameBits(dlc) * bitUs + 0.5);
+}
+
+void SimBus::run(uint64_t untilUs) {
+  SimNode *sender = nullptr;
+  uint64_t doneUs = 0;
+
+  while (now <= untilUs) {
+    if (sender && now >= doneUs) {
+      SimFrame frame = sender->txQueue.front();
+      sender->txQueue.pop_front();
+      frames++;
+      sender->transmitted(frame, now);
+      sender = nullptr;
+    }
+
+    for (SimNode *node : nodes) {
+      while (node->nextWakeUs() <= now) node->wake(now);
+    }
+
+    if (!sender) {
+      for (SimNode *node : nodes) {
+        if (node->txQueue.empty()) continue;
+        if (!sender || node->txQueue.front().id < sender->txQueue.front().id) sender = node;
+      }
+      if (sender) {
+        uint32_t duration = frameUs(sender->txQueue.front().dlc);
+        doneUs = now + duration;
+        busyUs += duration;
+      }
+    }
+
+    uint64_t next = sender ? doneUs : UINT64_MAX;
+    for (SimNode *node : nodes) {
+      uint64_t wake = node->nextWakeUs();
+      if (wake < next) next = wake;
+    }
+    if (next == UINT64_MAX) break;
+    now = next;
+  }
+}
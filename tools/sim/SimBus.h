@@ -0,0 +1,67 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <deque>
+#include <vector>
+
+// =============================================================================
+// CAN Bus Simulator - Bus Model
+// =============================================================================
+//
+// Discrete-event model of one classic CAN bus at frame granularity. Every
+// node owns a FIFO driver queue like the TWAI driver; whenever the bus goes
+// idle the queue heads arbitrate and the lowest ID wins. Frame lengths use
+// worst-case bit stuffing, so latencies are upper bounds for the traffic mix.
+
+struct SimFrame {
+  uint32_t id;
+  uint8_t dlc;
+  uint8_t data[8];
+  uint64_t queuedUs;  // When the frame entered the driver queue
+  uint32_t tag;       // Simulator bookkeeping, not on the wire
+};
+
+class SimNode {
+public:
+  virtual ~SimNode() = default;
+
+  // Next time the node wants to run; wake() must move it forward
+  virtual uint64_t nextWakeUs() const = 0;
+  virtual void wake(uint64_t nowUs) = 0;
+
+  // The queue head finished transmitting at nowUs
+  virtual void transmitted(const SimFrame &frame, uint64_t nowUs) { (void)frame; (void)nowUs; }
+
+  void queue(const SimFrame &frame) { txQueue.push_back(frame); }
+  size_t queued() const { return txQueue.size(); }
+
+private:
+  friend class SimBus;
+  std::deque<SimFrame> txQueue;
+};
+
+class SimBus {
+public:
+  explicit SimBus(uint32_t bitrate) : bitUs(1000000.0 / bitrate) {}
+
+  void addNode(SimNode *node) { nodes.push_back(node); }
+
+  // Run until simulated time reaches untilUs
+  void run(uint64_t untilUs);
+
+  uint64_t nowUs() const { return now; }
+  double load() const { return now ? (double)busyUs / now : 0.0; }
+  uint64_t framesSent() const { return frames; }
+
+  // Frame time on the wire including interframe space, worst-case stuffing
+  uint32_t frameUs(uint8_t dlc) const;
+  static uint32_t frameBits(uint8_t dlc);
+
+private:
+  double bitUs;
+  std::vector<SimNode *> nodes;
+  uint64_t now = 0;
+  uint64_t busyUs = 0;
+  uint64_t frames = 0;
+};
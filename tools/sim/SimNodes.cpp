@@ -0,0 +1,202 @@
+#include "SimNodes.h"
+#include "CanIdPlan.h"
+#include <algorithm>
+#include <string.h>
+
+PeriodicNode::PeriodicNode(uint32_t id, uint8_t dlc, uint32_t periodUs, uint32_t phaseUs,
+                           uint32_t jitterUs, uint32_t seed)
+    : id(id), dlc(dlc), periodUs(periodUs), jitterUs(jitterUs),
+      releaseUs(phaseUs), nextUs(phaseUs), rng(seed) {}
+
+void PeriodicNode::wake(uint64_t nowUs) {
+  SimFrame frame = {};
+  frame.id = id;
+  frame.dlc = dlc;
+  frame.queuedUs = nowUs;
+  queue(frame);
+
+  releaseUs += periodUs;
+  nextUs = releaseUs;
+  if (jitterUs) nextUs += rng() % jitterUs;
+}
+
+DoorModuleNode::DoorModuleNode(uint8_t dip, DoorIdMode mode, uint32_t heartbeatMs,
+                               double changesPerSecond, uint32_t seed)
+    : dip(dip), mode(mode), heartbeatMs(heartbeatMs),
+      changesPerSecond(changesPerSecond), rng(seed) {
+  reporter.begin(state, heartbeatMs);
+  nextUs = rng() % (heartbeatMs * 1000);
+  std::exponential_distribution<double> gap(changesPerSecond);
+  nextChangeUs = nextUs + (uint64_t)(gap(rng) * 1e6);
+  changeUs.push_back(0);  // Sequence numbers start at 1
+}
+
+void DoorModuleNode::setBursts(uint8_t maxChannels, uint32_t spreadUs) {
+  burstChannels = maxChannels;
+  burstSpreadUs = spreadUs;
+}
+
+void DoorModuleNode::setScript(uint16_t initialState, const std::vector<ScriptedChange> &changes) {
+  script = changes;
+  scriptPos = 0;
+  scripted = true;
+  state = initialState;
+  reporter.begin(state, heartbeatMs);
+}
+
+void DoorModuleNode::setPower(PowerMode mode, uint32_t cpuMhz, const PowerProfile &power,
+                              uint32_t bitrate) {
+  powered = true;
+  powerMode = mode;
+  profile = power;
+  activeMa = cpuMhz >= 160 ? power.active160Ma : power.active80Ma;
+  bitUs = 1e6 / bitrate;
+}
+
+void DoorModuleNode::account(uint64_t toUs) {
+  if (!powered || toUs <= accountedUs) return;
+  double span = toUs - accountedUs;
+
+  // Every closed reed loop draws through its pull-up whatever the core does
+  uint8_t closed = 10 - __builtin_popcount(state & 0x3FF);
+  meter.add(EnergyMeter::BOARD,
+            profile.transceiverMa + profile.ledMa + profile.ldoQuiescentMa + closed * profile.pullupMa,
+            span);
+
+  if (powerMode == PowerMode::POLLING) {
+    meter.add(EnergyMeter::CPU_ACTIVE, activeMa, span);
+  } else {
+    uint64_t awakeEnd = hpAwakeUntilUs;
+    if (draining) awakeEnd = std::max(awakeEnd, std::min(toUs, drainDeadlineUs));
+    double awake = awakeEnd > accountedUs ? std::min(awakeEnd, toUs) - accountedUs : 0;
+    meter.add(EnergyMeter::CPU_ACTIVE, activeMa, awake);
+    meter.add(EnergyMeter::CPU_SLEEP, profile.lightSleepMa, span - awake);
+    meter.add(EnergyMeter::LP_CORE, profile.lpCoreMa, span * profile.lpRunUs / LP_SAMPLE_PERIOD_US);
+  }
+  accountedUs = toUs;
+}
+
+void DoorModuleNode::changed(uint64_t nowUs) {
+  changeSeq++;
+  changeUs.push_back(nowUs);
+  // In low-power mode a confirmed change wakes the HP core
+  if (powered && powerMode == PowerMode::LP_CORE) {
+    hpAwakeUntilUs = std::max(hpAwakeUntilUs, nowUs + (uint64_t)profile.wakeUs);
+  }
+}
+
+// Next loop pass that can change anything: a toggle, a due frame or the
+// next incident. Frames in the mailbox keep the normal loop period.
+uint64_t DoorModuleNode::idleWakeUs(uint64_t nowUs) const {
+  uint64_t next = nowUs + LOOP_PERIOD_US;
+  if (!toggles.empty() || mailbox.busy() || mode == DoorIdMode::PERIODIC) return next;
+  uint32_t nowMs = (uint32_t)(nowUs / 1000);
+  uint64_t dueUs = ((uint64_t)nowMs + reporter.msUntilDue(nowMs)) * 1000;
+  uint64_t changeAt = nextChangeUs;
+  if (scripted) changeAt = scriptPos < script.size() ? script[scriptPos].atUs : UINT64_MAX;
+  return std::max(next, std::min(dueUs, changeAt));
+}
+
+void DoorModuleNode::post(uint32_t id, uint32_t seq, uint16_t frameState, uint64_t nowUs) {
+  CanFrame frame = {};
+  frame.id = id;
+  frame.dlc = 8;
+  frame.data[0] = frameState & 0xFF;
+  frame.data[1] = (frameState >> 8) & 0x03;
+  mailbox.post(frame);
+  // The mailbox keeps the latest frame per ID, so its sequence is the latest
+  slotSeq[id] = seq;
+  postedSeq = seq;
+
+  // Low-power firmware stays awake until the frame has left the bus, or
+  // for at most LP_TX_DRAIN_TIMEOUT_MS
+  if (powered && powerMode == PowerMode::LP_CORE) {
+    hpAwakeUntilUs = std::max(hpAwakeUntilUs, nowUs + (uint64_t)profile.wakeUs);
+    draining = true;
+    drainDeadlineUs = nowUs + LP_TX_DRAIN_TIMEOUT_US;
+  }
+}
+
+void DoorModuleNode::wake(uint64_t nowUs) {
+  account(nowUs);
+  uint32_t nowMs = (uint32_t)(nowUs / 1000);
+
+  if (scripted) {
+    while (scriptPos < script.size() && script[scriptPos].atUs <= nowUs) {
+      const ScriptedChange &change = script[scriptPos++];
+      if (((state >> change.channel) & 1) == change.open) continue;
+      state ^= 1 << change.channel;
+      changed(nowUs);
+    }
+  } else if (nowUs >= nextChangeUs) {
+    // One incident trips up to burstChannels reed switches a few ms apart
+    uint8_t channels = 1 + rng() % burstChannels;
+    uint8_t first = rng() % 10;
+    for (uint8_t i = 0; i < channels; i++) {
+      uint64_t offset = (i && burstSpreadUs) ? rng() % burstSpreadUs : 0;
+      toggles.push_back({ nowUs + offset, (uint8_t)((first + i) % 10) });
+    }
+    std::exponential_distribution<double> gap(changesPerSecond);
+    nextChangeUs = nowUs + 1 + (uint64_t)(gap(rng) * 1e6);
+  }
+  for (size_t i = 0; i < toggles.size();) {
+    if (toggles[i].atUs > nowUs) {
+      i++;
+      continue;
+    }
+    state ^= 1 << toggles[i].channel;
+    changed(nowUs);
+    toggles.erase(toggles.begin() + i);
+  }
+
+  uint32_t eventId = CanIdPlan::id(CanIdPlan::DOOR_EVENT, dip);
+  uint32_t heartbeatId = CanIdPlan::id(CanIdPlan::DOOR_HEARTBEAT, dip);
+  if (mode == DoorIdMode::PERIODIC) {
+    // Baseline firmware: state on 0x0A + dip, only when the interval is due
+    if (nowMs - lastPeriodicMs >= heartbeatMs) {
+      lastPeriodicMs = nowMs;
+      post(eventId, changeSeq, state, nowUs);
+    }
+  } else {
+    uint8_t due = reporter.update(state, nowMs);
+    if (mode == DoorIdMode::SHARED) heartbeatId = eventId;
+    if (mode == DoorIdMode::ROUTINE) eventId = heartbeatId;
+    if (due & DoorReporter::SEND_EVENT) post(eventId, changeSeq, reporter.lastState(), nowUs);
+    if (due & DoorReporter::SEND_HEARTBEAT) post(heartbeatId, changeSeq, reporter.lastState(), nowUs);
+
+    // Changes that cancelled out (a switch flipping back inside the
+    // coalescing window) never need a frame and have no latency
+    if (state == reporter.lastState()) {
+      while (postedSeq < changeSeq) changeUs[++postedSeq] = UINT64_MAX;
+    }
+  }
+
+  CanFrame frame;
+  if (mailbox.next(nowMs, frame)) {
+    SimFrame simFrame = {};
+    simFrame.id = frame.id;
+    simFrame.dlc = frame.dlc;
+    memcpy(simFrame.data, frame.data, sizeof(frame.data));
+    simFrame.queuedUs = nowUs;
+    simFrame.tag = slotSeq[frame.id];
+    queue(simFrame);
+  }
+
+  nextUs = powered ? idleWakeUs(nowUs) : nowUs + LOOP_PERIOD_US;
+}
+
+void DoorModuleNode::transmitted(const SimFrame &frame, uint64_t nowUs) {
+  mailbox.transmitted(true);
+  if (powered) {
+    meter.add(EnergyMeter::TWAI_TX, profile.twaiTxMa, SimBus::frameBits(frame.dlc) * bitUs);
+    if (draining && !mailbox.busy()) {
+      draining = false;
+      hpAwakeUntilUs = std::max(hpAwakeUntilUs, std::min(nowUs, drainDeadlineUs));
+    }
+  }
+  while (deliveredSeq < frame.tag) {
+    deliveredSeq++;
+    if (changeUs[deliveredSeq] == UINT64_MAX) continue;
+    latencies.push_back((uint32_t)(nowUs - changeUs[deliveredSeq]));
+  }
+}
@@ -0,0 +1,134 @@
+#pragma once
+
+#include "SimBus.h"
+#include "DoorReporter.h"
+#include "EnergyModel.h"
+#include "TxMailbox.h"
+#include <map>
+#include <random>
+#include <vector>
+
+// =============================================================================
+// CAN Bus Simulator - Nodes
+// =============================================================================
+
+// Background traffic from other systems: one periodic frame with jitter
+class PeriodicNode : public SimNode {
+public:
+  PeriodicNode(uint32_t id, uint8_t dlc, uint32_t periodUs, uint32_t phaseUs,
+               uint32_t jitterUs, uint32_t seed);
+
+  uint64_t nextWakeUs() const override { return nextUs; }
+  void wake(uint64_t nowUs) override;
+
+private:
+  uint32_t id;
+  uint8_t dlc;
+  uint32_t periodUs;
+  uint32_t jitterUs;
+  uint64_t releaseUs;
+  uint64_t nextUs;
+  std::mt19937 rng;
+};
+
+// How a door module maps its status frames onto CAN IDs
+enum class DoorIdMode {
+  PERIODIC,  // Baseline firmware: state on 0x0A + dip at the heartbeat only
+  SHARED,    // Event on change, heartbeat on the same ID (0x0A + dip)
+  ROUTINE,   // Event on change, both on the routine heartbeat block
+  SPLIT,     // Event and heartbeat on separate blocks from CanIdPlan.h
+};
+
+// A debounced door change from an activity trace
+struct ScriptedChange {
+  uint64_t atUs;
+  uint8_t channel;
+  bool open;
+};
+
+// A Cabinet & Door Sensor running the firmware's DoorReporter and TxMailbox.
+// Door incidents arrive at random (Poisson) times, or from a script; the
+// change latency is the time from each debounced change until the first
+// frame carrying it has left the bus.
+class DoorModuleNode : public SimNode {
+public:
+  static const uint32_t LOOP_PERIOD_US = 100;
+  static const uint32_t LP_SAMPLE_PERIOD_US = 10000;
+  static const uint32_t LP_TX_DRAIN_TIMEOUT_US = 5000;
+
+  DoorModuleNode(uint8_t dip, DoorIdMode mode, uint32_t heartbeatMs,
+                 double changesPerSecond, uint32_t seed);
+
+  uint64_t nextWakeUs() const override { return nextUs; }
+  void wake(uint64_t nowUs) override;
+  void transmitted(const SimFrame &frame, uint64_t nowUs) override;
+
+  // Incidents trip 1..maxChannels switches spread over spreadUs (default 1)
+  void setBursts(uint8_t maxChannels, uint32_t spreadUs);
+  void setCoalesceWindow(uint32_t windowMs) { reporter.setCoalesceWindow(windowMs); }
+
+  // Replace the random incidents with changes sorted by time
+  void setScript(uint16_t initialState, const std::vector<ScriptedChange> &changes);
+
+  // Charge the module's supply current to an energy meter. The node then
+  // skips loop passes in which nothing can happen, which leaves its frames
+  // unchanged and makes day-long runs cheap.
+  void setPower(PowerMode mode, uint32_t cpuMhz, const PowerProfile &profile, uint32_t bitrate);
+
+  // Charge the time since the last loop pass, at the end of a run
+  void finishEnergy(uint64_t untilUs) { account(untilUs); }
+  const EnergyMeter &energy() const { return meter; }
+
+  const std::vector<uint32_t> &latenciesUs() const { return latencies; }
+  const DoorReporter &doorReporter() const { return reporter; }
+
+private:
+  struct Toggle {
+    uint64_t atUs;
+    uint8_t channel;
+  };
+
+  void post(uint32_t id, uint32_t changeSeq, uint16_t frameState, uint64_t nowUs);
+  void changed(uint64_t nowUs);
+  void account(uint64_t toUs);
+  uint64_t idleWakeUs(uint64_t nowUs) const;
+
+  uint8_t dip;
+  DoorIdMode mode;
+  uint32_t heartbeatMs;
+  DoorReporter reporter;
+  TxMailbox mailbox;
+  uint16_t state = 0;
+  uint64_t nextUs = 0;
+  uint32_t lastPeriodicMs = 0;
+  uint64_t nextChangeUs;
+  double changesPerSecond;
+  uint8_t burstChannels = 1;
+  uint32_t burstSpreadUs = 0;
+  std::vector<Toggle> toggles;
+  std::vector<ScriptedChange> script;
+  size_t scriptPos = 0;
+  bool scripted = false;
+  std::mt19937 rng;
+
+  // Energy model; the HP core is awake until hpAwakeUntilUs, or while a
+  // frame drains in low-power mode
+  bool powered = false;
+  PowerMode powerMode = PowerMode::POLLING;
+  PowerProfile profile;
+  double activeMa = 0;
+  double bitUs = 0;
+  EnergyMeter meter;
+  uint64_t accountedUs = 0;
+  uint64_t hpAwakeUntilUs = 0;
+  bool draining = false;
+  uint64_t drainDeadlineUs = 0;
+
+  // Changes not yet visible on the bus, by sequence number
+  uint32_t changeSeq = 0;
+  std::map<uint32_t, uint32_t> slotSeq;
+  uint32_t postedSeq = 0;
+  uint32_t deliveredSeq = 0;
+  std::vector<uint64_t> changeUs;
+  std::vector<uint32_t> latencies;
+};
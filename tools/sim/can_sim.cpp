@@ -0,0 +1,385 @@
+// =============================================================================
+// CAN Bus Simulator
+// =============================================================================
+//
+// Host-side simulation of a bus of Cabinet & Door Sensor modules among
+// background traffic. The modules run the firmware's own DoorReporter,
+// TxMailbox and CAN ID plan, compiled from src/ and include/.
+//
+// Build and run from the repository root:
+//
+//   g++ -std=c++17 -O2 -Iinclude -Itools/sim -o can_sim tools/sim/*.cpp
+//       src/DoorReporter.cpp src/TxMailbox.cpp
+//   ./can_sim priority-split --load 0.8 --seconds 120
+//
+// Scenarios:
+//   priority-split  Worst-case door change latency with event and heartbeat
+//                   frames on split ID blocks, against a shared status ID
+//                   and the periodic-only baseline.
+//   coalesce        Frames saved and latency added by the change coalescing
+//                   window when incidents trip 1-3 switches within 5 ms.
+//   energy          Battery draw per module (mAh/day) for polling and
+//                   low-power builds, CPU clock and heartbeat interval.
+//
+// --trace replaces the random incidents with a door activity trace in the
+// CSV format of tools/can_history.py dump --csv.
+
+#include "CanIdPlan.h"
+#include "EnergyModel.h"
+#include "SimBus.h"
+#include "SimNodes.h"
+#include <algorithm>
+#include <math.h>
+#include <memory>
+#include <random>
+#include <set>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+
+struct Options {
+  std::string scenario = "priority-split";
+  double load = 0.8;
+  uint32_t seconds = 120;
+  uint32_t seed = 1;
+  uint8_t modules = 8;
+  double changesPerSecond = 2.0;
+  std::string trace;
+  double budgetMah = 0;
+  PowerProfile profile;
+
+  // Per module, from --trace
+  std::vector<std::vector<ScriptedChange>> scripts;
+  std::vector<uint16_t> scriptStates;
+};
+
+static const uint32_t BITRATE = CanIdPlan::BITRATE;
+static const uint32_t HEARTBEAT_MS = 200;
+
+struct Flow {
+  uint32_t id;
+  uint8_t dlc;
+  uint32_t periodUs;
+  uint32_t phaseUs;
+};
+
+static bool inPlan(uint32_t id) {
+  for (uint8_t b = 0; b < CanIdPlan::BLOCK_COUNT; b++) {
+    if (CanIdPlan::contains((CanIdPlan::Block)b, id)) return true;
+  }
+  return false;
+}
+
+// Periodic flows on IDs 0x005-0x0FF outside the plan (the range the other
+// trailer systems use) until their load reaches target
+static std::vector<Flow> backgroundFlows(double target, uint32_t seed) {
+  static const uint32_t PERIODS_MS[] = { 5, 10, 20, 50, 100, 200 };
+  SimBus timing(BITRATE);
+  std::mt19937 rng(seed);
+  std::set<uint32_t> used;
+  std::vector<Flow> flows;
+  double load = 0;
+
+  while (load < target) {
+    Flow flow;
+    do {
+      flow.id = 0x005 + rng() % (0x100 - 0x005);
+    } while (inPlan(flow.id) || used.count(flow.id));
+    used.insert(flow.id);
+    flow.dlc = 1 + rng() % 8;
+    // Flows start within 2 ms of each other, so equal periods burst together
+    flow.phaseUs = rng() % 2000;
+    uint8_t period = rng() % 6;
+    // Stretch the period rather than overshoot the target
+    while (period < 5 && load + (double)timing.frameUs(flow.dlc) / (PERIODS_MS[period] * 1000) > target + 0.002) {
+      period++;
+    }
+    flow.periodUs = PERIODS_MS[period] * 1000;
+    load += (double)timing.frameUs(flow.dlc) / flow.periodUs;
+    flows.push_back(flow);
+  }
+  return flows;
+}
+
+// Door module setup for one simulation run
+struct DoorSetup {
+  DoorIdMode mode;
+  uint32_t coalesceMs;
+  uint8_t burstChannels;
+  uint32_t burstSpreadUs;
+  bool energy = false;
+  PowerMode powerMode = PowerMode::POLLING;
+  uint32_t cpuMhz = 80;
+  uint32_t heartbeatMs = HEARTBEAT_MS;
+};
+
+struct Result {
+  double load;
+  size_t changes;
+  uint32_t events;
+  uint32_t saved;
+  double meanUs;
+  uint32_t p99Us;
+  uint32_t maxUs;
+  std::vector<EnergyMeter> energy;  // Per module, with DoorSetup::energy
+};
+
+static Result runDoorBus(const Options &options, const DoorSetup &setup) {
+  SimBus bus(BITRATE);
+
+  double moduleLoad = options.modules * (1000.0 / setup.heartbeatMs) * bus.frameUs(8) / 1e6;
+  std::vector<std::unique_ptr<SimNode>> nodes;
+  for (const Flow &flow : backgroundFlows(options.load - moduleLoad, options.seed)) {
+    nodes.emplace_back(new PeriodicNode(flow.id, flow.dlc, flow.periodUs, flow.phaseUs,
+                                        flow.periodUs / 10, options.seed ^ flow.id));
+  }
+  std::vector<DoorModuleNode *> modules;
+  for (uint8_t dip = 0; dip < options.modules; dip++) {
+    DoorModuleNode *module = new DoorModuleNode(dip, setup.mode, setup.heartbeatMs,
+                                                options.changesPerSecond,
+                                                options.seed * 101 + dip);
+    module->setCoalesceWindow(setup.coalesceMs);
+    module->setBursts(setup.burstChannels, setup.burstSpreadUs);
+    if (!options.trace.empty()) module->setScript(options.scriptStates[dip], options.scripts[dip]);
+    if (setup.energy) module->setPower(setup.powerMode, setup.cpuMhz, options.profile, BITRATE);
+    modules.push_back(module);
+    nodes.emplace_back(module);
+  }
+  for (auto &node : nodes) bus.addNode(node.get());
+
+  uint64_t untilUs = (uint64_t)options.seconds * 1000000;
+  bus.run(untilUs);
+
+  Result result = {};
+  std::vector<uint32_t> all;
+  for (DoorModuleNode *module : modules) {
+    if (setup.energy) {
+      module->finishEnergy(untilUs);
+      result.energy.push_back(module->energy());
+    }
+    all.insert(all.end(), module->latenciesUs().begin(), module->latenciesUs().end());
+    result.events += module->doorReporter().eventCount();
+    result.saved += module->doorReporter().savedCount();
+  }
+  std::sort(all.begin(), all.end());
+
+  result.load = bus.load();
+  result.changes = all.size();
+  if (!all.empty()) {
+    double sum = 0;
+    for (uint32_t latency : all) sum += latency;
+    result.meanUs = sum / all.size();
+    result.p99Us = all[(all.size() * 99) / 100];
+    result.maxUs = all.back();
+  }
+  return result;
+}
+
+static void priorityScenario(const Options &options) {
+  printf("Door change latency, %u modules, %.1f changes/s each, %u s, target load %.0f%%\n",
+         options.modules, options.changesPerSecond, options.seconds, options.load * 100);
+  printf("Latency = debounced change until the first frame with the new state has left the bus\n\n");
+  printf("%-10s %8s %8s %10s %10s %10s\n", "ids", "load", "changes", "mean_us", "p99_us", "max_us");
+
+  const struct {
+    DoorIdMode mode;
+    const char *name;
+  } modes[] = {
+    { DoorIdMode::PERIODIC, "periodic" },
+    { DoorIdMode::SHARED, "shared" },
+    { DoorIdMode::ROUTINE, "routine" },
+    { DoorIdMode::SPLIT, "split" },
+  };
+  for (const auto &mode : modes) {
+    Result result = runDoorBus(options, { mode.mode, 0, 1, 0 });
+    printf("%-10s %7.1f%% %8zu %10.0f %10u %10u\n", mode.name, result.load * 100,
+           result.changes, result.meanUs, result.p99Us, result.maxUs);
+  }
+}
+
+static void coalesceScenario(const Options &options) {
+  printf("Change coalescing, %u modules, %.1f incidents/s each tripping 1-3 switches within 5 ms,\n",
+         options.modules, options.changesPerSecond);
+  printf("%u s, target load %.0f%%\n\n", options.seconds, options.load * 100);
+  printf("%-10s %8s %8s %8s %10s %10s %10s\n", "window_ms", "changes", "events", "saved",
+         "mean_us", "p99_us", "max_us");
+
+  static const uint32_t WINDOWS_MS[] = { 0, 5, 10, 20 };
+  for (uint32_t window : WINDOWS_MS) {
+    Result result = runDoorBus(options, { DoorIdMode::SPLIT, window, 3, 5000 });
+    printf("%-10u %8zu %8u %8u %10.0f %10u %10u\n", window, result.changes, result.events,
+           result.saved, result.meanUs, result.p99Us, result.maxUs);
+  }
+}
+
+static void energyScenario(const Options &options) {
+  printf("Battery draw per module, %u modules, ", options.modules);
+  if (options.trace.empty()) {
+    printf("%.2f changes/s each", options.changesPerSecond);
+  } else {
+    printf("trace %s", options.trace.c_str());
+  }
+  printf(", %u s, target load %.0f%%\n", options.seconds, options.load * 100);
+  printf("mAh/day at the %.1f V battery; columns split the module draw by consumer\n\n",
+         options.profile.batteryV);
+
+  const struct {
+    const char *name;
+    PowerMode mode;
+    uint32_t cpuMhz;
+    uint32_t heartbeatMs;
+  } configs[] = {
+    { "polling", PowerMode::POLLING, 160, 200 },
+    { "polling", PowerMode::POLLING, 80, 200 },
+    { "polling", PowerMode::POLLING, 80, 1000 },
+    { "lp-core", PowerMode::LP_CORE, 80, 200 },
+    { "lp-core", PowerMode::LP_CORE, 80, 1000 },
+  };
+  static const size_t CONFIGS = sizeof(configs) / sizeof(configs[0]);
+
+  printf("%-8s %4s %6s %7s %7s %7s %7s %7s %8s %8s %9s", "mode", "mhz", "hb_ms", "cpu",
+         "sleep", "lp", "tx", "board", "module", "max", "all");
+  if (options.budgetMah > 0) printf(" %8s", "budget");
+  printf("\n");
+
+  uint64_t periodUs = (uint64_t)options.seconds * 1000000;
+  const PowerProfile &profile = options.profile;
+  std::vector<std::vector<double>> perModule(CONFIGS);
+  for (size_t c = 0; c < CONFIGS; c++) {
+    DoorSetup setup = { DoorIdMode::SPLIT, 0, 1, 0 };
+    setup.energy = true;
+    setup.powerMode = configs[c].mode;
+    setup.cpuMhz = configs[c].cpuMhz;
+    setup.heartbeatMs = configs[c].heartbeatMs;
+    Result result = runDoorBus(options, setup);
+
+    double consumers[EnergyMeter::CONSUMER_COUNT] = {};
+    double total = 0;
+    double worst = 0;
+    for (const EnergyMeter &meter : result.energy) {
+      for (uint8_t k = 0; k < EnergyMeter::CONSUMER_COUNT; k++) {
+        consumers[k] += meter.batteryMahPerDay(profile, periodUs, (EnergyMeter::Consumer)k);
+      }
+      double module = meter.batteryMahPerDay(profile, periodUs);
+      perModule[c].push_back(module);
+      total += module;
+      worst = std::max(worst, module);
+    }
+    size_t count = result.energy.size();
+    printf("%-8s %4u %6u", configs[c].name, configs[c].cpuMhz, configs[c].heartbeatMs);
+    for (double consumer : consumers) printf(" %7.1f", consumer / count);
+    printf(" %8.1f %8.1f %9.1f", total / count, worst, total);
+    if (options.budgetMah > 0) printf(" %7.1f%%", total / options.budgetMah * 100);
+    printf("\n");
+  }
+
+  printf("\n%-8s", "module");
+  for (size_t c = 0; c < CONFIGS; c++) {
+    char label[24];
+    snprintf(label, sizeof(label), "%s/%u/%u", configs[c].name, configs[c].cpuMhz,
+             configs[c].heartbeatMs);
+    printf(" %18s", label);
+  }
+  printf("\n");
+  for (uint8_t m = 0; m < options.modules; m++) {
+    printf("%-8u", m);
+    for (size_t c = 0; c < CONFIGS; c++) printf(" %18.1f", perModule[c][m]);
+    printf("\n");
+  }
+
+  printf("\nPower profile (--current NAME=VALUE):\n");
+  profile.print(stdout);
+}
+
+// address,time_s,channel,state lines from tools/can_history.py dump --csv.
+// Times are rebased to start 1 s into the run, the run is stretched to cover
+// the whole trace, and each channel starts in the opposite state of its first
+// change (channels without changes start closed).
+static void loadTrace(Options &options) {
+  FILE *file = fopen(options.trace.c_str(), "r");
+  if (!file) {
+    fprintf(stderr, "error: cannot open %s\n", options.trace.c_str());
+    exit(1);
+  }
+  struct Entry {
+    uint8_t module;
+    double timeS;
+    uint8_t channel;
+    bool open;
+  };
+  std::vector<Entry> entries;
+  char line[128];
+  while (fgets(line, sizeof(line), file)) {
+    unsigned module, channel;
+    double timeS;
+    char state[16];
+    if (sscanf(line, "%u,%lf,%u,%15[a-z01]", &module, &timeS, &channel, state) != 4) continue;
+    if (module >= options.modules || channel < 1 || channel > 10) continue;
+    bool open = !strcmp(state, "open") || !strcmp(state, "1");
+    entries.push_back({ (uint8_t)module, timeS, (uint8_t)(channel - 1), open });
+  }
+  fclose(file);
+  if (entries.empty()) {
+    fprintf(stderr, "error: no door changes in %s\n", options.trace.c_str());
+    exit(1);
+  }
+
+  std::stable_sort(entries.begin(), entries.end(),
+                   [](const Entry &a, const Entry &b) { return a.timeS < b.timeS; });
+  double firstS = entries.front().timeS;
+  double spanS = entries.back().timeS - firstS;
+  options.seconds = std::max(options.seconds, (uint32_t)ceil(spanS) + 2);
+
+  options.scripts.assign(options.modules, {});
+  options.scriptStates.assign(options.modules, 0);
+  std::vector<uint16_t> seen(options.modules, 0);
+  for (const Entry &entry : entries) {
+    uint16_t bit = 1 << entry.channel;
+    if (!(seen[entry.module] & bit)) {
+      seen[entry.module] |= bit;
+      if (!entry.open) options.scriptStates[entry.module] |= bit;
+    }
+    uint64_t atUs = (uint64_t)((entry.timeS - firstS + 1.0) * 1e6);
+    options.scripts[entry.module].push_back({ atUs, entry.channel, entry.open });
+  }
+}
+
+static void usage() {
+  fprintf(stderr,
+          "usage: can_sim [priority-split|coalesce|energy] [--load F] [--seconds N] [--seed N]\n"
+          "               [--modules N] [--changes-per-second F] [--trace CSV]\n"
+          "               [--budget-mah F] [--current NAME=VALUE]...\n");
+  exit(2);
+}
+
+int main(int argc, char **argv) {
+  Options options;
+  for (int i = 1; i < argc; i++) {
+    const char *arg = argv[i];
+    bool hasValue = i + 1 < argc;
+    if (!strcmp(arg, "--load") && hasValue) options.load = atof(argv[++i]);
+    else if (!strcmp(arg, "--seconds") && hasValue) options.seconds = atoi(argv[++i]);
+    else if (!strcmp(arg, "--seed") && hasValue) options.seed = atoi(argv[++i]);
+    else if (!strcmp(arg, "--modules") && hasValue) options.modules = atoi(argv[++i]);
+    else if (!strcmp(arg, "--changes-per-second") && hasValue) options.changesPerSecond = atof(argv[++i]);
+    else if (!strcmp(arg, "--trace") && hasValue) options.trace = argv[++i];
+    else if (!strcmp(arg, "--budget-mah") && hasValue) options.budgetMah = atof(argv[++i]);
+    else if (!strcmp(arg, "--current") && hasValue && options.profile.set(argv[i + 1])) i++;
+    else if (arg[0] != '-') options.scenario = arg;
+    else usage();
+  }
+  if (options.modules < 1 || options.modules > 8 || options.changesPerSecond <= 0) usage();
+  if (!options.trace.empty()) loadTrace(options);
+
+  if (options.scenario == "priority-split") {
+    priorityScenario(options);
+  } else if (options.scenario == "coalesce") {
+    coalesceScenario(options);
+  } else if (options.scenario == "energy") {
+    energyScenario(options);
+  } else {
+    usage();
+  }
+  return 0;
+}
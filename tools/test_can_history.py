@@ -0,0 +1,47 @@
+#!/usr/bin/env python3
+"""Checks the history block decoder against the firmware's EventLog encoder.
+
+REFERENCE_BLOCK is the block test/test_event_log encodes from the same
+events, so a change to either side of the format fails one of the two.
+
+    python3 -m unittest discover -s tools -p "test_*.py"
+"""
+
+import unittest
+
+import can_history
+
+REFERENCE_BLOCK = bytes([
+    0x00, 0x00, 0x00, 0x00,              # sequence 0
+    0xE8, 0x03, 0x00, 0x00, 0x00, 0x00,  # checkpoint 1000 ms
+    0x01, 0x00,                          # RSW01 open
+    0x2A, 0xF4, 0x03, 0x64, 0x0A,        # RSW03 open +500, closed +100, open +10
+    0x00, 0x00,                          # RSW01 closed +0
+    0x98, 0xA0, 0x9C, 0x01,              # RSW10 open +20000
+]) + b"\xff" * 8
+
+REFERENCE_EVENTS = [
+    (1500, 2, True),
+    (1600, 2, False),
+    (1610, 2, True),
+    (1610, 0, False),
+    (21610, 9, True),
+]
+
+
+class DecodeBlockTest(unittest.TestCase):
+    def test_reference_block(self):
+        sequence, checkpoint_ms, state, events = can_history.decode_block(REFERENCE_BLOCK)
+        self.assertEqual(sequence, 0)
+        self.assertEqual(checkpoint_ms, 1000)
+        self.assertEqual(state, 0x0001)
+        self.assertEqual(events, REFERENCE_EVENTS)
+
+    def test_block_copied_mid_record(self):
+        # Cut inside the RSW10 varint: everything before it still decodes
+        events = can_history.decode_block(REFERENCE_BLOCK[:21])[3]
+        self.assertEqual(events, REFERENCE_EVENTS[:4])
+
+
+if __name__ == "__main__":
+    unittest.main()
@@ -0,0 +1,168 @@
+#!/usr/bin/env python3
+"""Decode tokenized log records from a Cabinet & Door Sensor serial stream.
+
+tlogf() call sites send binary records (0xFE 'T' <words> then 32-bit LE
+words: token, timestamp_us, arguments). The token is the offset of the
+format string in the firmware's non-allocated .tokenlog section, so the ELF
+that was flashed is needed to decode. Plain text (debugf output) passes
+through unchanged.
+
+    python3 tools/tokenlog_decode.py .pio/build/esp32-c6-devkitm-1/firmware.elf /dev/ttyACM0
+    python3 tools/tokenlog_decode.py firmware.elf capture.bin
+"""
+
+import argparse
+import os
+import re
+import struct
+import sys
+
+MAGIC = b"\xfeT"
+SPEC = re.compile(r"%([-+ #0]*\d*(?:\.\d+)?)(hh|h|ll|l|z|j|t)?([diouxXcspfFeEgG%])")
+
+
+def load_formats(elf_path):
+    """Return {offset: format string} from the .tokenlog section."""
+    data = open(elf_path, "rb").read()
+    if data[:4] != b"\x7fELF":
+        sys.exit(f"error: {elf_path} is not an ELF file")
+    is64 = data[4] == 2
+    endian = "<" if data[5] == 1 else ">"
+    if is64:
+        shoff, = struct.unpack_from(endian + "Q", data, 0x28)
+        shentsize, shnum, shstrndx = struct.unpack_from(endian + "HHH", data, 0x3A)
+        header = struct.Struct(endian + "IIQQQQIIQQ")
+    else:
+        shoff, = struct.unpack_from(endian + "I", data, 0x20)
+        shentsize, shnum, shstrndx = struct.unpack_from(endian + "HHH", data, 0x2E)
+        header = struct.Struct(endian + "IIIIIIIIII")
+    sections = [header.unpack_from(data, shoff + i * shentsize) for i in range(shnum)]
+    names = sections[shstrndx]
+    for section in sections:
+        name_end = data.index(b"\0", names[4] + section[0])
+        if data[names[4] + section[0]:name_end] == b".tokenlog":
+            addr, offset, size = section[3], section[4], section[5]
+            break
+    else:
+        sys.exit("error: no .tokenlog section - was the firmware built with DEBUG?")
+
+    formats = {}
+    blob = data[offset:offset + size]
+    position = 0
+    while position < len(blob):
+        end = blob.find(b"\0", position)
+        if end < 0:
+            break
+        if end > position:
+            formats[addr + position] = blob[position:end].decode(errors="replace")
+        position = end + 1
+    return formats
+
+
+def render(fmt, words):
+    """Apply printf-style fmt to the raw argument words."""
+    words = list(words)
+    out = []
+    last = 0
+    for match in SPEC.finditer(fmt):
+        out.append(fmt[last:match.start()])
+        last = match.end()
+        flags, length, conv = match.groups()
+        if conv == "%":
+            out.append("%")
+            continue
+        try:
+            if conv == "s":
+                count = words.pop(0)
+                raw = b"".join(struct.pack("<I", words.pop(0)) for _ in range((count + 3) // 4))
+                value = raw[:count].decode(errors="replace")
+            elif conv in "fFeEgG" or length == "ll":
+                low, high = words.pop(0), words.pop(0)
+                bits = low | (high << 32)
+                if conv in "fFeEgG":
+                    value = struct.unpack("<d", struct.pack("<Q", bits))[0]
+                else:
+                    value = bits - (1 << 64) if conv in "di" and bits >> 63 else bits
+            else:
+                value = words.pop(0)
+                if conv in "di" and value >> 31:
+                    value -= 1 << 32
+        except IndexError:
+            out.append("<truncated>")
+            continue
+        if conv == "p":
+            out.append(f"0x{value:08x}")
+        elif conv == "u":
+            out.append(("%" + flags + "d") % value)
+        else:
+            out.append(("%" + flags + conv) % value)
+    out.append(fmt[last:])
+    return "".join(out)
+
+
+def decode_stream(stream, formats, write):
+    buffer = b""
+    while True:
+        chunk = stream.read(256)
+        if not chunk:
+            break
+        buffer += chunk
+        while True:
+            start = buffer.find(MAGIC)
+            if start < 0:
+                # Keep a trailing 0xFE that may begin the next record
+                keep = 1 if buffer.endswith(b"\xfe") else 0
+                write(buffer[:len(buffer) - keep].decode(errors="replace"))
+                buffer = buffer[len(buffer) - keep:]
+                break
+            write(buffer[:start].decode(errors="replace"))
+            buffer = buffer[start:]
+            if len(buffer) < 3 or len(buffer) < 3 + buffer[2] * 4:
+                break
+            count = buffer[2]
+            words = struct.unpack_from(f"<{count}I", buffer, 3)
+            buffer = buffer[3 + count * 4:]
+            if count < 2:
+                continue
+            token, timestamp = words[0], words[1]
+            fmt = formats.get(token)
+            if fmt is None:
+                text = f"<unknown token 0x{token:x}>"
+            else:
+                text = render(fmt.rstrip("\n"), words[2:])
+            write(f"[{timestamp / 1e6:12.6f}] {text}\n")
+
+
+def open_input(path):
+    if path == "-":
+        return sys.stdin.buffer
+    fd = os.open(path, os.O_RDONLY)
+    if os.isatty(fd):
+        import termios
+        import tty
+        tty.setraw(fd, termios.TCSANOW)
+    return os.fdopen(fd, "rb", buffering=0)
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__,
+                                     formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("elf", help="firmware.elf that is running on the module")
+    parser.add_argument("input", nargs="?", default="-",
+                        help="serial device or capture file (default stdin)")
+    args = parser.parse_args()
+
+    formats = load_formats(args.elf)
+
+    def write(text):
+        sys.stdout.write(text)
+        sys.stdout.flush()
+
+    try:
+        decode_stream(open_input(args.input), formats, write)
+    except KeyboardInterrupt:
+        pass
+
+
+if __name__ == "__main__":
+    main()
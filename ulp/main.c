@@ -0,0 +1,70 @@
+// =============================================================================
+// LP Core Reed Switch Sampler
+// =============================================================================
+//
+// Runs on the ESP32-C6 low-power RISC-V core while the HP core light-sleeps.
+// Samples LP IO 0-7 (RSW03-RSW10), debounces them and wakes the HP core only
+// when a debounced state change is confirmed. All state lives in LP RAM and
+// persists across LP timer wakeups.
+//
+// Variables below are shared with the HP core, which sees them as ulp_<name>
+// (see src/LpCoreSampler.cpp).
+
+#include <stdint.h>
+#include "ulp_lp_core_gpio.h"
+#include "ulp_lp_core_utils.h"
+
+#define LP_RSW_COUNT 8
+
+// Configuration written by the HP core before the program is started
+volatile uint32_t channel_mask = 0xFF;     // LP IO bits to sample
+volatile uint32_t debounce_samples = 5;    // Consecutive equal samples to confirm
+
+// State published to the HP core
+volatile uint32_t confirmed_state = 0;     // Bit n = LP IO n HIGH (door open)
+volatile uint32_t change_pending = 0;      // Set here, cleared by the HP core
+volatile uint32_t sample_count = 0;
+
+static uint32_t candidate_state = 0;
+static uint32_t stable_samples = 0;
+static uint32_t initialized = 0;
+
+static uint32_t sample_pins(void) {
+  uint32_t state = 0;
+  for (uint32_t i = 0; i < LP_RSW_COUNT; i++) {
+    if ((channel_mask & (1u << i)) &&
+        ulp_lp_core_gpio_get_level((lp_io_num_t)i)) {
+      state |= (1u << i);
+    }
+  }
+  return state;
+}
+
+int main(void) {
+  uint32_t raw = sample_pins();
+  sample_count++;
+
+  if (!initialized) {
+    // First run: adopt the current levels without waking the HP core
+    confirmed_state = raw;
+    candidate_state = raw;
+    initialized = 1;
+    return 0;
+  }
+
+  if (raw != candidate_state) {
+    candidate_state = raw;
+    stable_samples = 0;
+  } else if (stable_samples < debounce_samples) {
+    stable_samples++;
+  }
+
+  if (stable_samples >= debounce_samples && candidate_state != confirmed_state) {
+    confirmed_state = candidate_state;
+    change_pending = 1;
+    ulp_lp_core_wakeup_main_processor();
+  }
+
+  // Returning puts the LP core back to sleep until the next LP timer wakeup
+  return 0;
+}